@@ -0,0 +1,40 @@
+#ifndef VLIB_COMPARE_H
+#define VLIB_COMPARE_H
+
+#include <type_traits>
+
+/*
+    Comparator helpers shared by the ordered containers.
+
+    Every ordered container takes a Compare template parameter (std::less<T> by default), a strict weak
+    ordering on its keys. Two keys are equivalent when neither orders before the other, that is what
+    the containers use instead of operator==.
+
+    A comparator that declares is_transparent (std::less<>, std::greater<>, ...) can compare the keys
+    against other types, the lookup functions of the containers then take any such type directly:
+        AVLTree<std::string, PoolAllocator<std::string>, std::less<>> tree;
+        tree.search(std::string_view("key"));     // no temporary std::string
+*/
+
+namespace VLIB {
+
+// True when Compare declares is_transparent
+template <class Compare, class = void>
+struct IsTransparentCompare : std::false_type {};
+template <class Compare>
+struct IsTransparentCompare<Compare, std::void_t<typename Compare::is_transparent>> : std::true_type {};
+
+// SFINAE guard for the heterogeneous lookup overloads, C is the container's Compare passed as a
+// defaulted template parameter so the check happens per call
+template <class C>
+using EnableIfTransparent = typename std::enable_if<IsTransparentCompare<C>::value, int>::type;
+
+// Neither a before b nor b before a
+template <class Compare, class A, class B>
+bool Equivalent(const Compare& comp, const A& a, const B& b) {
+    return !comp(a, b) && !comp(b, a);
+}
+
+} // namespace VLIB
+
+#endif // VLIB_COMPARE_H
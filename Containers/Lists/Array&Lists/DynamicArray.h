@@ -2,19 +2,68 @@
 #define DYNAMIC_ARRAY_H
 
 #include <iostream>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 /*
 
     A dynamic sized array, which is a resizable array.
     The size of the array is determined at runtime.
 
+    The array owns raw (uninitialized) storage, only the first getSize() slots hold
+    constructed elements. Growing relocates the elements into the new block:
+        - trivially copyable T is moved with a single memcpy
+        - T with a noexcept move constructor is moved
+        - otherwise T is copied, so a throwing copy leaves the array untouched
+
     Initialization:
         DynamicArray<int> arr;
+        arr.reserve(1000);       // one allocation up front
+        arr.emplaceBack(42);     // constructed in place
 
 */
 
 namespace VLIB {
 
+/*
+* Relocation helpers, shared by the array containers
+*/
+
+// Runs the destructor of count constructed elements, no-op for trivially destructible types
+template <class T>
+void destroyElements(T* first, size_t count) {
+    if (std::is_trivially_destructible<T>::value)
+        return;
+    for (size_t i = 0; i < count; ++i)
+        first[i].~T();
+}
+
+// Move-constructs count elements from src into the raw storage at dst and destroys the sources.
+// Trivially copyable types are relocated with memcpy, other types use move_if_noexcept so a
+// throwing copy constructor leaves src intact (the partially built dst is destroyed again).
+template <class T>
+void relocateElements(T* src, size_t count, T* dst) {
+    if (count == 0)
+        return;
+    if constexpr (std::is_trivially_copyable<T>::value) {
+        std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), count * sizeof(T));
+    } else {
+        size_t built = 0;
+        try {
+            for (; built < count; ++built)
+                ::new (static_cast<void*>(dst + built)) T(std::move_if_noexcept(src[built]));
+        } catch (...) {
+            destroyElements(dst, built);
+            throw;
+        }
+        destroyElements(src, count);
+    }
+}
+
 template <class T>
 class DynamicArray {
 private:
@@ -22,13 +71,22 @@ private:
     size_t size;
     size_t capacity;
 
+    T* allocate(size_t count) { return count ? std::allocator<T>().allocate(count) : nullptr; }
+    void deallocate(T* block, size_t count) { if (block) std::allocator<T>().deallocate(block, count); }
+    size_t growthCapacity(size_t minCapacity) const;
+
 public:
     // Constructor
     DynamicArray();
+    DynamicArray(const DynamicArray& other);
+    DynamicArray(DynamicArray&& other) noexcept;
 
     // Destructor
     ~DynamicArray();
 
+    DynamicArray& operator=(const DynamicArray& other);
+    DynamicArray& operator=(DynamicArray&& other) noexcept;
+
     // Accessor methods
     size_t getSize() const;
     size_t getCapacity() const;
@@ -39,8 +97,14 @@ public:
 
     // Mutator methods
     void pushBack(const T& value);
+    void pushBack(T&& value);
+    template <class... Args>
+    T& emplaceBack(Args&&... args);
     void popBack();
-    void resize(size_t newCapacity);
+    void clear();
+    void resize(size_t newCapacity);   // reallocates to exactly newCapacity, drops elements past it
+    void reserve(size_t minCapacity);  // grows capacity to at least minCapacity, never shrinks
+    void shrink_to_fit();              // releases the unused tail of the storage
 
     // Test function
     void TestFunction();
@@ -52,10 +116,55 @@ public:
 template <typename T>
 DynamicArray<T>::DynamicArray() : data(nullptr), size(0), capacity(0) {}
 
+template <typename T>
+DynamicArray<T>::DynamicArray(const DynamicArray& other) : data(nullptr), size(0), capacity(0) {
+    reserve(other.size);
+    try {
+        for (; size < other.size; ++size)
+            ::new (static_cast<void*>(data + size)) T(other.data[size]);
+    } catch (...) {
+        // The destructor does not run for a constructor that throws, undo the copies made so far
+        destroyElements(data, size);
+        deallocate(data, capacity);
+        throw;
+    }
+}
+
+template <typename T>
+DynamicArray<T>::DynamicArray(DynamicArray&& other) noexcept
+    : data(other.data), size(other.size), capacity(other.capacity) {
+    other.data = nullptr;
+    other.size = other.capacity = 0;
+}
+
 // Destructor
 template <typename T>
 DynamicArray<T>::~DynamicArray() {
-    delete[] data;
+    destroyElements(data, size);
+    deallocate(data, capacity);
+}
+
+template <typename T>
+DynamicArray<T>& DynamicArray<T>::operator=(const DynamicArray& other) {
+    if (this != &other) {
+        DynamicArray copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template <typename T>
+DynamicArray<T>& DynamicArray<T>::operator=(DynamicArray&& other) noexcept {
+    if (this != &other) {
+        destroyElements(data, size);
+        deallocate(data, capacity);
+        data = other.data;
+        size = other.size;
+        capacity = other.capacity;
+        other.data = nullptr;
+        other.size = other.capacity = 0;
+    }
+    return *this;
 }
 
 // Accessor methods
@@ -97,35 +206,102 @@ const T& DynamicArray<T>::operator[](size_t index) const {
 // Mutator methods
 template <typename T>
 void DynamicArray<T>::pushBack(const T& value) {
+    emplaceBack(value);
+}
+
+template <typename T>
+void DynamicArray<T>::pushBack(T&& value) {
+    emplaceBack(std::move(value));
+}
+
+template <typename T>
+template <class... Args>
+T& DynamicArray<T>::emplaceBack(Args&&... args) {
     if (size == capacity) {
-        // If the array is full, resize it
-        resize(capacity * 2 + 1);
+        // If the array is full, build the element in the new block first, the arguments
+        // may refer to an element of this array that the relocation is about to move
+        size_t newCapacity = growthCapacity(size + 1);
+        T* newData = allocate(newCapacity);
+        try {
+            ::new (static_cast<void*>(newData + size)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(newData, newCapacity);
+            throw;
+        }
+        try {
+            relocateElements(data, size, newData);
+        } catch (...) {
+            newData[size].~T();
+            deallocate(newData, newCapacity);
+            throw;
+        }
+        deallocate(data, capacity);
+        data = newData;
+        capacity = newCapacity;
+        return data[size++];
     }
-    data[size++] = value;
+    ::new (static_cast<void*>(data + size)) T(std::forward<Args>(args)...);
+    return data[size++];
 }
 
 template <typename T>
 void DynamicArray<T>::popBack() {
     if (!isEmpty()) {
         --size;
+        data[size].~T();
     }
 }
 
+template <typename T>
+void DynamicArray<T>::clear() {
+    destroyElements(data, size);
+    size = 0;
+}
+
+template <typename T>
+void DynamicArray<T>::reserve(size_t minCapacity) {
+    if (minCapacity > capacity)
+        resize(minCapacity);
+}
+
+template <typename T>
+void DynamicArray<T>::shrink_to_fit() {
+    if (size < capacity)
+        resize(size);
+}
+
 // Test function
 template <typename T>
 void DynamicArray<T>::TestFunction() {
     // Implement your test function body here
 }
 
-// Private helper method
+// Private helper methods
+
+// Geometric growth, same 2n + 1 sequence as before but never below what was asked for
+template <typename T>
+size_t DynamicArray<T>::growthCapacity(size_t minCapacity) const {
+    size_t grown = capacity * 2 + 1;
+    return grown < minCapacity ? minCapacity : grown;
+}
+
 template <typename T>
 void DynamicArray<T>::resize(size_t newCapacity) {
-    T* newData = new T[newCapacity];
-    for (size_t i = 0; i < size; ++i) {
-        newData[i] = data[i];
+    if (newCapacity == capacity)
+        return;
+    if (newCapacity < size) {
+        destroyElements(data + newCapacity, size - newCapacity);
+        size = newCapacity;
+    }
+    T* newData = allocate(newCapacity);
+    try {
+        relocateElements(data, size, newData);
+    } catch (...) {
+        deallocate(newData, newCapacity);
+        throw;
     }
+    deallocate(data, capacity);
     capacity = newCapacity;
-    delete[] data;
     data = newData;
 }
 
@@ -0,0 +1,266 @@
+#ifndef SMALL_DYNAMIC_ARRAY_H
+#define SMALL_DYNAMIC_ARRAY_H
+
+#include "DynamicArray.h"
+
+/*
+
+    A dynamic sized array with a small inline buffer.
+    The first InlineN elements are stored inside the object itself, the array only
+    allocates from the heap once it grows past that, after which it behaves like DynamicArray.
+    Useful for short lists that are created and dropped often, the common case never mallocs.
+
+    Initialization:
+        SmallDynamicArray<int, 8> arr;
+
+*/
+
+namespace VLIB {
+
+template <class T, size_t InlineN>
+class SmallDynamicArray {
+    static_assert(InlineN > 0, "SmallDynamicArray needs at least one inline slot, use DynamicArray otherwise");
+
+private:
+    alignas(T) unsigned char inlineBuffer[InlineN * sizeof(T)];
+    T* data;
+    size_t size;
+    size_t capacity;
+
+    T* inlineData() { return reinterpret_cast<T*>(inlineBuffer); }
+    const T* inlineData() const { return reinterpret_cast<const T*>(inlineBuffer); }
+    void releaseHeap();
+    void adoptFrom(SmallDynamicArray& other);
+    size_t growthCapacity(size_t minCapacity) const;
+
+public:
+    // Constructor
+    SmallDynamicArray();
+    SmallDynamicArray(const SmallDynamicArray& other);
+    SmallDynamicArray(SmallDynamicArray&& other) noexcept(std::is_nothrow_move_constructible<T>::value);
+
+    // Destructor
+    ~SmallDynamicArray();
+
+    SmallDynamicArray& operator=(const SmallDynamicArray& other);
+    SmallDynamicArray& operator=(SmallDynamicArray&& other) noexcept(std::is_nothrow_move_constructible<T>::value);
+
+    // Accessor methods
+    size_t getSize() const { return size; }
+    size_t getCapacity() const { return capacity; }
+    bool isEmpty() const { return size == 0; }
+    bool isInline() const { return data == inlineData(); }  // true while no heap block is in use
+
+    T& operator[](size_t index);
+    const T& operator[](size_t index) const;
+
+    // Mutator methods
+    void pushBack(const T& value);
+    void pushBack(T&& value);
+    template <class... Args>
+    T& emplaceBack(Args&&... args);
+    void popBack();
+    void clear();
+    void resize(size_t newCapacity);   // reallocates to newCapacity (never below InlineN), drops elements past it
+    void reserve(size_t minCapacity);
+    void shrink_to_fit();              // moves back into the inline buffer when the elements fit
+};
+
+// SmallDynamicArray.cpp
+
+// Constructor
+template <typename T, size_t InlineN>
+SmallDynamicArray<T, InlineN>::SmallDynamicArray() : data(inlineData()), size(0), capacity(InlineN) {}
+
+template <typename T, size_t InlineN>
+SmallDynamicArray<T, InlineN>::SmallDynamicArray(const SmallDynamicArray& other)
+    : data(inlineData()), size(0), capacity(InlineN) {
+    reserve(other.size);
+    try {
+        for (; size < other.size; ++size)
+            ::new (static_cast<void*>(data + size)) T(other.data[size]);
+    } catch (...) {
+        // The destructor does not run for a constructor that throws, undo the copies made so far
+        destroyElements(data, size);
+        releaseHeap();
+        throw;
+    }
+}
+
+template <typename T, size_t InlineN>
+SmallDynamicArray<T, InlineN>::SmallDynamicArray(SmallDynamicArray&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    : SmallDynamicArray() {
+    adoptFrom(other);
+}
+
+// Destructor
+template <typename T, size_t InlineN>
+SmallDynamicArray<T, InlineN>::~SmallDynamicArray() {
+    destroyElements(data, size);
+    releaseHeap();
+}
+
+template <typename T, size_t InlineN>
+SmallDynamicArray<T, InlineN>& SmallDynamicArray<T, InlineN>::operator=(const SmallDynamicArray& other) {
+    if (this != &other) {
+        SmallDynamicArray copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template <typename T, size_t InlineN>
+SmallDynamicArray<T, InlineN>& SmallDynamicArray<T, InlineN>::operator=(SmallDynamicArray&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+    if (this != &other) {
+        clear();
+        releaseHeap();
+        adoptFrom(other);
+    }
+    return *this;
+}
+
+template <typename T, size_t InlineN>
+T& SmallDynamicArray<T, InlineN>::operator[](size_t index) {
+    if (index < size) {
+        return data[index];
+    } else {
+        throw std::out_of_range("Index out of bounds");
+    }
+}
+
+template <typename T, size_t InlineN>
+const T& SmallDynamicArray<T, InlineN>::operator[](size_t index) const {
+    if (index < size) {
+        return data[index];
+    } else {
+        throw std::out_of_range("Index out of bounds");
+    }
+}
+
+// Mutator methods
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::pushBack(const T& value) {
+    emplaceBack(value);
+}
+
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::pushBack(T&& value) {
+    emplaceBack(std::move(value));
+}
+
+template <typename T, size_t InlineN>
+template <class... Args>
+T& SmallDynamicArray<T, InlineN>::emplaceBack(Args&&... args) {
+    if (size == capacity) {
+        // Spill (or regrow) to the heap, the new element is built first since the
+        // arguments may refer to an element that is about to be relocated
+        size_t newCapacity = growthCapacity(size + 1);
+        T* newData = std::allocator<T>().allocate(newCapacity);
+        try {
+            ::new (static_cast<void*>(newData + size)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            std::allocator<T>().deallocate(newData, newCapacity);
+            throw;
+        }
+        try {
+            relocateElements(data, size, newData);
+        } catch (...) {
+            newData[size].~T();
+            std::allocator<T>().deallocate(newData, newCapacity);
+            throw;
+        }
+        releaseHeap();
+        data = newData;
+        capacity = newCapacity;
+        return data[size++];
+    }
+    ::new (static_cast<void*>(data + size)) T(std::forward<Args>(args)...);
+    return data[size++];
+}
+
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::popBack() {
+    if (!isEmpty()) {
+        --size;
+        data[size].~T();
+    }
+}
+
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::clear() {
+    destroyElements(data, size);
+    size = 0;
+}
+
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::reserve(size_t minCapacity) {
+    if (minCapacity > capacity)
+        resize(minCapacity);
+}
+
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::shrink_to_fit() {
+    if (size < capacity)
+        resize(size);
+}
+
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::resize(size_t newCapacity) {
+    if (newCapacity < InlineN)
+        newCapacity = InlineN;
+    if (newCapacity == capacity)
+        return;
+    if (newCapacity < size) {
+        destroyElements(data + newCapacity, size - newCapacity);
+        size = newCapacity;
+    }
+    T* newData = newCapacity == InlineN ? inlineData() : std::allocator<T>().allocate(newCapacity);
+    try {
+        relocateElements(data, size, newData);
+    } catch (...) {
+        if (newData != inlineData())
+            std::allocator<T>().deallocate(newData, newCapacity);
+        throw;
+    }
+    releaseHeap();
+    data = newData;
+    capacity = newCapacity;
+}
+
+// Private helper methods
+
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::releaseHeap() {
+    if (!isInline())
+        std::allocator<T>().deallocate(data, capacity);
+    data = inlineData();
+    capacity = InlineN;
+}
+
+// Takes over other's elements, a heap block is stolen as is, inline elements have to be moved one by one.
+// Expects this array to be empty and inline, leaves other empty and inline.
+template <typename T, size_t InlineN>
+void SmallDynamicArray<T, InlineN>::adoptFrom(SmallDynamicArray& other) {
+    if (other.isInline()) {
+        relocateElements(other.data, other.size, data);
+        size = other.size;
+    } else {
+        data = other.data;
+        size = other.size;
+        capacity = other.capacity;
+        other.data = other.inlineData();
+        other.capacity = InlineN;
+    }
+    other.size = 0;
+}
+
+// Same 2n + 1 growth as DynamicArray once on the heap
+template <typename T, size_t InlineN>
+size_t SmallDynamicArray<T, InlineN>::growthCapacity(size_t minCapacity) const {
+    size_t grown = capacity * 2 + 1;
+    return grown < minCapacity ? minCapacity : grown;
+}
+
+} //namespace VLIB
+
+#endif // SMALL_DYNAMIC_ARRAY_H
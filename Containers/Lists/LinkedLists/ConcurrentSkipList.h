@@ -0,0 +1,307 @@
+#ifndef VLIB_CONCURRENT_SKIPLIST_H
+#define VLIB_CONCURRENT_SKIPLIST_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "SkipListLevel.h"
+#include "../../../Memory/EpochReclamation.h"
+
+/*
+    A lock-free skip list set, safe to use from any number of threads at once.
+
+    Every forward link is an atomic word holding the successor pointer, its low bit marks the node the
+    link belongs to as removed. insert links a new node with one compare-and-swap at the bottom level,
+    that is the moment it is in the set, and then links the levels above it one by one. remove marks the
+    links of a node top down, marking the bottom link is the moment it leaves the set, after that any
+    thread walking past the node unlinks it (Harris, Fraser). contains only reads, it never writes and
+    never retries.
+
+    Removed nodes are not freed on the spot, a reader may still be standing on them. They go to the
+    list's EpochDomain and are freed once every thread that was inside the list at the time has left it.
+
+    Initialization:
+        ConcurrentSkipList<int> list;         // up to 2^24 or so elements before the levels run out
+        ConcurrentSkipList<int, 32> list;     // levels 0 .. 32
+
+        list.insert(5);                       // from any thread, false if 5 was there already
+        list.contains(5);
+        list.remove(5);                       // false if 5 was not there
+
+    T needs operator< and a copy constructor, it does not need a default constructor. size() and
+    for_each() are only exact while no other thread is changing the list.
+*/
+
+namespace VLIB {
+
+template <class T, int MaxLevel = 24>
+class ConcurrentSkipList
+{
+    static_assert(MaxLevel >= 0 && MaxLevel < 64, "ConcurrentSkipList: MaxLevel must be in [0, 63]");
+
+public:
+    ConcurrentSkipList();
+    ~ConcurrentSkipList();
+
+    ConcurrentSkipList(const ConcurrentSkipList &) = delete;
+    ConcurrentSkipList &operator=(const ConcurrentSkipList &) = delete;
+
+    bool insert(const T &value);
+    bool remove(const T &value);
+    bool contains(const T &value) const;
+
+    std::size_t size() const { return count.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+
+    // fn(value) for every element in ascending order, concurrent changes may or may not be seen
+    template <class Fn>
+    void for_each(Fn fn);
+
+private:
+    using Link = std::atomic<std::uintptr_t>;
+
+    // The links follow the node in the same allocation, level + 1 of them
+    struct Node
+    {
+        T value;
+        int level;
+        std::atomic<int> handoff; // insert and remove both count in once they are done, the second one retires the node
+
+        Node(const T &value, int level) : value(value), level(level), handoff(0) {}
+        Link *links() { return reinterpret_cast<Link *>(reinterpret_cast<unsigned char *>(this) + LinksOffset); }
+    };
+
+    static constexpr std::size_t LinksOffset = (sizeof(Node) + alignof(Link) - 1) / alignof(Link) * alignof(Link);
+    static constexpr std::uintptr_t Mark = 1;
+
+    static Node *node_of(std::uintptr_t link) { return reinterpret_cast<Node *>(link & ~Mark); }
+    static bool is_marked(std::uintptr_t link) { return (link & Mark) != 0; }
+    static std::uintptr_t link_to(Node *node) { return reinterpret_cast<std::uintptr_t>(node); }
+
+    static Node *create_node(const T &value, int level);
+    static void destroy_node(Node *node);
+    static void free_retired(void *node, void *) { destroy_node(static_cast<Node *>(node)); }
+
+    bool find(const T &value, Link **preds, Node **succs);
+    void release(Node *node);
+
+    Link head[MaxLevel + 1];
+    std::atomic<std::size_t> count;
+    mutable EpochDomain domain; // Pinning only touches the calling thread's record, so const readers pin too
+};
+
+template <class T, int MaxLevel>
+ConcurrentSkipList<T, MaxLevel>::ConcurrentSkipList() : count(0)
+{
+    for (Link &link : head)
+        link.store(0, std::memory_order_relaxed);
+}
+
+// Nobody may use the list any more, the nodes still linked are freed here, the retired ones by the domain
+template <class T, int MaxLevel>
+ConcurrentSkipList<T, MaxLevel>::~ConcurrentSkipList()
+{
+    Node *node = node_of(head[0].load(std::memory_order_acquire));
+    while (node != nullptr)
+    {
+        Node *next = node_of(node->links()[0].load(std::memory_order_relaxed));
+        destroy_node(node);
+        node = next;
+    }
+}
+
+template <class T, int MaxLevel>
+typename ConcurrentSkipList<T, MaxLevel>::Node *ConcurrentSkipList<T, MaxLevel>::create_node(const T &value, int level)
+{
+    void *memory = ::operator new(LinksOffset + (level + 1) * sizeof(Link), std::align_val_t(alignof(Node)));
+    Node *node;
+    try
+    {
+        node = new (memory) Node(value, level);
+    }
+    catch (...)
+    {
+        ::operator delete(memory, std::align_val_t(alignof(Node)));
+        throw;
+    }
+    for (int i = 0; i <= level; i++)
+        new (node->links() + i) Link(0);
+    return node;
+}
+
+template <class T, int MaxLevel>
+void ConcurrentSkipList<T, MaxLevel>::destroy_node(Node *node)
+{
+    for (int i = 0; i <= node->level; i++)
+        node->links()[i].~Link();
+    node->~Node();
+    ::operator delete(static_cast<void *>(node), std::align_val_t(alignof(Node)));
+}
+
+// Fills preds (the link arrays to change) and succs with the neighbours of value on every level and
+// unlinks the removed nodes it walks past on the way, true if an unremoved node holds value
+template <class T, int MaxLevel>
+bool ConcurrentSkipList<T, MaxLevel>::find(const T &value, Link **preds, Node **succs)
+{
+retry:
+    Link *pred = head;
+    Node *curr = nullptr;
+    for (int level = MaxLevel; level >= 0; level--)
+    {
+        curr = node_of(pred[level].load(std::memory_order_acquire));
+        while (curr != nullptr)
+        {
+            std::uintptr_t succ = curr->links()[level].load(std::memory_order_acquire);
+            if (is_marked(succ))
+            {
+                // curr is being removed, take it out of this level before going on
+                std::uintptr_t expected = link_to(curr);
+                if (!pred[level].compare_exchange_strong(expected, succ & ~Mark))
+                    goto retry; // pred changed or is being removed itself
+                curr = node_of(succ);
+                continue;
+            }
+            if (!(curr->value < value))
+                break;
+            pred = curr->links();
+            curr = node_of(succ);
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+    return curr != nullptr && !(value < curr->value);
+}
+
+// insert and remove of the same node both end here, the node can go once neither links it any more
+template <class T, int MaxLevel>
+void ConcurrentSkipList<T, MaxLevel>::release(Node *node)
+{
+    if (node->handoff.fetch_add(1) == 1)
+        domain.retire(node, &free_retired, nullptr);
+}
+
+template <class T, int MaxLevel>
+bool ConcurrentSkipList<T, MaxLevel>::insert(const T &value)
+{
+    Link *preds[MaxLevel + 1];
+    Node *succs[MaxLevel + 1];
+    int level = skiplist_random_level(MaxLevel);
+    EpochGuard guard(domain);
+
+    Node *node = nullptr;
+    while (true)
+    {
+        if (find(value, preds, succs))
+        {
+            if (node != nullptr)
+                destroy_node(node); // Never published
+            return false;
+        }
+        if (node == nullptr)
+            node = create_node(value, level);
+        for (int i = 0; i <= level; i++)
+            node->links()[i].store(link_to(succs[i]), std::memory_order_relaxed);
+        std::uintptr_t expected = link_to(succs[0]);
+        if (preds[0][0].compare_exchange_strong(expected, link_to(node)))
+            break;
+    }
+    count.fetch_add(1, std::memory_order_relaxed);
+
+    // In the set now, link the levels above. A remover marks the links top down, once a link of the
+    // node is marked the levels from there up are left alone.
+    for (int i = 1; i <= level; i++)
+    {
+        while (true)
+        {
+            std::uintptr_t next = node->links()[i].load(std::memory_order_acquire);
+            if (is_marked(next))
+                goto linked;
+            if (node_of(next) != succs[i] && !node->links()[i].compare_exchange_strong(next, link_to(succs[i])))
+                goto linked;
+            std::uintptr_t expected = link_to(succs[i]);
+            if (preds[i][i].compare_exchange_strong(expected, link_to(node)))
+                break;
+            find(value, preds, succs);
+        }
+    }
+linked:
+    // Removed while the levels were linked, the remover may have swept before the last of them
+    if (is_marked(node->links()[0].load(std::memory_order_acquire)))
+        find(value, preds, succs);
+    release(node);
+    return true;
+}
+
+template <class T, int MaxLevel>
+bool ConcurrentSkipList<T, MaxLevel>::remove(const T &value)
+{
+    Link *preds[MaxLevel + 1];
+    Node *succs[MaxLevel + 1];
+    EpochGuard guard(domain);
+
+    if (!find(value, preds, succs))
+        return false;
+    Node *victim = succs[0];
+    for (int i = victim->level; i >= 1; i--)
+    {
+        std::uintptr_t next = victim->links()[i].load(std::memory_order_acquire);
+        while (!is_marked(next) && !victim->links()[i].compare_exchange_weak(next, next | Mark))
+        {
+        }
+    }
+    std::uintptr_t next = victim->links()[0].load(std::memory_order_acquire);
+    while (true)
+    {
+        if (is_marked(next))
+            return false; // Another thread removed it first
+        if (victim->links()[0].compare_exchange_strong(next, next | Mark))
+            break;
+    }
+    count.fetch_sub(1, std::memory_order_relaxed);
+    find(value, preds, succs); // Unlinks it from every level
+    release(victim);
+    return true;
+}
+
+template <class T, int MaxLevel>
+bool ConcurrentSkipList<T, MaxLevel>::contains(const T &value) const
+{
+    EpochGuard guard(domain);
+    const Link *pred = head;
+    Node *curr = nullptr;
+    for (int level = MaxLevel; level >= 0; level--)
+    {
+        curr = node_of(pred[level].load(std::memory_order_acquire));
+        while (curr != nullptr)
+        {
+            std::uintptr_t succ = curr->links()[level].load(std::memory_order_acquire);
+            if (!is_marked(succ))
+            {
+                if (!(curr->value < value))
+                    break;
+                pred = curr->links();
+            }
+            curr = node_of(succ);
+        }
+    }
+    return curr != nullptr && !(value < curr->value);
+}
+
+template <class T, int MaxLevel>
+template <class Fn>
+void ConcurrentSkipList<T, MaxLevel>::for_each(Fn fn)
+{
+    EpochGuard guard(domain);
+    Node *node = node_of(head[0].load(std::memory_order_acquire));
+    while (node != nullptr)
+    {
+        std::uintptr_t next = node->links()[0].load(std::memory_order_acquire);
+        if (!is_marked(next))
+            fn(node->value);
+        node = node_of(next);
+    }
+}
+
+} // namespace VLIB
+
+#endif // VLIB_CONCURRENT_SKIPLIST_H
@@ -3,7 +3,10 @@
 #define __DLLIST_H__
 
 #include <iostream>
-#include "../../../flags.h"
+#include <memory>
+#include "../../../Flags.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
 
 
 /*
@@ -12,6 +15,9 @@
 
     Initialization:
         DLList<int> list;
+        DLList<int, MyAllocator<int>> list(alloc); // nodes come from alloc
+
+    Nodes come from a PoolAllocator (slab pool per list) unless another allocator is given.
 */
 
 namespace VLIB{
@@ -39,21 +45,30 @@ public:
 
 /// LIST CLASS ///
 
-template <class T>
+template <class T, class Alloc = PoolAllocator<T>>
 class DLList
 {
 protected:
     VLIB::selfOrganizingListFlags organizeFlag;
     DLLNode<T> *head, *tail;
+    NodeAllocatorFor<Alloc, DLLNode<T>> nodeAlloc;
 
 
 public:
 
-    DLList() {
+    DLList() : nodeAlloc(Alloc()) {
+        head = tail = 0;
+        organizeFlag = VLIB::NO_FLAG;
+    }
+    DLList(VLIB::selfOrganizingListFlags flag) : nodeAlloc(Alloc()) {
+        head = tail = 0;
+        organizeFlag = flag;
+    }
+    explicit DLList(const Alloc& alloc) : nodeAlloc(alloc) {
         head = tail = 0;
         organizeFlag = VLIB::NO_FLAG;
     }
-    DLList(VLIB::selfOrganizingListFlags flag) {
+    DLList(VLIB::selfOrganizingListFlags flag, const Alloc& alloc) : nodeAlloc(alloc) {
         head = tail = 0;
         organizeFlag = flag;
     }
@@ -72,18 +87,20 @@ public:
     T* find(const T& el); // find the first node with the given info
 };
 
-template <class T>
-DLList<T>::~DLList()
+template <class T, class Alloc>
+DLList<T, Alloc>::~DLList()
 {
+    if (tryReleaseAllNodes(nodeAlloc)) // pooled nodes are dropped chunk by chunk
+        return;
     for (DLLNode<T> *p; !isEmpty(); ) {
         p = head->next;
-        delete head;
+        destroyNode(nodeAlloc, head);
         head = p;
     }
 }
 
-template <class T>
-void DLList<T>::printAll() const
+template <class T, class Alloc>
+void DLList<T, Alloc>::printAll() const
 {
     if(tail == 0 || head == 0)
         return;
@@ -98,8 +115,8 @@ void DLList<T>::printAll() const
 
 }
 
-template <class T>
-void DLList<T>::printAllBackwards() const
+template <class T, class Alloc>
+void DLList<T, Alloc>::printAllBackwards() const
 {
     if(tail == 0 || head == 0)
         return;
@@ -113,8 +130,8 @@ void DLList<T>::printAllBackwards() const
     std::cout << n->info << " ";
 }
 
-template <class T>
-void DLList<T>::reverse()
+template <class T, class Alloc>
+void DLList<T, Alloc>::reverse()
 {
     if(tail == 0 || head == 0)
         throw std::runtime_error("List is empty");
@@ -135,8 +152,8 @@ void DLList<T>::reverse()
     head = prev;
 }
 
-template <class T>
-void DLList<T>::deleteNode(DLLNode<T> *p)
+template <class T, class Alloc>
+void DLList<T, Alloc>::deleteNode(DLLNode<T> *p)
 {
 
     if(tail == 0 || head == 0)
@@ -147,7 +164,7 @@ void DLList<T>::deleteNode(DLLNode<T> *p)
     if(p == n) // was head
     {
         DLLNode<T>* next = n->next;
-        delete head;
+        destroyNode(nodeAlloc, head);
         next->prev = 0;
         head = next;
         return;
@@ -155,7 +172,7 @@ void DLList<T>::deleteNode(DLLNode<T> *p)
     else if(p == tail) // was tail
     {
         prev = tail->prev;
-        delete tail;
+        destroyNode(nodeAlloc, tail);
         prev->next = 0;
         tail = prev;
         return;
@@ -167,7 +184,7 @@ void DLList<T>::deleteNode(DLLNode<T> *p)
         {
             prev = n->prev;
             next = n->next;
-            delete n;
+            destroyNode(nodeAlloc, n);
             prev->next = next;
             next->prev = prev;
             return;
@@ -176,32 +193,32 @@ void DLList<T>::deleteNode(DLLNode<T> *p)
     }
 }
 
-template <class T>
-void DLList<T>::deleteNodeFromHead()
+template <class T, class Alloc>
+void DLList<T, Alloc>::deleteNodeFromHead()
 {
     if(tail == 0 || head == 0)
         throw std::runtime_error("List is empty");
     DLLNode<T>* n = head;
     DLLNode<T>* next = n->next;
-    delete head;
+    destroyNode(nodeAlloc, head);
     next->prev = 0;
     head = next;
 }
 
-template <class T>
-void DLList<T>::deleteNodeFromTail()
+template <class T, class Alloc>
+void DLList<T, Alloc>::deleteNodeFromTail()
 {
     if(tail == 0 || head == 0)
         throw std::runtime_error("List is empty");
     DLLNode<T>* n = tail;
     DLLNode<T>* prev = n->prev;
-    delete tail;
+    destroyNode(nodeAlloc, tail);
     prev->next = 0;
     tail = prev;
 }
 
-template <class T>
-void DLList<T>::insertNodeBetween(DLLNode<T>* successor, DLLNode<T>* predecessor, const T& el)
+template <class T, class Alloc>
+void DLList<T, Alloc>::insertNodeBetween(DLLNode<T>* successor, DLLNode<T>* predecessor, const T& el)
 {
     if(tail == 0 || head == 0)
         throw std::runtime_error("List is empty");
@@ -209,14 +226,14 @@ void DLList<T>::insertNodeBetween(DLLNode<T>* successor, DLLNode<T>* predecessor
 
     if(successor == n) // was head
     {
-        DLLNode<T>* newNode = new DLLNode<T>(el, successor, 0);
+        DLLNode<T>* newNode = constructNode(nodeAlloc, el, successor, nullptr);
         successor->prev = newNode;
         head = newNode;
         return;
     }
     else if(predecessor == tail) // was tail
     {
-        DLLNode<T>* newNode = new DLLNode<T>(el, 0, predecessor);
+        DLLNode<T>* newNode = constructNode(nodeAlloc, el, nullptr, predecessor);
         predecessor->next = newNode;
         tail = newNode;
         return;
@@ -225,7 +242,7 @@ void DLList<T>::insertNodeBetween(DLLNode<T>* successor, DLLNode<T>* predecessor
     {
         if(n == successor)
         {
-            DLLNode<T>* newNode = new DLLNode<T>(el, successor, predecessor);
+            DLLNode<T>* newNode = constructNode(nodeAlloc, el, successor, predecessor);
             successor->prev = newNode;
             predecessor->next = newNode;
             return;
@@ -234,39 +251,39 @@ void DLList<T>::insertNodeBetween(DLLNode<T>* successor, DLLNode<T>* predecessor
     }
 }
 
-template <class T>
-void DLList<T>::insertNodeFromHead(const T& el)
+template <class T, class Alloc>
+void DLList<T, Alloc>::insertNodeFromHead(const T& el)
 {
     if(tail == 0 || head == 0)
     {
-        DLLNode<T>* newNode = new DLLNode<T>(el, 0, 0);
+        DLLNode<T>* newNode = constructNode(nodeAlloc, el, nullptr, nullptr);
         head = newNode;
         tail = newNode;
         return;
     }
-    DLLNode<T>* newNode = new DLLNode<T>(el, head, 0);
+    DLLNode<T>* newNode = constructNode(nodeAlloc, el, head, nullptr);
     head->prev = newNode;
     head = newNode;
     
 }
 
-template <class T>
-void DLList<T>::insertNodeFromTail(const T& el)
+template <class T, class Alloc>
+void DLList<T, Alloc>::insertNodeFromTail(const T& el)
 {
     if(tail == 0 || head == 0)
     {
-        DLLNode<T>* newNode = new DLLNode<T>(el, 0, 0);
+        DLLNode<T>* newNode = constructNode(nodeAlloc, el, nullptr, nullptr);
         head = newNode;
         tail = newNode;
         return;
     }
-    DLLNode<T>* newNode = new DLLNode<T>(el, 0, tail);
+    DLLNode<T>* newNode = constructNode(nodeAlloc, el, nullptr, tail);
     tail->next = newNode;
     tail = newNode;
 }
 
-template <class T>
-void DLList<T>::organizeList(DLLNode<T>* node) 
+template <class T, class Alloc>
+void DLList<T, Alloc>::organizeList(DLLNode<T>* node) 
 {
     switch (organizeFlag)
     {
@@ -376,8 +393,8 @@ void DLList<T>::organizeList(DLLNode<T>* node)
     }
 }
 
-template <class T>
-T* DLList<T>::find(const T& el) 
+template <class T, class Alloc>
+T* DLList<T, Alloc>::find(const T& el) 
 {
     if(tail == 0 || head == 0)
         throw std::runtime_error("List is empty");
@@ -0,0 +1,144 @@
+#ifndef __CONCURRENT_SKIPLIST_TEST_H__
+#define __CONCURRENT_SKIPLIST_TEST_H__
+
+#include "../ConcurrentSkipList.h"
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Multi-threaded checks of ConcurrentSkipList. The threads insert and remove the same keys, so removes
+// land on nodes whose insert is still linking the upper levels and the node is retired by whichever of
+// the two finishes last. The elements count their own copies: once the list is gone every copy it made
+// has to be destroyed exactly once (a node retired twice or freed early also shows up under
+// AddressSanitizer). The other checks only look at what holds for every interleaving.
+//
+//     bool ok = exampleConcurrentSkipList::runInsertRemoveTest();    // 4 threads
+class exampleConcurrentSkipList {
+public:
+    static bool runInsertRemoveTest(int threads = 4, int keys = 20000) {
+        if (threads < 2)
+            threads = 2;
+        long liveBefore = Counted::live().load();
+        bool ok = true;
+        ok &= runSameKeys(threads, keys);
+        ok &= runToggle(threads, keys);
+        ok &= report(Counted::live().load() == liveBefore, "every element destroyed");
+        std::cout << (ok ? "ConcurrentSkipList insert/remove: passed" : "ConcurrentSkipList insert/remove: FAILED") << std::endl;
+        return ok;
+    }
+
+private:
+    // An int key that keeps count of how many of its copies are alive
+    struct Counted {
+        int key;
+
+        Counted(int key) : key(key) {++live();}
+        Counted(const Counted& other) : key(other.key) {++live();}
+        ~Counted() {--live();}
+        bool operator<(const Counted& other) const {return key < other.key;}
+
+        static std::atomic<long>& live() {
+            static std::atomic<long> count(0);
+            return count;
+        }
+    };
+
+    using List = VLIB::ConcurrentSkipList<Counted, 16>;
+
+    // Every thread inserts and then removes all keys, each key goes in once and out once
+    static bool runSameKeys(int threads, int keys) {
+        List list;
+        std::atomic<int> inserted(0);
+        std::atomic<int> removed(0);
+        runThreads(threads, [&](int thread) {
+            for (int i = 0; i < keys; ++i) {
+                int key = thread % 2 == 0 ? i : keys - 1 - i; // Half the threads come from the other end
+                if (list.insert(Counted(key)))
+                    ++inserted;
+            }
+        });
+        bool ok = inserted.load() == keys && list.size() == static_cast<std::size_t>(keys);
+        int expected = 0;
+        list.for_each([&](const Counted& value) {
+            ok &= value.key == expected;
+            ++expected;
+        });
+        ok &= expected == keys;
+
+        runThreads(threads, [&](int thread) {
+            for (int i = 0; i < keys; ++i) {
+                int key = thread % 2 == 0 ? i : keys - 1 - i;
+                if (list.remove(Counted(key)))
+                    ++removed;
+            }
+        });
+        ok &= removed.load() == keys && list.empty();
+        for (int key = 0; key < keys; ++key)
+            ok &= !list.contains(Counted(key));
+        return report(ok, "same keys");
+    }
+
+    // Threads insert and remove a small shared set of keys while a reader looks them up, a remove often
+    // hits a node whose insert has not finished. The successful calls give the final content.
+    static bool runToggle(int threads, int operations) {
+        const int keySpace = 64;
+        List list;
+        std::atomic<int> net(0);
+        std::atomic<bool> writing(true);
+        std::thread reader([&]() {
+            std::size_t found = 0; // Kept so the lookups are not optimized away
+            while (writing.load())
+                for (int key = 0; key < keySpace; ++key)
+                    found += list.contains(Counted(key)) ? 1 : 0;
+            (void)found;
+        });
+        runThreads(threads, [&](int thread) {
+            for (int i = 0; i < operations; ++i) {
+                int key = (i * 7 + thread) % keySpace;
+                if (i % 2 == 1) {
+                    if (list.remove(Counted(key)))
+                        --net;
+                } else if (list.insert(Counted(key))) {
+                    ++net;
+                }
+            }
+        });
+        writing = false;
+        reader.join();
+
+        std::size_t present = 0;
+        for (int key = 0; key < keySpace; ++key)
+            present += list.contains(Counted(key)) ? 1 : 0;
+        int previous = -1;
+        std::size_t listed = 0;
+        bool ok = true;
+        list.for_each([&](const Counted& value) {
+            ok &= value.key > previous;
+            previous = value.key;
+            ++listed;
+        });
+        ok &= net.load() >= 0 && list.size() == static_cast<std::size_t>(net.load()) && present == list.size() && listed == present;
+        return report(ok, "toggle");
+    }
+
+    template <class Body>
+    static void runThreads(int threads, Body body) {
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (int thread = 0; thread < threads; ++thread)
+            workers.emplace_back(body, thread);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    static bool report(bool ok, const char* name) {
+        if (!ok)
+            std::cout << "ConcurrentSkipList " << name << ": FAILED" << std::endl;
+        return ok;
+    }
+};
+
+
+#endif // __CONCURRENT_SKIPLIST_TEST_H__
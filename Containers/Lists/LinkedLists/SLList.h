@@ -2,7 +2,10 @@
 #define __SLLIST_H__
 
 #include <iostream>
-#include "../../../flags.h"
+#include <memory>
+#include "../../../Flags.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
 
 /*
     A singly linked list, which is a list that is made up of nodes that have a pointer to the next node.
@@ -10,6 +13,9 @@
 
     Initialization:
         SLList<int> list;
+        SLList<int, MyAllocator<int>> list(alloc); // nodes come from alloc
+
+    Nodes come from a PoolAllocator (slab pool per list) unless another allocator is given.
 */
 
 namespace VLIB {
@@ -31,15 +37,18 @@ public:
 
 /// LIST CLASS ///
 
-template <class T>
+template <class T, class Alloc = PoolAllocator<T>>
 class SLList {
 protected:
     VLIB::selfOrganizingListFlags organizeFlag;
     SLNode<T>* head;
+    NodeAllocatorFor<Alloc, SLNode<T>> nodeAlloc;
 
 public:
-    SLList() : head(nullptr), organizeFlag(VLIB::NO_FLAG) {}
-    SLList(VLIB::selfOrganizingListFlags flag) : head(nullptr), organizeFlag(flag) {}
+    SLList() : organizeFlag(VLIB::NO_FLAG), head(nullptr), nodeAlloc(Alloc()) {}
+    SLList(VLIB::selfOrganizingListFlags flag) : organizeFlag(flag), head(nullptr), nodeAlloc(Alloc()) {}
+    explicit SLList(const Alloc& alloc) : organizeFlag(VLIB::NO_FLAG), head(nullptr), nodeAlloc(alloc) {}
+    SLList(VLIB::selfOrganizingListFlags flag, const Alloc& alloc) : organizeFlag(flag), head(nullptr), nodeAlloc(alloc) {}
     ~SLList();
 
     int isEmpty() const { return head == nullptr; }
@@ -49,18 +58,20 @@ public:
     T* find(const T& el); // find the first node with the given info
 };
 
-template <class T>
-SLList<T>::~SLList() {
+template <class T, class Alloc>
+SLList<T, Alloc>::~SLList() {
+    if (tryReleaseAllNodes(nodeAlloc)) // pooled nodes are dropped chunk by chunk
+        return;
     SLNode<T>* current = head;
     while (current != nullptr) {
         SLNode<T>* temp = current;
         current = current->next;
-        delete temp;
+        destroyNode(nodeAlloc, temp);
     }
 }
 
-template <class T>
-void SLList<T>::printAll() const {
+template <class T, class Alloc>
+void SLList<T, Alloc>::printAll() const {
     SLNode<T>* current = head;
     while (current != nullptr) {
         std::cout << current->info << " ";
@@ -68,9 +79,9 @@ void SLList<T>::printAll() const {
     }
 }
 
-template <class T>
-void SLList<T>::insertNode(const T& el) {
-    SLNode<T>* newNode = new SLNode<T>(el);
+template <class T, class Alloc>
+void SLList<T, Alloc>::insertNode(const T& el) {
+    SLNode<T>* newNode = constructNode(nodeAlloc, el);
     if (head == nullptr) {
         head = newNode;
     } else {
@@ -79,22 +90,22 @@ void SLList<T>::insertNode(const T& el) {
     }
 }
 
-template <class T>
-void SLList<T>::deleteNode(const T& el) {
+template <class T, class Alloc>
+void SLList<T, Alloc>::deleteNode(const T& el) {
     if (head == nullptr)
         return;
 
     if (head->info == el) {
         SLNode<T>* temp = head;
         head = head->next;
-        delete temp;
+        destroyNode(nodeAlloc, temp);
     } else {
         SLNode<T>* prevNode = head;
         SLNode<T>* current = head->next;
         while (current != nullptr) {
             if (current->info == el) {
                 prevNode->next = current->next;
-                delete current;
+                destroyNode(nodeAlloc, current);
                 break;
             }
             prevNode = current;
@@ -103,8 +114,8 @@ void SLList<T>::deleteNode(const T& el) {
     }
 }
 
-template <class T>
-T* SLList<T>::find(const T& el) {
+template <class T, class Alloc>
+T* SLList<T, Alloc>::find(const T& el) {
     SLNode<T>* current = head;
     while (current != nullptr) {
         if (current->info == el)
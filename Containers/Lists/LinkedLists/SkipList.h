@@ -1,9 +1,20 @@
 #ifndef VLIB_SKIPLIST_H
 #define VLIB_SKIPLIST_H
 #include <iostream>
-#include <cstdlib>
-#include <cmath>
+#include <algorithm>
 #include <cstring>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "SkipListLevel.h"
+#include "../../Compare.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
 
 /*
     A skip list is a data structure that allows fast search within an ordered sequence of elements.
@@ -13,154 +24,398 @@
     The elements that are skipped over may be chosen probabilistically or deterministically, with the former being more common.
 
     Initialization:
-        skipList<int> list;
+        skipList<int> list(6);
+        skipList<int, MyAllocator<int>> list(6, alloc); // nodes come from alloc
+        skipList<std::string, PoolAllocator<std::string>, std::less<>> names(16); // lookups also take std::string_view
+
+    Ordered access:
+        for (const int &x : list) ...                      // ascending
+        auto window = list.range(from, to);                 // [first, last) over every element in [from, to]
+        list.lower_bound(x); list.upper_bound(x);           // first element >= x / > x
+        list.rank(x);                                       // how many elements are < x, O(log n)
+        list.select(k);                                     // iterator to the k-th smallest (0 based), O(log n)
+
+    Elements are ordered by Compare (std::less<T> by default). With a transparent Compare (see Compare.h)
+    contains, search, lower_bound, upper_bound, range and rank take any type it compares with T.
+
+    Every link also stores its span, the number of level 0 steps it skips, that is what makes rank and
+    select logarithmic.
+
+    The constructor argument is the highest level of this list (at most 63), a node gets level l with
+    probability 1/2^(l+1). A node and its links are one allocation, the links trail the node. Nodes come
+    from a PoolAllocator (slab pools per list) unless another allocator is given.
 */
 
 namespace VLIB {
 
-uint8_t MAX_LEVEL = 6;
-const float P = 0.5;
-
 // NODE Class DECLARATION //
+// forw is the start of lvl + 1 links, the node is allocated with room for all of them behind it,
+// followed by the lvl + 1 spans of those links
 template <class T>
 class snode {
 public:
     T value;
-    snode<T> **forw;
-    snode(int lvl, const T &val) {
-        value = val;
-        forw = new snode<T>*[lvl + 1];
+    int lvl;
+    snode<T> *forw[1];
+    snode(int lvl, const T &val) : value(val), lvl(lvl) {
         memset(forw, 0, sizeof(snode<T>*) * (lvl + 1));
+        memset(span(), 0, sizeof(std::size_t) * (lvl + 1));
     }
-    ~snode() {
-        delete[] forw;
-    }
+    // span()[i] is the number of level 0 steps forw[i] skips, up to the end of the list when it is NULL
+    std::size_t *span() { return reinterpret_cast<std::size_t*>(forw + lvl + 1); }
 };
 
-// SKIPLIST CLASS DECLARATION //
+// Forward iterator over the values of a skipList in ascending order, the values are read only
 template <class T>
+class skipListIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    skipListIterator() : node(NULL) {}
+    explicit skipListIterator(snode<T> *node) : node(node) {}
+
+    const T& operator*() const { return node->value; }
+    const T* operator->() const { return &node->value; }
+    skipListIterator& operator++() { node = node->forw[0]; return *this; }
+    skipListIterator operator++(int) { skipListIterator old = *this; node = node->forw[0]; return old; }
+
+    bool operator==(const skipListIterator& other) const { return node == other.node; }
+    bool operator!=(const skipListIterator& other) const { return node != other.node; }
+
+    snode<T>* getNode() const { return node; }
+
+private:
+    snode<T> *node;
+};
+
+// SKIPLIST CLASS DECLARATION //
+template <class T, class Alloc = PoolAllocator<T>, class Compare = std::less<T>>
 class skipList
 {
+    // nodes are allocated in units of their own alignment, enough units to hold the trailing links
+    using unit = typename std::aligned_storage<alignof(snode<T>), alignof(snode<T>)>::type;
+    static constexpr int LEVEL_LIMIT = 63;
+
+    NodeAllocatorFor<Alloc, unit> nodeAlloc;
+    int max_lvl;
+    std::size_t count;
+    Compare comp;
+    static std::size_t nodeUnits(int lvl)
+    {
+        return (sizeof(snode<T>) + lvl * sizeof(snode<T>*) + (lvl + 1) * sizeof(std::size_t) + sizeof(unit) - 1) / sizeof(unit);
+    }
+    snode<T>* createNode(int lvl, const T &val);
+    void destroyNode(snode<T> *x);
+    bool releaseAll();
+    template <class K>
+    snode<T>* lastBefore(const K &val, bool orEqual) const;
+    template <class K>
+    bool containsKey(const K &val) const;
+    template <class K>
+    std::size_t rankOf(const K &val) const;
+
+    // A finger is the update[] path of the last key looked up, with the level 0 position of every entry
+    struct finger
+    {
+        snode<T> *update[LEVEL_LIMIT + 1];
+        std::size_t position[LEVEL_LIMIT + 1];
+    };
+    void resetFinger(finger &f) const;
+    void advanceFinger(finger &f, const T &val) const;
+    bool insertAtFinger(finger &f, const T &val);
+
     public:
+    using iterator = skipListIterator<T>;
+    using const_iterator = skipListIterator<T>;
+
     snode<T> *header;
     T value;
     int level;
-    skipList(uint8_t max_lvl) 
+    skipList(uint8_t max_lvl, const Alloc &alloc = Alloc(), const Compare &comp = Compare())
+        : nodeAlloc(alloc), max_lvl(max_lvl < LEVEL_LIMIT ? max_lvl : LEVEL_LIMIT), count(0), comp(comp)
     {
-        MAX_LEVEL = max_lvl;
-        header = new snode<T>(MAX_LEVEL, value);
+        header = createNode(this->max_lvl, value);
         level = 0;
     }
     ~skipList() 
     {
+        if (releaseAll()) // pooled nodes are dropped chunk by chunk
+            return;
         clear();
-        delete header;
+        destroyNode(header);
     }
+    int maxLevel() const { return max_lvl; }
     void display();
     void displayStructure();
-    bool contains(const T &); 
-    snode<T>* search(const T &);
+    bool contains(const T &val) { return containsKey(val); }
+    snode<T>* search(const T &val) { return lastBefore(val, false)->forw[0]; } // first node not less than val
     void insert_element(const T &);
     void delete_element(const T &);       
+    template <class InputIt>
+    std::size_t insert_batch(InputIt first, InputIt last);          // returns how many were new
+    template <class InputIt>
+    std::vector<bool> contains_batch(InputIt first, InputIt last); // one answer per key, in input order
     snode<T>* getHead() const; 
     void clear();
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // ordered access
+    iterator begin() const { return iterator(header->forw[0]); }
+    iterator end() const { return iterator(); }
+    iterator lower_bound(const T &val) const { return iterator(lastBefore(val, false)->forw[0]); } // first element not less than val
+    iterator upper_bound(const T &val) const { return iterator(lastBefore(val, true)->forw[0]); }  // first element greater than val
+    std::pair<iterator, iterator> range(const T &lo, const T &hi) const { return rangeOf(lo, hi); } // every element in [lo, hi]
+    std::size_t rank(const T &val) const { return rankOf(val); } // number of elements less than val
+    iterator select(std::size_t k) const;  // k-th smallest element (0 based), end() when k >= size()
+
+    // heterogeneous lookups, only with a transparent Compare
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    bool contains(const K &val) const { return containsKey(val); }
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    snode<T>* search(const K &val) const { return lastBefore(val, false)->forw[0]; }
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    iterator lower_bound(const K &val) const { return iterator(lastBefore(val, false)->forw[0]); }
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    iterator upper_bound(const K &val) const { return iterator(lastBefore(val, true)->forw[0]); }
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    std::pair<iterator, iterator> range(const K &lo, const K &hi) const { return rangeOf(lo, hi); }
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    std::size_t rank(const K &val) const { return rankOf(val); }
 
     // comparison operators
-    bool operator==(const skipList<T>& other) const{return this->value == other.value;}
-    bool operator!=(const skipList<T>& other) const{return this->value != other.value;}
-    bool operator<(const skipList<T>& other) const{return this->value < other.value;}
-    bool operator>(const skipList<T>& other) const{return this->value > other.value;}
-    bool operator<=(const skipList<T>& other) const{return this->value <= other.value;}
-    bool operator>=(const skipList<T>& other) const{return this->value >= other.value;}
-    
+    bool operator==(const skipList& other) const{return this->value == other.value;}
+    bool operator!=(const skipList& other) const{return this->value != other.value;}
+    bool operator<(const skipList& other) const{return this->value < other.value;}
+    bool operator>(const skipList& other) const{return this->value > other.value;}
+    bool operator<=(const skipList& other) const{return this->value <= other.value;}
+    bool operator>=(const skipList& other) const{return this->value >= other.value;}
+
+    private:
+    template <class K>
+    std::pair<iterator, iterator> rangeOf(const K &lo, const K &hi) const;
 };
 
 // SKIPLIST CLASS IMPLEMENTATION // 
 
-// random value generator function
-float frand() 
+/*
+ * Allocate a node together with its lvl + 1 links through the list allocator
+ */
+template <class T, class Alloc, class Compare>
+snode<T>* skipList<T, Alloc, Compare>::createNode(int lvl, const T &val)
+{
+    using Traits = std::allocator_traits<NodeAllocatorFor<Alloc, unit>>;
+    unit *memory = Traits::allocate(nodeAlloc, nodeUnits(lvl));
+    try
+    {
+        return new (static_cast<void*>(memory)) snode<T>(lvl, val);
+    }
+    catch (...)
+    {
+        Traits::deallocate(nodeAlloc, memory, nodeUnits(lvl));
+        throw;
+    }
+}
+
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::destroyNode(snode<T> *x)
 {
-    return (float) rand() / RAND_MAX;
+    using Traits = std::allocator_traits<NodeAllocatorFor<Alloc, unit>>;
+    std::size_t units = nodeUnits(x->lvl);
+    x->~snode<T>();
+    Traits::deallocate(nodeAlloc, reinterpret_cast<unit*>(x), units);
+}
+
+// Frees every node at once when the allocator can and no destructor would be skipped
+template <class T, class Alloc, class Compare>
+bool skipList<T, Alloc, Compare>::releaseAll()
+{
+    if (!std::is_trivially_destructible<snode<T>>::value)
+        return false;
+    return tryReleaseAllNodes(nodeAlloc);
 }
  
-// Random Level Generator
-int random_level() 
+/*
+ * Finger search: a fresh finger sits on the header, advancing it to a key not smaller than the
+ * previous one climbs only as high as the distance requires and walks down from there
+ */
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::resetFinger(finger &f) const
 {
-    static bool first = true;
-    if (first) 
+    for (int i = 0;i <= max_lvl;i++) 
     {
-        srand((unsigned)time(NULL));
-        first = false;
+        f.update[i] = header;
+        f.position[i] = 0;
     }
-    int lvl = (int)(log(frand()) / log(1.-P));
-    return lvl < MAX_LEVEL ? lvl : MAX_LEVEL;
 }
- 
-/*
-* Insert Element in Skip List
-*/
-template <class T>
-void skipList<T>::insert_element(const T &value) 
+
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::advanceFinger(finger &f, const T &val) const
 {
-    snode<T> *x = header;	
-    snode<T> *update[MAX_LEVEL + 1];
-    memset(update, 0, sizeof(snode<T>*) * (MAX_LEVEL + 1));
-    for (int i = level;i >= 0;i--) 
+    // the entries from the first level whose next node is not before val upwards stay as they are
+    int top = 0;
+    while (top < level && f.update[top]->forw[top] != NULL && comp(f.update[top]->forw[top]->value, val))
+    {
+        top++;
+    }
+    snode<T> *x = f.update[top];
+    std::size_t at = f.position[top];
+    for (int i = top;i >= 0;i--) 
     {
-        while (x->forw[i] != NULL && x->forw[i]->value < value) 
+        if (f.position[i] > at) // the old entry of this level is further along
         {
-            x = x->forw[i];
+            x = f.update[i];
+            at = f.position[i];
         }
-        update[i] = x; 
-    }
-    x = x->forw[0];
-    if (x == NULL || x->value != value) 
-    {        
-        int lvl = random_level();
-        if (lvl > level) 
+        while (x->forw[i] != NULL && comp(x->forw[i]->value, val)) 
         {
-            for (int i = level + 1;i <= lvl;i++) 
-            {
-                update[i] = header;
-            }
-            level = lvl;
+            at += x->span()[i];
+            x = x->forw[i];
         }
-        x = new snode<T>(lvl, value);
-        for (int i = 0;i <= lvl;i++) 
+        f.update[i] = x;
+        f.position[i] = at;
+    }
+}
+
+// Inserts val behind the finger (advanced to val) and moves the finger onto the new node
+template <class T, class Alloc, class Compare>
+bool skipList<T, Alloc, Compare>::insertAtFinger(finger &f, const T &value)
+{
+    snode<T> **update = f.update;
+    std::size_t *position = f.position;
+    snode<T> *x = update[0]->forw[0];
+    if (x != NULL && !comp(value, x->value)) 
+        return false;
+    int lvl = skiplist_random_level(max_lvl);
+    if (lvl > level) 
+    {
+        for (int i = level + 1;i <= lvl;i++) 
         {
-            x->forw[i] = update[i]->forw[i];
-            update[i]->forw[i] = x;
+            update[i] = header;
+            position[i] = 0;
+            header->span()[i] = count;
         }
+        level = lvl;
+    }
+    x = createNode(lvl, value);
+    for (int i = 0;i <= lvl;i++) 
+    {
+        x->forw[i] = update[i]->forw[i];
+        update[i]->forw[i] = x;
+        // update[i] now reaches x after position[0] - position[i] + 1 steps, x takes over the rest
+        x->span()[i] = update[i]->span()[i] - (position[0] - position[i]);
+        update[i]->span()[i] = position[0] - position[i] + 1;
+    }
+    for (int i = lvl + 1;i <= level;i++) 
+    {
+        update[i]->span()[i]++;
+    }
+    std::size_t at = position[0] + 1;
+    for (int i = 0;i <= lvl;i++) 
+    {
+        update[i] = x;
+        position[i] = at;
+    }
+    count++;
+    return true;
+}
+
+/*
+* Insert Element in Skip List
+*/
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::insert_element(const T &value) 
+{
+    finger f;
+    resetFinger(f);
+    advanceFinger(f, value);
+    insertAtFinger(f, value);
+}
+
+/*
+ * Batch insert and lookup: the keys are sorted first (skipped when they already are), every key then
+ * starts from the finger of the one before instead of from the header, O(log distance) per key
+ */
+template <class T, class Alloc, class Compare>
+template <class InputIt>
+std::size_t skipList<T, Alloc, Compare>::insert_batch(InputIt first, InputIt last)
+{
+    std::vector<T> keys(first, last);
+    if (!std::is_sorted(keys.begin(), keys.end(), comp))
+        std::sort(keys.begin(), keys.end(), comp);
+    finger f;
+    resetFinger(f);
+    std::size_t inserted = 0;
+    for (std::size_t i = 0;i < keys.size();i++) 
+    {
+        if (i > 0 && !comp(keys[i - 1], keys[i]))
+            continue; // the finger sits on the previous key now, a repeat would slip in behind it
+        advanceFinger(f, keys[i]);
+        if (insertAtFinger(f, keys[i]))
+            inserted++;
+    }
+    return inserted;
+}
+
+template <class T, class Alloc, class Compare>
+template <class InputIt>
+std::vector<bool> skipList<T, Alloc, Compare>::contains_batch(InputIt first, InputIt last)
+{
+    std::vector<T> keys(first, last);
+    std::vector<std::size_t> order(keys.size());
+    for (std::size_t i = 0;i < order.size();i++) 
+        order[i] = i;
+    if (!std::is_sorted(keys.begin(), keys.end(), comp))
+        std::sort(order.begin(), order.end(), [&keys, this](std::size_t a, std::size_t b) { return comp(keys[a], keys[b]); });
+    std::vector<bool> found(keys.size());
+    finger f;
+    resetFinger(f);
+    for (std::size_t i : order) 
+    {
+        advanceFinger(f, keys[i]);
+        snode<T> *x = f.update[0]->forw[0];
+        found[i] = x != NULL && !comp(keys[i], x->value);
     }
+    return found;
 }
  
 /*
  * Delete Element from Skip List
  */
-template <class T>
-void skipList<T>::delete_element(const T &value) 
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::delete_element(const T &value) 
 {
     snode<T> *x = header;	
-    snode<T> *update[MAX_LEVEL + 1];
-    memset (update, 0, sizeof(snode<T>*) * (MAX_LEVEL + 1));
+    snode<T> *update[LEVEL_LIMIT + 1];
     for (int i = level;i >= 0;i--) 
     {
-        while (x->forw[i] != NULL && x->forw[i]->value < value)
+        while (x->forw[i] != NULL && comp(x->forw[i]->value, value))
         {
             x = x->forw[i];
         }
         update[i] = x; 
     }
     x = x->forw[0];
-    if (x->value == value) 
+    if (x != NULL && !comp(value, x->value)) 
     {
         for (int i = 0;i <= level;i++) 
         {
-            if (update[i]->forw[i] != x)
-                break;
-            update[i]->forw[i] = x->forw[i];
+            if (update[i]->forw[i] == x)
+            {
+                update[i]->span()[i] += x->span()[i] - 1;
+                update[i]->forw[i] = x->forw[i];
+            }
+            else
+            {
+                update[i]->span()[i]--;
+            }
         }
-        delete x;
+        destroyNode(x);
+        count--;
         while (level > 0 && header->forw[level] == NULL) 
         {
             level--;
@@ -171,8 +426,8 @@ void skipList<T>::delete_element(const T &value)
 /*
  * Display Elements of Skip List
  */
-template <class T>
-void skipList<T>::display() 
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::display() 
 {
     const snode<T> *x = header->forw[0];
     while (x != NULL) 
@@ -188,42 +443,20 @@ void skipList<T>::display()
 /*
  * Search Elemets in Skip List
  */
-template <class T>
-bool skipList<T>::contains(const T &s_value) 
-{
-    snode<T> *x = header;
-    for (int i = level;i >= 0;i--) 
-    {
-        while (x->forw[i] != NULL && x->forw[i]->value < s_value)
-        {
-            x = x->forw[i];
-        }
-    }
-    x = x->forw[0];
-    return x != NULL && x->value == s_value;
-}
-
-template <class T>
-snode<T>* skipList<T>::search(const T &s_value) 
+template <class T, class Alloc, class Compare>
+template <class K>
+bool skipList<T, Alloc, Compare>::containsKey(const K &s_value) const
 {
-    snode<T> *x = header;
-    for (int i = level;i >= 0;i--) 
-    {
-        while (x->forw[i] != NULL && x->forw[i]->value < s_value)
-        {
-            x = x->forw[i];
-        }
-    }
-    x = x->forw[0];
-    return x;
+    snode<T> *x = lastBefore(s_value, false)->forw[0];
+    return x != NULL && !comp(s_value, x->value);
 }
 
 /*
  * Display Elements of Skip List with Level
  */
 
-template <class T>
-void skipList<T>::displayStructure() 
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::displayStructure() 
 {
     for (int i = 0;i <= level;i++) 
     {
@@ -244,8 +477,8 @@ void skipList<T>::displayStructure()
 }
 
 
-template <class T>
-snode<T>* skipList<T>::getHead() const
+template <class T, class Alloc, class Compare>
+snode<T>* skipList<T, Alloc, Compare>::getHead() const
 {
     return header;
 }
@@ -254,18 +487,92 @@ snode<T>* skipList<T>::getHead() const
  * Clear Elements of Skip List
  */
 
-template <class T>
-void skipList<T>::clear() 
+template <class T, class Alloc, class Compare>
+void skipList<T, Alloc, Compare>::clear() 
 {
+    if (releaseAll()) // pooled nodes are dropped chunk by chunk, the header included
+    {
+        header = createNode(max_lvl, value);
+        level = 0;
+        count = 0;
+        return;
+    }
     snode<T> *x = header->forw[0];
     while (x != NULL) 
     {
         snode<T> *next = x->forw[0];
-        delete x;
+        destroyNode(x);
         x = next;
     }
-    memset(header->forw, 0, sizeof(snode<T>*) * (MAX_LEVEL + 1));
+    memset(header->forw, 0, sizeof(snode<T>*) * (max_lvl + 1));
+    memset(header->span(), 0, sizeof(std::size_t) * (max_lvl + 1));
     level = 0;
+    count = 0;
+}
+
+/*
+ * Last node before val (or before everything greater than val when orEqual), the header if there is none
+ */
+template <class T, class Alloc, class Compare>
+template <class K>
+snode<T>* skipList<T, Alloc, Compare>::lastBefore(const K &val, bool orEqual) const
+{
+    snode<T> *x = header;
+    for (int i = level;i >= 0;i--) 
+    {
+        while (x->forw[i] != NULL && (comp(x->forw[i]->value, val) || (orEqual && !comp(val, x->forw[i]->value))))
+        {
+            x = x->forw[i];
+        }
+    }
+    return x;
+}
+
+template <class T, class Alloc, class Compare>
+template <class K>
+std::pair<typename skipList<T, Alloc, Compare>::iterator, typename skipList<T, Alloc, Compare>::iterator> skipList<T, Alloc, Compare>::rangeOf(const K &lo, const K &hi) const
+{
+    if (comp(hi, lo))
+        return std::make_pair(end(), end());
+    return std::make_pair(iterator(lastBefore(lo, false)->forw[0]), iterator(lastBefore(hi, true)->forw[0]));
+}
+
+/*
+ * Rank and select add up the spans of the links taken on the way down
+ */
+template <class T, class Alloc, class Compare>
+template <class K>
+std::size_t skipList<T, Alloc, Compare>::rankOf(const K &val) const
+{
+    snode<T> *x = header;
+    std::size_t position = 0;
+    for (int i = level;i >= 0;i--) 
+    {
+        while (x->forw[i] != NULL && comp(x->forw[i]->value, val))
+        {
+            position += x->span()[i];
+            x = x->forw[i];
+        }
+    }
+    return position;
+}
+
+template <class T, class Alloc, class Compare>
+typename skipList<T, Alloc, Compare>::iterator skipList<T, Alloc, Compare>::select(std::size_t k) const
+{
+    if (k >= count)
+        return end();
+    snode<T> *x = header;
+    std::size_t position = 0; // the element k sits at position k + 1
+    for (int i = level;i >= 0;i--) 
+    {
+        while (x->forw[i] != NULL && position + x->span()[i] <= k + 1)
+        {
+            position += x->span()[i];
+            x = x->forw[i];
+        }
+    }
+    return iterator(x);
 }
 }
 #endif
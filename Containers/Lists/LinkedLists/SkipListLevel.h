@@ -0,0 +1,48 @@
+#ifndef VLIB_SKIPLIST_LEVEL_H
+#define VLIB_SKIPLIST_LEVEL_H
+
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+/*
+    Random node levels for the skip lists.
+
+    A level is the number of trailing zero bits of a random word, so level l comes up with probability
+    1/2^(l+1), the p = 1/2 of the textbook skip list, without log() or a division. The random words come
+    from a xorshift64* generator per thread, rand() shares one state behind a lock and is far too slow
+    (and racy) once several threads insert at once.
+*/
+
+namespace VLIB {
+
+// xorshift64*, seeded per thread from its id
+inline std::uint64_t skiplist_random()
+{
+    thread_local std::uint64_t state = (std::hash<std::thread::id>()(std::this_thread::get_id()) | 1) * 0x9E3779B97F4A7C15ull;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+// Level in [0, max_level], P(level >= l) = 1/2^l
+inline int skiplist_random_level(int max_level)
+{
+    std::uint64_t bits = skiplist_random() | (max_level < 63 ? (1ull << max_level) : (1ull << 63));
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int level = 0;
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        ++level;
+    }
+    return level;
+#endif
+}
+
+} // namespace VLIB
+
+#endif // VLIB_SKIPLIST_LEVEL_H
@@ -0,0 +1,285 @@
+#ifndef VLIB_SKIPLIST_MAP_H
+#define VLIB_SKIPLIST_MAP_H
+#include <cstring>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "SkipListLevel.h"
+#include "../../Compare.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
+#include "../../../Memory/MonotonicArena.h"
+
+/*
+    Key/value flavour of skipList, keys are unique.
+
+    A node holds the key, a pointer to the value and its links (one allocation, the links trail the
+    node), the value itself lives in its own allocation. A search only walks keys and links, the
+    values are never copied or moved: find returns a pointer that stays valid until the key is erased.
+
+    Initialization:
+        SkipListMap<long, Sample> map;                // highest level 16
+        SkipListMap<long, Sample> map(24);            // highest level 24
+        SkipListMap<long, Sample, MyAllocator<long>> map(16, alloc); // nodes and values come from alloc
+
+        map.try_emplace(t, reading, unit);            // Sample(reading, unit) is only built when t is new
+        if (Sample *sample = map.find(t)) ...
+        map.for_each([](const long &t, Sample &s) { ... });   // ascending keys
+
+    Keys are ordered by Compare (std::less<K> by default), with a transparent one find, contains and
+    erase take any type it compares with K (see Compare.h).
+
+    Nodes come from a PoolAllocator (slab pools per map) unless another allocator is given, values come
+    from the same pools (std::allocator in arena mode, see SideAllocatorFor).
+*/
+
+namespace VLIB {
+
+// NODE Class DECLARATION //
+// forw is the start of lvl + 1 links, the node is allocated with room for all of them behind it
+template <class K, class V>
+class smapnode {
+public:
+    K key;
+    V *value;
+    int lvl;
+    smapnode<K, V> *forw[1];
+    smapnode(int lvl, const K &key, V *value) : key(key), value(value), lvl(lvl) {
+        memset(forw, 0, sizeof(smapnode<K, V>*) * (lvl + 1));
+    }
+};
+
+// SKIPLIST MAP CLASS DECLARATION //
+template <class K, class V, class Alloc = PoolAllocator<K>, class Compare = std::less<K>>
+class SkipListMap
+{
+    using node = smapnode<K, V>;
+    using unit = typename std::aligned_storage<alignof(node), alignof(node)>::type;
+    static constexpr int LEVEL_LIMIT = 63;
+
+    NodeAllocatorFor<Alloc, unit> nodeAlloc;
+    int max_lvl;
+    int level;
+    std::size_t count;
+    Compare comp;
+    node *head[LEVEL_LIMIT + 1]; // links of the header, the header has no key
+
+    static std::size_t nodeUnits(int lvl) { return (sizeof(node) + lvl * sizeof(node*) + sizeof(unit) - 1) / sizeof(unit); }
+    node* createNode(int lvl, const K &key, V *value);
+    void destroyNode(node *x);
+    template <class Key>
+    node** findLinks(const Key &key, node ***update) const; // update[i]: links of the last node before key on level i
+    template <class Key>
+    V* findValue(const Key &key) const;
+    template <class Key>
+    bool eraseKey(const Key &key);
+
+    public:
+    explicit SkipListMap(uint8_t max_lvl = 16, const Alloc &alloc = Alloc(), const Compare &comp = Compare())
+        : nodeAlloc(alloc), max_lvl(max_lvl < LEVEL_LIMIT ? max_lvl : LEVEL_LIMIT), level(0), count(0), comp(comp)
+    {
+        memset(head, 0, sizeof(head));
+    }
+    ~SkipListMap() { clear(); }
+
+    SkipListMap(const SkipListMap &) = delete;
+    SkipListMap &operator=(const SkipListMap &) = delete;
+
+    template <class... Args>
+    std::pair<V*, bool> try_emplace(const K &key, Args&&... args); // value built from args only when key is new
+    template <class M>
+    std::pair<V*, bool> insert_or_assign(const K &key, M &&value);
+    V &operator[](const K &key) { return *try_emplace(key).first; }
+    V* find(const K &key) { return findValue(key); }
+    const V* find(const K &key) const { return findValue(key); }
+    bool contains(const K &key) const { return findValue(key) != NULL; }
+    bool erase(const K &key) { return eraseKey(key); }
+    // heterogeneous lookups, only with a transparent Compare
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    V* find(const Key &key) { return findValue(key); }
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    const V* find(const Key &key) const { return findValue(key); }
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    bool contains(const Key &key) const { return findValue(key) != NULL; }
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    bool erase(const Key &key) { return eraseKey(key); }
+    void clear();
+    template <class Fn>
+    void for_each(Fn fn); // fn(const K&, V&) in key order
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int maxLevel() const { return max_lvl; }
+};
+
+// Arena construction mode, see MonotonicArena.h
+template <class K, class V, class Compare = std::less<K>>
+using ArenaSkipListMap = SkipListMap<K, V, ArenaAllocator<K>, Compare>;
+
+// SKIPLIST MAP CLASS IMPLEMENTATION //
+
+template <class K, class V, class Alloc, class Compare>
+smapnode<K, V>* SkipListMap<K, V, Alloc, Compare>::createNode(int lvl, const K &key, V *value)
+{
+    using Traits = std::allocator_traits<NodeAllocatorFor<Alloc, unit>>;
+    unit *memory = Traits::allocate(nodeAlloc, nodeUnits(lvl));
+    try
+    {
+        return new (static_cast<void*>(memory)) node(lvl, key, value);
+    }
+    catch (...)
+    {
+        Traits::deallocate(nodeAlloc, memory, nodeUnits(lvl));
+        throw;
+    }
+}
+
+// Frees the value too
+template <class K, class V, class Alloc, class Compare>
+void SkipListMap<K, V, Alloc, Compare>::destroyNode(node *x)
+{
+    using Traits = std::allocator_traits<NodeAllocatorFor<Alloc, unit>>;
+    auto valueAlloc = sideAllocator<V>(nodeAlloc);
+    VLIB::destroyNode(valueAlloc, x->value);
+    std::size_t units = nodeUnits(x->lvl);
+    x->~node();
+    Traits::deallocate(nodeAlloc, reinterpret_cast<unit*>(x), units);
+}
+
+/*
+ * Returns the level 0 links of the last node before key, fills update when given
+ */
+template <class K, class V, class Alloc, class Compare>
+template <class Key>
+smapnode<K, V>** SkipListMap<K, V, Alloc, Compare>::findLinks(const Key &key, node ***update) const
+{
+    node **links = const_cast<node**>(head);
+    for (int i = level;i >= 0;i--)
+    {
+        while (links[i] != NULL && comp(links[i]->key, key))
+        {
+            links = links[i]->forw;
+        }
+        if (update != NULL)
+            update[i] = links;
+    }
+    return links;
+}
+
+template <class K, class V, class Alloc, class Compare>
+template <class Key>
+V* SkipListMap<K, V, Alloc, Compare>::findValue(const Key &key) const
+{
+    node *x = findLinks(key, NULL)[0];
+    return x != NULL && !comp(key, x->key) ? x->value : NULL;
+}
+
+template <class K, class V, class Alloc, class Compare>
+template <class... Args>
+std::pair<V*, bool> SkipListMap<K, V, Alloc, Compare>::try_emplace(const K &key, Args&&... args)
+{
+    node **update[LEVEL_LIMIT + 1];
+    node *x = findLinks(key, update)[0];
+    if (x != NULL && !comp(key, x->key))
+        return std::make_pair(x->value, false);
+
+    auto valueAlloc = sideAllocator<V>(nodeAlloc);
+    V *value = constructNode(valueAlloc, std::forward<Args>(args)...);
+    int lvl = skiplist_random_level(max_lvl);
+    try
+    {
+        x = createNode(lvl, key, value);
+    }
+    catch (...)
+    {
+        VLIB::destroyNode(valueAlloc, value);
+        throw;
+    }
+    if (lvl > level)
+    {
+        for (int i = level + 1;i <= lvl;i++)
+        {
+            update[i] = head;
+        }
+        level = lvl;
+    }
+    for (int i = 0;i <= lvl;i++)
+    {
+        x->forw[i] = update[i][i];
+        update[i][i] = x;
+    }
+    count++;
+    return std::make_pair(value, true);
+}
+
+template <class K, class V, class Alloc, class Compare>
+template <class M>
+std::pair<V*, bool> SkipListMap<K, V, Alloc, Compare>::insert_or_assign(const K &key, M &&value)
+{
+    std::pair<V*, bool> result = try_emplace(key, std::forward<M>(value));
+    if (!result.second)
+        *result.first = std::forward<M>(value);
+    return result;
+}
+
+template <class K, class V, class Alloc, class Compare>
+template <class Key>
+bool SkipListMap<K, V, Alloc, Compare>::eraseKey(const Key &key)
+{
+    node **update[LEVEL_LIMIT + 1];
+    node *x = findLinks(key, update)[0];
+    if (x == NULL || comp(key, x->key))
+        return false;
+    for (int i = 0;i <= x->lvl;i++)
+    {
+        update[i][i] = x->forw[i];
+    }
+    destroyNode(x);
+    count--;
+    while (level > 0 && head[level] == NULL)
+    {
+        level--;
+    }
+    return true;
+}
+
+/*
+ * Values share the pools of the nodes, both are dropped in bulk when no destructor would be skipped
+ */
+template <class K, class V, class Alloc, class Compare>
+void SkipListMap<K, V, Alloc, Compare>::clear()
+{
+    bool bulk = std::is_trivially_destructible<node>::value && std::is_trivially_destructible<V>::value
+             && !IsMonotonicAllocator<Alloc>::value;
+    if (!bulk || !tryReleaseAllNodes(nodeAlloc))
+    {
+        node *x = head[0];
+        while (x != NULL)
+        {
+            node *next = x->forw[0];
+            destroyNode(x);
+            x = next;
+        }
+        releaseAllNodes(nodeAlloc);
+    }
+    memset(head, 0, sizeof(head));
+    level = 0;
+    count = 0;
+}
+
+template <class K, class V, class Alloc, class Compare>
+template <class Fn>
+void SkipListMap<K, V, Alloc, Compare>::for_each(Fn fn)
+{
+    for (node *x = head[0];x != NULL;x = x->forw[0])
+    {
+        fn(static_cast<const K&>(x->key), *x->value);
+    }
+}
+
+} // namespace VLIB
+
+#endif // VLIB_SKIPLIST_MAP_H
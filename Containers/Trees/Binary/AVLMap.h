@@ -0,0 +1,349 @@
+// AVL Map //
+
+#ifndef AVLMAP_H
+#define AVLMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "../../Compare.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
+#include "../../../Memory/MonotonicArena.h"
+
+/*
+    Key/value flavour of AVLTree.
+
+    A node holds the key, its height, the two children and a pointer to the value, the value itself
+    lives in its own allocation. Lookups and rotations only touch the small nodes, a value is built
+    once where it will stay: find returns a pointer that stays valid until the key is erased, and
+    erasing a node with two children moves its successor node into place instead of copying keys
+    or values around.
+
+    Initialization:
+        AVLMap<int, Order> map;
+        AVLMap<int, Order, MyAllocator<int>> map(alloc); // nodes and values come from alloc
+
+        map.try_emplace(7, customer, 3);      // Order(customer, 3) is only built when 7 is new
+        map.insert_or_assign(7, order);
+        if (Order *order = map.find(7)) ...
+        map[8].amount = 2;                    // default constructs the value of a new key
+        map.erase(7);
+
+    Keys are ordered by Compare (std::less<K> by default), with a transparent one find, contains and
+    erase take any type it compares with K (see Compare.h).
+
+    Nodes come from a PoolAllocator (slab pool per map) unless another allocator is given, values come
+    from the same pools (std::allocator in arena mode, see SideAllocatorFor).
+*/
+namespace VLIB{
+template <class K, class V>
+struct AVLMapNode{
+    K key;
+    int32_t height;
+    AVLMapNode *left;
+    AVLMapNode *right;
+    V *value;
+    AVLMapNode(const K &key, V *value):key(key),height(1),left(nullptr),right(nullptr),value(value){}
+};
+
+template <class K, class V, class Alloc = PoolAllocator<K>, class Compare = std::less<K>>
+class AVLMap{
+
+    private:
+    using Node = AVLMapNode<K, V>;
+
+    Node *root;
+    std::size_t count;
+    NodeAllocatorFor<Alloc, Node> nodeAlloc;
+    Compare comp;
+
+    //manage tree
+    void makeEmpty(Node *node);
+    template <class... Args>
+    Node *insert(Node *node, const K &key, Node *&found, bool &inserted, Args&&... args);
+    template <class Key>
+    Node *remove(Node *node, const Key &key, bool &removed);
+    Node *detachMin(Node *node, Node *&min);
+    template <class... Args>
+    V *createValue(Args&&... args);
+    void destroyValue(V *value);
+
+    //rotation
+    Node *rightRotation(Node *node);
+    Node *leftRotation(Node *node);
+    Node *rebalance(Node *node);
+
+    // helper functions
+    static int32_t height(Node *node){return node == nullptr ? 0 : node->height;}
+    static void updateHeight(Node *node){node->height = std::max(height(node->left), height(node->right)) + 1;}
+    template <class Key>
+    Node *findNode(const Key &key) const;
+    template <class Fn>
+    static void inorder(Node *node, Fn &fn);
+
+    public:
+
+    AVLMap():root(nullptr),count(0),nodeAlloc(Alloc()){}
+    explicit AVLMap(const Alloc& alloc, const Compare& comp = Compare()):root(nullptr),count(0),nodeAlloc(alloc),comp(comp){}
+    ~AVLMap(){clear();}
+
+    AVLMap(const AVLMap&) = delete;
+    AVLMap& operator=(const AVLMap&) = delete;
+
+    //user interactions
+    template <class... Args>
+    std::pair<V*, bool> try_emplace(const K &key, Args&&... args); // value built from args only when key is new
+    template <class M>
+    std::pair<V*, bool> insert_or_assign(const K &key, M &&value);
+    V &operator[](const K &key){return *try_emplace(key).first;}
+    V *find(const K &key){Node *node = findNode(key); return node ? node->value : nullptr;}
+    const V *find(const K &key) const{Node *node = findNode(key); return node ? node->value : nullptr;}
+    bool contains(const K &key) const{return findNode(key) != nullptr;}
+    bool erase(const K &key){bool removed = false; root = remove(root, key, removed); return removed;}
+    // heterogeneous lookups, only with a transparent Compare
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    V *find(const Key &key){Node *node = findNode(key); return node ? node->value : nullptr;}
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    const V *find(const Key &key) const{Node *node = findNode(key); return node ? node->value : nullptr;}
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    bool contains(const Key &key) const{return findNode(key) != nullptr;}
+    template <class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    bool erase(const Key &key){bool removed = false; root = remove(root, key, removed); return removed;}
+    void clear();
+    template <class Fn>
+    void for_each(Fn fn){inorder(root, fn);} // fn(const K&, V&) in key order
+
+    std::size_t size() const {return count;}
+    bool empty() const {return count == 0;}
+    Node* getRoot() const {return root;}
+};
+
+// Arena construction mode, see MonotonicArena.h
+template <class K, class V, class Compare = std::less<K>>
+using ArenaAVLMap = AVLMap<K, V, ArenaAllocator<K>, Compare>;
+
+/// PRIVATE ///
+
+    // manage tree
+    template <class K, class V, class Alloc, class Compare>
+    void AVLMap<K, V, Alloc, Compare>::makeEmpty(Node *node)
+    {
+        if(node == nullptr)
+            return;
+        makeEmpty(node->left);
+        makeEmpty(node->right);
+        destroyValue(node->value);
+        destroyNode(nodeAlloc, node);
+    }
+
+    template <class K, class V, class Alloc, class Compare>
+    template <class... Args>
+    V* AVLMap<K, V, Alloc, Compare>::createValue(Args&&... args)
+    {
+        auto valueAlloc = sideAllocator<V>(nodeAlloc);
+        return constructNode(valueAlloc, std::forward<Args>(args)...);
+    }
+
+    template <class K, class V, class Alloc, class Compare>
+    void AVLMap<K, V, Alloc, Compare>::destroyValue(V *value)
+    {
+        auto valueAlloc = sideAllocator<V>(nodeAlloc);
+        destroyNode(valueAlloc, value);
+    }
+
+    template <class K, class V, class Alloc, class Compare>
+    template <class... Args>
+    AVLMapNode<K, V>* AVLMap<K, V, Alloc, Compare>::insert(Node *node, const K &key, Node *&found, bool &inserted, Args&&... args)
+    {
+        if(node == nullptr)
+        {
+            V *value = createValue(std::forward<Args>(args)...);
+            try
+            {
+                found = constructNode(nodeAlloc, key, value);
+            }
+            catch(...)
+            {
+                destroyValue(value);
+                throw;
+            }
+            inserted = true;
+            count++;
+            return found;
+        }
+        if(comp(key, node->key))
+            node->left = insert(node->left, key, found, inserted, std::forward<Args>(args)...);
+        else if(comp(node->key, key))
+            node->right = insert(node->right, key, found, inserted, std::forward<Args>(args)...);
+        else
+        {
+            found = node;
+            return node;
+        }
+        return inserted ? rebalance(node) : node;
+    }
+
+    template <class K, class V, class Alloc, class Compare>
+    template <class Key>
+    AVLMapNode<K, V>* AVLMap<K, V, Alloc, Compare>::remove(Node *node, const Key &key, bool &removed)
+    {
+        // Element not found
+        if(node == nullptr)
+            return nullptr;
+
+        // Searching for element
+        if(comp(key, node->key))
+            node->left = remove(node->left, key, removed);
+        else if(comp(node->key, key))
+            node->right = remove(node->right, key, removed);
+
+        // Element found, the successor node takes its place when there are two children
+        else
+        {
+            Node *replacement;
+            if(node->left && node->right)
+            {
+                Node *right = detachMin(node->right, replacement);
+                replacement->left = node->left;
+                replacement->right = right;
+            }
+            else
+                replacement = node->left ? node->left : node->right;
+            destroyValue(node->value);
+            destroyNode(nodeAlloc, node);
+            removed = true;
+            count--;
+            return replacement ? rebalance(replacement) : nullptr;
+        }
+        return removed ? rebalance(node) : node;
+    }
+
+    // Unlinks the smallest node of the subtree, returns the rebalanced rest
+    template <class K, class V, class Alloc, class Compare>
+    AVLMapNode<K, V>* AVLMap<K, V, Alloc, Compare>::detachMin(Node *node, Node *&min)
+    {
+        if(node->left == nullptr)
+        {
+            min = node;
+            return node->right;
+        }
+        node->left = detachMin(node->left, min);
+        return rebalance(node);
+    }
+
+    //rotation
+    template <class K, class V, class Alloc, class Compare>
+    AVLMapNode<K, V>* AVLMap<K, V, Alloc, Compare>::rightRotation(Node *node)
+    {
+        Node *left = node->left;
+        node->left = left->right;
+        left->right = node;
+        updateHeight(node);
+        updateHeight(left);
+        return left;
+    }
+
+    template <class K, class V, class Alloc, class Compare>
+    AVLMapNode<K, V>* AVLMap<K, V, Alloc, Compare>::leftRotation(Node *node)
+    {
+        Node *right = node->right;
+        node->right = right->left;
+        right->left = node;
+        updateHeight(node);
+        updateHeight(right);
+        return right;
+    }
+
+    // Fixes the height of node and restores the balance below it, returns the new subtree root
+    template <class K, class V, class Alloc, class Compare>
+    AVLMapNode<K, V>* AVLMap<K, V, Alloc, Compare>::rebalance(Node *node)
+    {
+        updateHeight(node);
+        int32_t balance = height(node->left) - height(node->right);
+        if(balance > 1)
+        {
+            if(height(node->left->left) < height(node->left->right))
+                node->left = leftRotation(node->left);
+            return rightRotation(node);
+        }
+        if(balance < -1)
+        {
+            if(height(node->right->right) < height(node->right->left))
+                node->right = rightRotation(node->right);
+            return leftRotation(node);
+        }
+        return node;
+    }
+
+    // helper functions
+    template <class K, class V, class Alloc, class Compare>
+    template <class Key>
+    AVLMapNode<K, V>* AVLMap<K, V, Alloc, Compare>::findNode(const Key &key) const
+    {
+        Node *temp = root;
+        while(temp != nullptr)
+        {
+            if(comp(key, temp->key))
+                temp = temp->left;
+            else if(comp(temp->key, key))
+                temp = temp->right;
+            else
+                return temp;
+        }
+        return nullptr;
+    }
+
+    template <class K, class V, class Alloc, class Compare>
+    template <class Fn>
+    void AVLMap<K, V, Alloc, Compare>::inorder(Node *node, Fn &fn)
+    {
+        if(node == nullptr)
+            return;
+        inorder(node->left, fn);
+        fn(static_cast<const K&>(node->key), *node->value);
+        inorder(node->right, fn);
+    }
+
+    /// PUBLIC ///
+
+    template <class K, class V, class Alloc, class Compare>
+    template <class... Args>
+    std::pair<V*, bool> AVLMap<K, V, Alloc, Compare>::try_emplace(const K &key, Args&&... args)
+    {
+        Node *found = nullptr;
+        bool inserted = false;
+        root = insert(root, key, found, inserted, std::forward<Args>(args)...);
+        return std::make_pair(found->value, inserted);
+    }
+
+    template <class K, class V, class Alloc, class Compare>
+    template <class M>
+    std::pair<V*, bool> AVLMap<K, V, Alloc, Compare>::insert_or_assign(const K &key, M &&value)
+    {
+        std::pair<V*, bool> result = try_emplace(key, std::forward<M>(value));
+        if(!result.second)
+            *result.first = std::forward<M>(value);
+        return result;
+    }
+
+    // Values share the pools of the nodes, both are dropped in bulk when no destructor would be skipped,
+    // otherwise (or in arena mode, where values come from std::allocator) they go one by one
+    template <class K, class V, class Alloc, class Compare>
+    void AVLMap<K, V, Alloc, Compare>::clear()
+    {
+        if(!(std::is_trivially_destructible<V>::value && !IsMonotonicAllocator<Alloc>::value && tryReleaseAllNodes(nodeAlloc)))
+        {
+            makeEmpty(root);
+            releaseAllNodes(nodeAlloc);
+        }
+        root = nullptr;
+        count = 0;
+    }
+}
+
+#endif // AVLMAP_H
@@ -7,6 +7,12 @@
 #include <algorithm>
 #include <iostream>
 #include <stack>
+#include <functional>
+#include <memory>
+#include "../../Compare.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
+#include "../../../Memory/MonotonicArena.h"
 
 /*
     An AVL tree is a self-balancing binary search tree.
@@ -19,6 +25,17 @@
 
     Initialization:
         AVLTree<int> tree
+        AVLTree<int, MyAllocator<int>> tree(alloc) // nodes come from alloc
+        AVLTree<std::string, PoolAllocator<std::string>, std::less<>> tree // search also takes a std::string_view
+
+    Keys are ordered by Compare (std::less<T> by default), two keys are the same when neither orders
+    before the other. With a transparent Compare (see Compare.h) search takes any type it compares.
+
+    Nodes come from a PoolAllocator (slab pool per tree) unless another allocator is given,
+    clear() and the destructor then free the pool chunks instead of visiting every node.
+
+    Arena mode, for trees that are built once, queried and then rebuilt from scratch:
+        ArenaAVLTree<int> tree  // nodes are bumped out of a MonotonicArena, clear() resets it
 */
 namespace VLIB{
 template <class T>
@@ -30,16 +47,20 @@ struct AVLNode{
     AVLNode(T key):key(key),height(1),left(nullptr),right(nullptr){}
 };
 
-template <class T>
+template <class T, class Alloc = PoolAllocator<T>, class Compare = std::less<T>>
 class AVLTree{
 
     private: 
     AVLNode<T> *root;
+    NodeAllocatorFor<Alloc, AVLNode<T>> nodeAlloc;
+    Compare comp;
 
     //manage tree
     void makeEmpty(AVLNode<T> *node);
-    AVLNode<T> *insert(T key, AVLNode<T> *node);
-    AVLNode<T> *remove(T key, AVLNode<T> *node);
+    AVLNode<T> *insert(const T &key, AVLNode<T> *node);
+    AVLNode<T> *remove(const T &key, AVLNode<T> *node);
+    template <class K>
+    AVLNode<T> *find(const K &key) const;
 
     //rotation
     AVLNode<T>* rightRotation(AVLNode<T>* &node);
@@ -60,14 +81,17 @@ class AVLTree{
 
     public: 
 
-    AVLTree():root(nullptr){}
-    ~AVLTree(){makeEmpty(root);}
+    AVLTree():root(nullptr),nodeAlloc(Alloc()){}
+    explicit AVLTree(const Alloc& alloc, const Compare& comp = Compare()):root(nullptr),nodeAlloc(alloc),comp(comp){}
+    ~AVLTree(){clear();}
 
     //user interactions
-    void insert(T key){root = insert(key, root);}
-    void remove(T key){root = remove(key, root);}
-    AVLNode<T>* search(T key);
-    void clear(){makeEmpty(root);}
+    void insert(const T &key){root = insert(key, root);}
+    void remove(const T &key){root = remove(key, root);}
+    AVLNode<T>* search(const T &key){return find(key);}
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    AVLNode<T>* search(const K &key){return find(key);} // heterogeneous lookup, needs a transparent Compare
+    void clear(){if(!tryReleaseAllNodes(nodeAlloc)){makeEmpty(root); releaseAllNodes(nodeAlloc);} root = nullptr;}
     // debug
     void inorder(){inorder(root);}
     void preorder(){preorder(root);}
@@ -76,43 +100,47 @@ class AVLTree{
 
 };
 
+// Arena construction mode, see MonotonicArena.h
+template <class T, class Compare = std::less<T>>
+using ArenaAVLTree = AVLTree<T, ArenaAllocator<T>, Compare>;
+
 /// PRIVATE ///
 
     // manage tree
-    template <class T>
-    void AVLTree<T>::makeEmpty(AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    void AVLTree<T, Alloc, Compare>::makeEmpty(AVLNode<T> *node)
     { 
         if(node == NULL)
             return;
         makeEmpty(node->left);
         makeEmpty(node->right);
-        delete node;
+        destroyNode(nodeAlloc, node);
     }
 
-    template <class T>
-    AVLNode<T>* AVLTree<T>::insert(T key, AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::insert(const T &key, AVLNode<T> *node)
     {
         if(node == NULL)
         {
-            node = new AVLNode<T>(key);
+            node = constructNode(nodeAlloc, key);
         }
-        else if(key < node->key)
+        else if(comp(key, node->key))
         {
             node->left = insert(key, node->left);
             if(height(node->left) - height(node->right) == 2)
             {
-                if(key < node->left->key)
+                if(comp(key, node->left->key))
                     node = rightRotation(node);
                 else
                     node = doubleRight(node);
             }
         }
-        else if(key > node->key)
+        else if(comp(node->key, key))
         {
             node->right = insert(key, node->right);
             if(height(node->right) - height(node->left) == 2)
             {
-                if(key > node->right->key)
+                if(comp(node->right->key, key))
                     node = leftRotation(node);
                 else
                     node = doubleLeft(node);
@@ -122,8 +150,8 @@ class AVLTree{
         return node;
     }
 
-    template <class T>
-    AVLNode<T>* AVLTree<T>::remove(T key, AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::remove(const T &key, AVLNode<T> *node)
     {
          AVLNode<T>* temp;
 
@@ -132,9 +160,9 @@ class AVLTree{
             return NULL;
 
         // Searching for element
-        else if(key < node->key)
+        else if(comp(key, node->key))
             node->left = remove(key, node->left);
-        else if(key > node->key)
+        else if(comp(node->key, key))
             node->right = remove(key, node->right);
 
         // Element found
@@ -153,7 +181,7 @@ class AVLTree{
                 node = node->right;
             else if(node->right == NULL)
                 node = node->left;
-            delete temp;
+            destroyNode(nodeAlloc, temp);
         }
         if(node == NULL)
             return node;
@@ -185,25 +213,26 @@ class AVLTree{
         return node;
     }
 
-    template <class T>
-    AVLNode<T>* AVLTree<T>::search(T searchedKey)
+    template <class T, class Alloc, class Compare>
+    template <class K>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::find(const K &searchedKey) const
     {
         AVLNode<T>* temp = root;
         while(temp != NULL)
         {
-            if(searchedKey == temp->key)
-                return temp;
-            else if(searchedKey < temp->key)
+            if(comp(searchedKey, temp->key))
                 temp = temp->left;
-            else
+            else if(comp(temp->key, searchedKey))
                 temp = temp->right;
+            else
+                return temp;
         }
         return NULL;
     }
 
     //rotation
-    template <class T>
-    AVLNode<T>* AVLTree<T>::rightRotation(AVLNode<T>* &node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::rightRotation(AVLNode<T>* &node)
     {  
        if (node->left != NULL) {
 			AVLNode<T>* left = node->left;
@@ -216,8 +245,8 @@ class AVLTree{
 		return node;
     }
 
-    template <class T>
-    AVLNode<T>* AVLTree<T>::leftRotation(AVLNode<T>* &node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::leftRotation(AVLNode<T>* &node)
     {
         if (node->right != NULL) {
 		    AVLNode<T>* right = node->right;
@@ -230,23 +259,23 @@ class AVLTree{
             return node;
     }
 
-    template <class T>
-    AVLNode<T>* AVLTree<T>::doubleRight(AVLNode<T>* &node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::doubleRight(AVLNode<T>* &node)
     {
         node->left = leftRotation(node->left);
         return rightRotation(node);
     }
 
-    template <class T>
-    AVLNode<T>* AVLTree<T>::doubleLeft(AVLNode<T>* &node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::doubleLeft(AVLNode<T>* &node)
     {
         node->right = rightRotation(node->right);
         return leftRotation(node);
     }
 
     // helper functions
-    template <class T>
-    AVLNode<T>* AVLTree<T>::findMinValueNode(AVLNode<T>* node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::findMinValueNode(AVLNode<T>* node)
     {
         if(node == NULL)
             return NULL;
@@ -256,8 +285,8 @@ class AVLTree{
             return findMinValueNode(node->left);
     }
 
-    template <class T>
-    AVLNode<T>* AVLTree<T>::findMaxValueNode(AVLNode<T>* node)
+    template <class T, class Alloc, class Compare>
+    AVLNode<T>* AVLTree<T, Alloc, Compare>::findMaxValueNode(AVLNode<T>* node)
     {
         if(node == NULL)
             return NULL;
@@ -267,8 +296,8 @@ class AVLTree{
             return findMaxValueNode(node->right);
     }
 
-    template <class T>
-    int32_t AVLTree<T>::height(AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    int32_t AVLTree<T, Alloc, Compare>::height(AVLNode<T> *node)
     {
         if(node == NULL)
             return -1;
@@ -276,8 +305,8 @@ class AVLTree{
             return node->height;
     }
 
-    template <class T>
-    int32_t AVLTree<T>::getBalance(AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    int32_t AVLTree<T, Alloc, Compare>::getBalance(AVLNode<T> *node)
     {
         if(node == NULL)
             return 0;
@@ -286,8 +315,8 @@ class AVLTree{
     }
 
     //traversal
-    template <class T>
-    void AVLTree<T>::inorder(AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    void AVLTree<T, Alloc, Compare>::inorder(AVLNode<T> *node)
     {
         if(node == NULL)
             return;
@@ -296,8 +325,8 @@ class AVLTree{
         inorder(node->right);
     }
 
-    template <class T>
-    void AVLTree<T>::preorder(AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    void AVLTree<T, Alloc, Compare>::preorder(AVLNode<T> *node)
     {
         if(node == NULL)
             return;
@@ -306,8 +335,8 @@ class AVLTree{
         preorder(node->right);
     }
 
-    template <class T>
-    void AVLTree<T>::postorder(AVLNode<T> *node)
+    template <class T, class Alloc, class Compare>
+    void AVLTree<T, Alloc, Compare>::postorder(AVLNode<T> *node)
     {
         if(node == NULL)
             return;
@@ -0,0 +1,234 @@
+// Purpose: Key/value Binary Search Tree
+#ifndef BINARY_SEARCH_TREE_MAP
+#define BINARY_SEARCH_TREE_MAP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../../Compare.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
+#include "../../../Memory/MonotonicArena.h"
+
+/*
+    Key/value flavour of BSTree, unbalanced, keys are unique.
+
+    A node holds the key, the two children and a pointer to the value, the value itself lives in its
+    own allocation, so the search path only touches small nodes and find returns a pointer that stays
+    valid until the key is erased. Erasing a node with two children moves its successor node into
+    place, nothing is copied. Every walk is iterative, a degenerate tree (keys inserted in order)
+    does not run out of stack.
+
+    Initialization:
+        BSTMap<std::string, Entry> map;
+        BSTMap<std::string, Entry, MyAllocator<std::string>> map(alloc); // nodes and values come from alloc
+
+        map.try_emplace("k", 1, 2);   // Entry(1, 2) is only built when "k" is new
+        Entry *entry = map.find("k");
+        map.erase("k");
+
+    Keys are ordered by Compare (std::less<K> by default), with a transparent one find, contains and
+    erase take any type it compares with K (see Compare.h).
+
+    Nodes come from a PoolAllocator (slab pool per map) unless another allocator is given, values come
+    from the same pools (std::allocator in arena mode, see SideAllocatorFor).
+*/
+
+namespace VLIB{
+
+/*
+*  Binary Search Tree Map Node
+*/
+template<class K, class V>
+class BSTMapNode{
+public:
+    BSTMapNode(const K& k, V *v) : key(k), value(v), left(0), right(0) {}
+    K key;
+    V *value;
+    BSTMapNode<K, V> *left, *right;
+};
+
+/*
+*  Binary Search Tree Map
+*/
+template<class K, class V, class Alloc = PoolAllocator<K>, class Compare = std::less<K>>
+class BSTMap {
+public:
+    using Node = BSTMapNode<K, V>;
+
+    BSTMap() : root(0), count(0), nodeAlloc(Alloc()) {}
+    explicit BSTMap(const Alloc& alloc, const Compare& comp = Compare()) : root(0), count(0), nodeAlloc(alloc), comp(comp) {}
+    ~BSTMap() {clear();}
+
+    BSTMap(const BSTMap&) = delete;
+    BSTMap& operator=(const BSTMap&) = delete;
+
+    template<class... Args>
+    std::pair<V*, bool> try_emplace(const K& key, Args&&... args); // value built from args only when key is new
+    template<class M>
+    std::pair<V*, bool> insert_or_assign(const K& key, M&& value);
+    V& operator[](const K& key) {return *try_emplace(key).first;}
+    V* find(const K& key) {Node *p = *findLink(key); return p ? p->value : 0;}
+    const V* find(const K& key) const {Node *p = *const_cast<BSTMap*>(this)->findLink(key); return p ? p->value : 0;}
+    bool contains(const K& key) const {return find(key) != 0;}
+    bool erase(const K& key) {return eraseKey(key);}
+    // heterogeneous lookups, only with a transparent Compare
+    template<class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    V* find(const Key& key) {Node *p = *findLink(key); return p ? p->value : 0;}
+    template<class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    const V* find(const Key& key) const {Node *p = *const_cast<BSTMap*>(this)->findLink(key); return p ? p->value : 0;}
+    template<class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    bool contains(const Key& key) const {return find(key) != 0;}
+    template<class Key, class C = Compare, EnableIfTransparent<C> = 0>
+    bool erase(const Key& key) {return eraseKey(key);}
+    void clear();
+    template<class Fn>
+    void for_each(Fn fn); // fn(const K&, V&) in key order
+
+    std::size_t size() const {return count;}
+    bool empty() const {return count == 0;}
+    Node* getRoot() const {return root;}
+
+protected:
+    Node *root;
+    std::size_t count;
+    NodeAllocatorFor<Alloc, Node> nodeAlloc;
+    Compare comp;
+
+    template<class Key>
+    Node** findLink(const Key& key); // the link pointing at key, or the null link where it would go
+    template<class Key>
+    bool eraseKey(const Key& key);
+    void destroy(Node *p);
+};
+
+// Arena construction mode, see MonotonicArena.h
+template<class K, class V, class Compare = std::less<K>>
+using ArenaBSTMap = BSTMap<K, V, ArenaAllocator<K>, Compare>;
+
+/*
+*   Protected Methods
+*/
+
+template<class K, class V, class Alloc, class Compare>
+template<class Key>
+BSTMapNode<K, V>** BSTMap<K, V, Alloc, Compare>::findLink(const Key& key) {
+    Node **link = &root;
+    while (*link != 0)
+        if (comp(key, (*link)->key))
+             link = &(*link)->left;
+        else if (comp((*link)->key, key))
+             link = &(*link)->right;
+        else return link;
+    return link;
+}
+
+template<class K, class V, class Alloc, class Compare>
+void BSTMap<K, V, Alloc, Compare>::destroy(Node *p) {
+    auto valueAlloc = sideAllocator<V>(nodeAlloc);
+    destroyNode(valueAlloc, p->value);
+    destroyNode(nodeAlloc, p);
+}
+
+/*
+*  Public Methods
+*/
+
+template<class K, class V, class Alloc, class Compare>
+template<class... Args>
+std::pair<V*, bool> BSTMap<K, V, Alloc, Compare>::try_emplace(const K& key, Args&&... args) {
+    Node **link = findLink(key);
+    if (*link != 0)
+        return std::make_pair((*link)->value, false);
+    auto valueAlloc = sideAllocator<V>(nodeAlloc);
+    V *value = constructNode(valueAlloc, std::forward<Args>(args)...);
+    try {
+        *link = constructNode(nodeAlloc, key, value);
+    } catch (...) {
+        destroyNode(valueAlloc, value);
+        throw;
+    }
+    count++;
+    return std::make_pair(value, true);
+}
+
+template<class K, class V, class Alloc, class Compare>
+template<class M>
+std::pair<V*, bool> BSTMap<K, V, Alloc, Compare>::insert_or_assign(const K& key, M&& value) {
+    std::pair<V*, bool> result = try_emplace(key, std::forward<M>(value));
+    if (!result.second)
+        *result.first = std::forward<M>(value);
+    return result;
+}
+
+template<class K, class V, class Alloc, class Compare>
+template<class Key>
+bool BSTMap<K, V, Alloc, Compare>::eraseKey(const Key& key) {
+    Node **link = findLink(key);
+    Node *node = *link;
+    if (node == 0)
+        return false;
+    if (node->left == 0)
+        *link = node->right;
+    else if (node->right == 0)
+        *link = node->left;
+    else {                            // relink the successor in place of node
+        Node **succLink = &node->right;
+        while ((*succLink)->left != 0)
+            succLink = &(*succLink)->left;
+        Node *succ = *succLink;
+        *succLink = succ->right;
+        succ->left = node->left;
+        succ->right = node->right;
+        *link = succ;
+    }
+    destroy(node);
+    count--;
+    return true;
+}
+
+// Values share the pools of the nodes, both are dropped in bulk when no destructor would be skipped,
+// otherwise the tree is taken apart by right rotations (no stack) and freed node by node
+template<class K, class V, class Alloc, class Compare>
+void BSTMap<K, V, Alloc, Compare>::clear() {
+    if (!(std::is_trivially_destructible<V>::value && !IsMonotonicAllocator<Alloc>::value && tryReleaseAllNodes(nodeAlloc))) {
+        Node *p = root;
+        while (p != 0)
+            if (p->left != 0) {
+                Node *left = p->left;
+                p->left = left->right;
+                left->right = p;
+                p = left;
+            }
+            else {
+                Node *right = p->right;
+                destroy(p);
+                p = right;
+            }
+        releaseAllNodes(nodeAlloc);
+    }
+    root = 0;
+    count = 0;
+}
+
+template<class K, class V, class Alloc, class Compare>
+template<class Fn>
+void BSTMap<K, V, Alloc, Compare>::for_each(Fn fn) {
+    std::vector<Node*> travStack;
+    Node *p = root;
+    while (p != 0 || !travStack.empty()) {
+        for ( ; p != 0; p = p->left)
+            travStack.push_back(p);
+        p = travStack.back();
+        travStack.pop_back();
+        fn(static_cast<const K&>(p->key), *p->value);
+        p = p->right;
+    }
+}
+
+} /* namespace closing bracket */
+
+#endif /* BINARY_SEARCH_TREE_MAP */
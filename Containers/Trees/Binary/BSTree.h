@@ -7,12 +7,29 @@
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <functional>
+#include <memory>
+#include "../../Compare.h"
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/NodePool.h"
+#include "../../../Memory/MonotonicArena.h"
 
 /*
     A binary search tree is a binary tree in which for each node, value of all the nodes in left subtree is lesser or equal and value of all the nodes in right subtree is greater.
 
     Initialization:
         BSTree<int> bst;
+        BSTree<int, MyAllocator<int>> bst(alloc); // nodes come from alloc
+        BSTree<std::string, PoolAllocator<std::string>, std::less<>> bst; // search also takes a std::string_view
+
+    "Lesser" and "greater" are in the order of Compare (std::less<T> by default), with a transparent
+    Compare (see Compare.h) search and searchNode take any type it compares.
+
+    Nodes come from a PoolAllocator (slab pool per tree) unless another allocator is given,
+    Clear() then frees the pool chunks instead of visiting every node.
+
+    Arena mode, for trees that are built once, queried and then rebuilt from scratch:
+        ArenaBSTree<int> bst;   // nodes are bumped out of a MonotonicArena, Clear() resets it
 */
 
 namespace VLIB{
@@ -63,20 +80,27 @@ public:
 /*
 *  Binary Search Tree
 */
-template<class T>
+template<class T, class Alloc = PoolAllocator<T>, class Compare = std::less<T>>
 class BSTree  {
 public:
-    BSTree() {
+    BSTree() : nodeAlloc(Alloc()) {
+        root = 0;
+}
+explicit BSTree(const Alloc& alloc, const Compare& comp = Compare()) : nodeAlloc(alloc), comp(comp) {
         root = 0;
 }
 ~BSTree() {Clear(); }
-void Clear() {clear(root); root = 0;}
+void Clear() {if (!tryReleaseAllNodes(nodeAlloc)) {clear(root); releaseAllNodes(nodeAlloc);} root = 0;}
 bool isEmpty() const {return root == 0;}
 void preorder() {preorder(root);}
 void inorder() {inorder(root);}
 void postorder() {postorder(root);}
 T* search(const T& el) const {return search(root,el);}
 BSTNode<T>* searchNode(const T& el) const {return searchNode(root,el);}
+template<class K, class C = Compare, EnableIfTransparent<C> = 0>
+T* search(const K& el) const {return search(root,el);} // heterogeneous lookup, needs a transparent Compare
+template<class K, class C = Compare, EnableIfTransparent<C> = 0>
+BSTNode<T>* searchNode(const K& el) const {return searchNode(root,el);}
 void breadthFirst();
 void iterativePreorder();
 void iterativeInorder();
@@ -96,9 +120,13 @@ BSTNode<T>* getRoot() const { return root; }
 
 protected:
     BSTNode<T>* root;
+    NodeAllocatorFor<Alloc, BSTNode<T>> nodeAlloc;
+    Compare comp;
     void clear(BSTNode<T>*);
-    T* search(BSTNode<T>*, const T&) const; 
-    BSTNode<T>* searchNode(BSTNode<T>*, const T&) const;
+    template<class K>
+    T* search(BSTNode<T>*, const K&) const; 
+    template<class K>
+    BSTNode<T>* searchNode(BSTNode<T>*, const K&) const;
     void preorder(BSTNode<T>*);
     void inorder(BSTNode<T>*);
     void postorder(BSTNode<T>*);
@@ -110,71 +138,72 @@ protected:
 
 };
 
+// Arena construction mode, see MonotonicArena.h
+template<class T, class Compare = std::less<T>>
+using ArenaBSTree = BSTree<T, ArenaAllocator<T>, Compare>;
+
 /*
 *   Protected Methods
 */
 
-template<class T>
-void BSTree<T>::clear(BSTNode<T> *p) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::clear(BSTNode<T> *p) {
     if (p != 0) {
         clear(p->left);
         clear(p->right);
-        delete p;
+        destroyNode(nodeAlloc, p);
     }
 }
 
-template<class T>
-T* BSTree<T>::search(BSTNode<T>* p, const T& el) const {
-    while (p != 0)
-        if (el == p->el)
-             return &p->el;
-        else if (el < p->el)
-             p = p->left;
-        else p = p->right;
-    return 0; 
+template<class T, class Alloc, class Compare>
+template<class K>
+T* BSTree<T, Alloc, Compare>::search(BSTNode<T>* p, const K& el) const {
+    p = searchNode(p, el);
+    return p != 0 ? &p->el : 0;
 }
-template<class T>
-BSTNode<T>* BSTree<T>::searchNode(BSTNode<T>* p, const T& el) const {
+template<class T, class Alloc, class Compare>
+template<class K>
+BSTNode<T>* BSTree<T, Alloc, Compare>::searchNode(BSTNode<T>* p, const K& el) const {
     while (p != 0)
-        if (el == p->el)
-             return p;
-        else if (el < p->el)
+        if (comp(el, p->el))
              p = p->left;
-        else p = p->right;
+        else if (comp(p->el, el))
+             p = p->right;
+        else return p;
     return 0; 
 }
-template<class T>
-void BSTree<T>::inorder(BSTNode<T> *p) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::inorder(BSTNode<T> *p) {
      if (p != 0) {
          inorder(p->left);
          visit(p);
          inorder(p->right);
 } }
-template<class T>
-void BSTree<T>::preorder(BSTNode<T> *p) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::preorder(BSTNode<T> *p) {
     if (p != 0) {
         visit(p);
         preorder(p->left);
         preorder(p->right);
     }
 }
-template<class T>
-void BSTree<T>::postorder(BSTNode<T>* p) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::postorder(BSTNode<T>* p) {
     if (p != 0) {
         postorder(p->left);
         postorder(p->right);
         visit(p);
 } }
 
-template<class T>
-int BSTree<T>::countNodes(BSTNode<T> *p) {
+template<class T, class Alloc, class Compare>
+int BSTree<T, Alloc, Compare>::countNodes(BSTNode<T> *p) {
     if (p == 0) return 0;
     else return 1 + countNodes(p->left) + countNodes(p->right);
     
 }
 
-template<class T>
-void BSTree<T>::balanceRecursive(std::vector<T>* data, int start, int end) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::balanceRecursive(std::vector<T>* data, int start, int end) {
     if (start > end)
         return;
 
@@ -194,8 +223,8 @@ void BSTree<T>::balanceRecursive(std::vector<T>* data, int start, int end) {
 *  Public Methods
 */
 
-template<class T>
-void BSTree<T>::breadthFirst() {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::breadthFirst() {
     Queue<BSTNode<T>*> queue;
     BSTNode<T> *p = root;
     if (p != 0) {
@@ -211,8 +240,8 @@ void BSTree<T>::breadthFirst() {
     }
 }
 
-template<class T>
-void BSTree<T>::iterativePreorder() {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::iterativePreorder() {
     Stack<BSTNode<T>*> travStack;
     BSTNode<T> *p = root;
     if (p != 0) {
@@ -229,8 +258,8 @@ void BSTree<T>::iterativePreorder() {
     }
 }
 
-template<class T>
-void BSTree<T>::iterativePostorder() {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::iterativePostorder() {
     Stack<BSTNode<T>*> travStack;
     BSTNode<T>* p = root, *q = root;
     while (p != 0) {
@@ -247,8 +276,8 @@ void BSTree<T>::iterativePostorder() {
         p = p->right;
 } }
 
-template<class T>
-void BSTree<T>::iterativeInorder() {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::iterativeInorder() {
     Stack<BSTNode<T>*> travStack;
     BSTNode<T> *p = root;
     while (p != 0) {
@@ -270,8 +299,8 @@ void BSTree<T>::iterativeInorder() {
     } 
 }
 
-template<class T> // makes tree into a single right path
-void BSTree<T>::MorrisInorder() { // no stack or threads used!
+template<class T, class Alloc, class Compare> // makes tree into a single right path
+void BSTree<T, Alloc, Compare>::MorrisInorder() { // no stack or threads used!
     BSTNode<T> *p = root, *tmp;
     while (p != 0)
         if (p->left == 0) {          // if no left subtree 
@@ -293,8 +322,8 @@ void BSTree<T>::MorrisInorder() { // no stack or threads used!
             }
         }
 }
-template<class T>
-std::vector<T>* BSTree<T>::getInOrderVector() const {
+template<class T, class Alloc, class Compare>
+std::vector<T>* BSTree<T, Alloc, Compare>::getInOrderVector() const {
     // Use Morris Inorder traversal to get the array, instead of visit(p), add p->el to the array
 
     // Create the vector on the heap
@@ -326,24 +355,24 @@ std::vector<T>* BSTree<T>::getInOrderVector() const {
 
 
 
-template<class T>
-void BSTree<T>::insert(const T& el) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::insert(const T& el) {
     BSTNode<T> *p = root, *prev = 0;
     while (p != 0) {  // find a place for inserting new node;
         prev = p;
-        if (el < p->el)
+        if (comp(el, p->el))
              p = p->left;
         else p = p->right;
     }
     if (root == 0)    // tree is empty;
-         root = new BSTNode<T>(el);
-    else if (el < prev->el)
-         prev->left   = new BSTNode<T>(el);
-    else prev->right  = new BSTNode<T>(el);
+         root = constructNode(nodeAlloc, el);
+    else if (comp(el, prev->el))
+         prev->left   = constructNode(nodeAlloc, el);
+    else prev->right  = constructNode(nodeAlloc, el);
 }
 
-template<class T>
-void BSTree<T>::deleteByMerging(BSTNode<T>*& node) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::deleteByMerging(BSTNode<T>*& node) {
     BSTNode<T> *tmp = node;
     if (node != 0) {
         if (!node->right)
@@ -360,22 +389,22 @@ void BSTree<T>::deleteByMerging(BSTNode<T>*& node) {
             tmp = node;
             node = node->left;
         }
-        delete tmp;
+        destroyNode(nodeAlloc, tmp);
     }
 }
 
-template<class T>
-void BSTree<T>::findAndDeleteByMerging(const T& el) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::findAndDeleteByMerging(const T& el) {
     BSTNode<T> *node = root, *prev = 0;
     while (node != 0) {
-        if (node->el == el)
+        if (Equivalent(comp, node->el, el))
              break;
         prev = node;
-        if (el < node->el)
+        if (comp(el, node->el))
              node = node->left;
         else node = node->right;
     }
-    if (node != 0 && node->el == el)
+    if (node != 0)
          if (node == root)
               deleteByMerging(root);
          else if (prev->left == node)
@@ -386,8 +415,8 @@ void BSTree<T>::findAndDeleteByMerging(const T& el) {
     else std::cout << "the tree is empty\n";
 }
 
-template<class T>
-void BSTree<T>::deleteByCopying(BSTNode<T>*& node) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::deleteByCopying(BSTNode<T>*& node) {
     BSTNode<T> *previous, *tmp = node;
     if (node->right == 0)
       node = node->left;
@@ -405,12 +434,12 @@ void BSTree<T>::deleteByCopying(BSTNode<T>*& node) {
            previous ->left  = tmp->left;
       else previous ->right = tmp->left;
     }
-    delete tmp;
+    destroyNode(nodeAlloc, tmp);
 }
 
 
-template<class T>
-void BSTree<T>::balance(std::vector<T>* data) {
+template<class T, class Alloc, class Compare>
+void BSTree<T, Alloc, Compare>::balance(std::vector<T>* data) {
 
     // Clear the tree
     Clear();
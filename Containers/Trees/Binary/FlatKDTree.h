@@ -0,0 +1,389 @@
+// flat k-dimensional tree
+#ifndef FlatKDTree_H
+#define FlatKDTree_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*
+    Static KD-tree for read-mostly point sets, built once into a handful of contiguous arrays.
+
+    There are no node objects and no child pointers. The tree is complete: internal node i has its
+    children at 2i + 1 and 2i + 2, and the nodes below the last internal level are leaf buckets of at
+    most BucketSize points. Every internal node splits its points in two halves at the median of the
+    dimension with the widest spread, so the depth is log2(n / BucketSize) whatever the input order.
+
+    The points are reordered so each bucket is a contiguous range, their coordinates are stored
+    structure-of-arrays (all x, then all y, ...). A query reads one split value per level and then
+    scans a few buckets with unit-stride loads, instead of chasing one heap node per point.
+
+    How to use:
+
+        FlatKDTree<double, 3> index(positions, ids);         // ids[i] belongs to positions[i]
+        std::uint64_t id = index.nearestNeighbor({2.0, 4.0, 5.0});
+        std::vector<std::uint64_t> near = index.rangeSearch({2.0, 4.0, 5.0}, 3.0);
+        auto closest = index.kNearest({2.0, 4.0, 5.0}, 10);  // (ID, squared distance), closest first
+
+    IDMappedKDTree::flatten() builds one from the points of a mapped tree, its IDs then resolve
+    through the mapped tree (getUserData, getCoordinates). The ID 0 is never generated there, the
+    queries return it when nothing was found.
+
+    The tree does not change after build, rebuild it (or call build again) when the points move.
+*/
+
+namespace VLIB{
+
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize = 16>
+class FlatKDTree {
+    static_assert(KDimensions > 0, "a point needs at least one dimension");
+    static_assert(BucketSize > 0, "a bucket needs room for at least one point");
+
+public:
+    using Point = std::array<CoordType, KDimensions>;
+
+private:
+    static constexpr std::size_t MaxDepth = 64;
+
+    std::size_t count;                   // Number of points
+    std::size_t leafCount;               // Number of buckets, a power of two
+    std::vector<CoordType> splitValue;   // Per internal node, left half <= splitValue <= right half
+    std::vector<std::uint8_t> splitDim;  // Per internal node, the dimension it splits
+    std::vector<std::size_t> leafStart;  // Bucket j holds the points [leafStart[j], leafStart[j + 1])
+    std::vector<CoordType> coords;       // coords[d * count + i], dimension d of point i
+    std::vector<std::uint64_t> ids;      // ids[i] belongs to point i
+
+    // Helper functions
+        const CoordType* dimension(std::size_t d) const { return coords.data() + d * count; }
+        void buildRecursive(const std::vector<Point>& points, std::size_t* order, std::size_t node, std::size_t begin, std::size_t end);
+        std::size_t nearestIndex(const Point& point, CoordType limit) const;
+
+public:
+    // constructor
+    FlatKDTree() : count(0), leafCount(0) {}
+    FlatKDTree(const std::vector<Point>& points, const std::vector<std::uint64_t>& pointIDs) : FlatKDTree() { build(points, pointIDs); }
+
+    // Manage the tree
+    void build(const std::vector<Point>& points, const std::vector<std::uint64_t>& pointIDs); // Replaces the content
+    void clear();
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Queries, distances are Euclidean, the IDs are the ones given to build (0 when nothing matches)
+    std::uint64_t nearestNeighbor(const Point& point) const;
+    std::uint64_t nearestNeighborWithinRange(const Point& point, CoordType maxDistance) const;
+    std::vector<std::uint64_t> rangeSearch(const Point& point, CoordType distance) const;
+    std::vector<std::pair<std::uint64_t, CoordType>> kNearest(const Point& point, std::size_t k) const;
+};
+
+// PRIVATE HELPER FUNCTIONS
+
+// Splits order[begin, end) at the median of its widest dimension, the lower half goes to the left child
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+void FlatKDTree<CoordType, KDimensions, BucketSize>::buildRecursive(
+    const std::vector<Point>& points, std::size_t* order, std::size_t node, std::size_t begin, std::size_t end) {
+    if (node >= leafCount - 1) {
+        leafStart[node - (leafCount - 1)] = begin;
+        return;
+    }
+
+    std::size_t dim = 0;
+    CoordType split = CoordType();
+    std::size_t middle = begin + (end - begin) / 2;
+    if (begin < end) {
+        // Widest spread of the points in this node
+        CoordType widest = CoordType();
+        for (std::size_t d = 0; d < KDimensions; ++d) {
+            CoordType low = points[order[begin]][d], high = low;
+            for (std::size_t i = begin + 1; i < end; ++i) {
+                low = std::min(low, points[order[i]][d]);
+                high = std::max(high, points[order[i]][d]);
+            }
+            if (d == 0 || widest < high - low) {
+                widest = high - low;
+                dim = d;
+            }
+        }
+        std::nth_element(order + begin, order + middle, order + end, [&points, dim](std::size_t a, std::size_t b) {
+            return points[a][dim] < points[b][dim];
+        });
+        split = points[order[middle]][dim];
+    }
+    splitValue[node] = split;
+    splitDim[node] = static_cast<std::uint8_t>(dim);
+
+    buildRecursive(points, order, 2 * node + 1, begin, middle);
+    buildRecursive(points, order, 2 * node + 2, middle, end);
+}
+
+// Index of the closest point, or count when no point is within limit (squared, inclusive)
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+std::size_t FlatKDTree<CoordType, KDimensions, BucketSize>::nearestIndex(const Point& point, CoordType limit) const {
+    struct Pending {
+        std::size_t node;
+        CoordType bound; // Squared distance from point to the splitting plane in front of node
+    };
+
+    std::size_t bestIndex = count;
+    CoordType bestDistance = limit;
+    if (count == 0) {
+        return bestIndex;
+    }
+
+    // Every level leaves at most one far child behind, so the stack never holds more than the depth
+    Pending stack[MaxDepth];
+    std::size_t top = 0;
+    stack[top++] = Pending{0, CoordType()};
+    CoordType distances[BucketSize];
+
+    while (top > 0) {
+        Pending pending = stack[--top];
+        if (bestDistance < pending.bound) {
+            continue;
+        }
+
+        // Walk down to the bucket on the side of point, remembering the far sides
+        std::size_t node = pending.node;
+        while (node < leafCount - 1) {
+            CoordType diff = point[splitDim[node]] - splitValue[node];
+            std::size_t nearChild = diff < 0 ? 2 * node + 1 : 2 * node + 2;
+            std::size_t farChild = diff < 0 ? 2 * node + 2 : 2 * node + 1;
+            if (!(bestDistance < diff * diff)) {
+                stack[top++] = Pending{farChild, diff * diff};
+            }
+            node = nearChild;
+        }
+
+        // Scan the bucket one dimension at a time
+        std::size_t leaf = node - (leafCount - 1);
+        std::size_t begin = leafStart[leaf];
+        std::size_t bucket = leafStart[leaf + 1] - begin;
+        for (std::size_t i = 0; i < bucket; ++i) {
+            distances[i] = CoordType();
+        }
+        for (std::size_t d = 0; d < KDimensions; ++d) {
+            const CoordType* values = dimension(d) + begin;
+            CoordType target = point[d];
+            for (std::size_t i = 0; i < bucket; ++i) {
+                CoordType diff = values[i] - target;
+                distances[i] += diff * diff;
+            }
+        }
+        for (std::size_t i = 0; i < bucket; ++i) {
+            if (distances[i] < bestDistance || (bestIndex == count && !(bestDistance < distances[i]))) {
+                bestDistance = distances[i];
+                bestIndex = begin + i;
+            }
+        }
+    }
+    return bestIndex;
+}
+
+// PUBLIC FUNCTIONS
+
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+void FlatKDTree<CoordType, KDimensions, BucketSize>::build(const std::vector<Point>& points, const std::vector<std::uint64_t>& pointIDs) {
+    if (points.size() != pointIDs.size()) {
+        throw std::invalid_argument("build expects one ID per point");
+    }
+
+    clear();
+    if (points.empty()) {
+        return;
+    }
+
+    // Fewest buckets (a power of two) that keep every bucket within BucketSize, halving a range
+    // never leaves a half above ceil(n / leafCount)
+    std::size_t leaves = 1;
+    while (points.size() > leaves * BucketSize) {
+        leaves *= 2;
+    }
+    if (leaves > (std::size_t(1) << (MaxDepth - 1))) {
+        throw std::length_error("too many points for a FlatKDTree");
+    }
+
+    std::vector<std::size_t> order(points.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::vector<CoordType> newSplitValue(leaves - 1);
+    std::vector<std::uint8_t> newSplitDim(leaves - 1);
+    std::vector<std::size_t> newLeafStart(leaves + 1);
+    std::vector<CoordType> newCoords(KDimensions * points.size());
+    std::vector<std::uint64_t> newIDs(points.size());
+
+    count = points.size();
+    leafCount = leaves;
+    splitValue.swap(newSplitValue);
+    splitDim.swap(newSplitDim);
+    leafStart.swap(newLeafStart);
+    buildRecursive(points, order.data(), 0, 0, points.size());
+    leafStart[leaves] = points.size();
+
+    // Lay the points out in bucket order, one array per dimension
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t d = 0; d < KDimensions; ++d) {
+            newCoords[d * count + i] = points[order[i]][d];
+        }
+        newIDs[i] = pointIDs[order[i]];
+    }
+    coords.swap(newCoords);
+    ids.swap(newIDs);
+}
+
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+void FlatKDTree<CoordType, KDimensions, BucketSize>::clear() {
+    count = 0;
+    leafCount = 0;
+    splitValue.clear();
+    splitDim.clear();
+    leafStart.clear();
+    coords.clear();
+    ids.clear();
+}
+
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+std::uint64_t FlatKDTree<CoordType, KDimensions, BucketSize>::nearestNeighbor(const Point& point) const {
+    std::size_t index = nearestIndex(point, std::numeric_limits<CoordType>::max());
+    return index < count ? ids[index] : 0;
+}
+
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+std::uint64_t FlatKDTree<CoordType, KDimensions, BucketSize>::nearestNeighborWithinRange(const Point& point, CoordType maxDistance) const {
+    std::size_t index = nearestIndex(point, maxDistance * maxDistance);
+    return index < count ? ids[index] : 0;
+}
+
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+std::vector<std::uint64_t> FlatKDTree<CoordType, KDimensions, BucketSize>::rangeSearch(const Point& point, CoordType distance) const {
+    std::vector<std::uint64_t> result;
+    if (count == 0) {
+        return result;
+    }
+
+    CoordType limit = distance * distance;
+    CoordType distances[BucketSize];
+
+    // Depth first, the stack holds at most one pending sibling per level
+    std::size_t stack[MaxDepth + 1];
+    std::size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        std::size_t node = stack[--top];
+        if (node < leafCount - 1) {
+            CoordType diff = point[splitDim[node]] - splitValue[node];
+            // The far side only matters when the sphere crosses the splitting plane
+            bool visitLeft = diff < 0 || !(limit < diff * diff);
+            bool visitRight = !(diff < 0) || !(limit < diff * diff);
+            if (visitRight) {
+                stack[top++] = 2 * node + 2;
+            }
+            if (visitLeft) {
+                stack[top++] = 2 * node + 1;
+            }
+            continue;
+        }
+
+        std::size_t leaf = node - (leafCount - 1);
+        std::size_t begin = leafStart[leaf];
+        std::size_t bucket = leafStart[leaf + 1] - begin;
+        for (std::size_t i = 0; i < bucket; ++i) {
+            distances[i] = CoordType();
+        }
+        for (std::size_t d = 0; d < KDimensions; ++d) {
+            const CoordType* values = dimension(d) + begin;
+            CoordType target = point[d];
+            for (std::size_t i = 0; i < bucket; ++i) {
+                CoordType diff = values[i] - target;
+                distances[i] += diff * diff;
+            }
+        }
+        for (std::size_t i = 0; i < bucket; ++i) {
+            if (!(limit < distances[i])) {
+                result.push_back(ids[begin + i]);
+            }
+        }
+    }
+    return result;
+}
+
+// Same walk as nearestIndex, the pruning distance is the farthest of the k best so far (a max-heap)
+template <class CoordType, std::size_t KDimensions, std::size_t BucketSize>
+std::vector<std::pair<std::uint64_t, CoordType>> FlatKDTree<CoordType, KDimensions, BucketSize>::kNearest(const Point& point, std::size_t k) const {
+    struct Pending {
+        std::size_t node;
+        CoordType bound;
+    };
+
+    std::vector<std::pair<std::uint64_t, CoordType>> result;
+    if (count == 0 || k == 0) {
+        return result;
+    }
+
+    std::priority_queue<std::pair<CoordType, std::size_t>> candidates; // (squared distance, point index)
+    auto pruneDistance = [&candidates, k]() {
+        return candidates.size() < k ? std::numeric_limits<CoordType>::max() : candidates.top().first;
+    };
+
+    Pending stack[MaxDepth];
+    std::size_t top = 0;
+    stack[top++] = Pending{0, CoordType()};
+    CoordType distances[BucketSize];
+
+    while (top > 0) {
+        Pending pending = stack[--top];
+        if (!(pending.bound < pruneDistance())) {
+            continue;
+        }
+
+        std::size_t node = pending.node;
+        while (node < leafCount - 1) {
+            CoordType diff = point[splitDim[node]] - splitValue[node];
+            std::size_t nearChild = diff < 0 ? 2 * node + 1 : 2 * node + 2;
+            std::size_t farChild = diff < 0 ? 2 * node + 2 : 2 * node + 1;
+            if (diff * diff < pruneDistance()) {
+                stack[top++] = Pending{farChild, diff * diff};
+            }
+            node = nearChild;
+        }
+
+        std::size_t leaf = node - (leafCount - 1);
+        std::size_t begin = leafStart[leaf];
+        std::size_t bucket = leafStart[leaf + 1] - begin;
+        for (std::size_t i = 0; i < bucket; ++i) {
+            distances[i] = CoordType();
+        }
+        for (std::size_t d = 0; d < KDimensions; ++d) {
+            const CoordType* values = dimension(d) + begin;
+            CoordType target = point[d];
+            for (std::size_t i = 0; i < bucket; ++i) {
+                CoordType diff = values[i] - target;
+                distances[i] += diff * diff;
+            }
+        }
+        for (std::size_t i = 0; i < bucket; ++i) {
+            if (candidates.size() < k) {
+                candidates.emplace(distances[i], begin + i);
+            } else if (distances[i] < candidates.top().first) {
+                candidates.pop();
+                candidates.emplace(distances[i], begin + i);
+            }
+        }
+    }
+
+    result.resize(candidates.size());
+    for (std::size_t i = result.size(); i > 0; --i) {
+        result[i - 1] = std::make_pair(ids[candidates.top().second], candidates.top().first);
+        candidates.pop();
+    }
+    return result;
+}
+
+}
+
+#endif // FlatKDTree_H
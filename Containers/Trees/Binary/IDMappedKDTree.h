@@ -2,13 +2,23 @@
 #ifndef IDMappedKDTree_H
 #define IDMappedKDTree_H
 
+#include <algorithm>
 #include <array>
+#include <exception>
 #include <memory>
+#include <numeric>
 #include <queue>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <unordered_map>
 #include <functional>
+#include <limits>
+#include "../../../Memory/NodeAllocator.h"
+#include "../../../Memory/MonotonicArena.h"
+#include "FlatKDTree.h"
 
 
 // K-dimensional tree that stores cords among a K-dimensional space with an associated userData
@@ -30,6 +40,42 @@
         kdTree.insert({1.0, 2.0, 3.0}, PlayerData("John", 1001));
         kdTree.insert({4.0, 5.0, 6.0}, PlayerData("Alice", 1002));
 
+    insert never rebalances, points arriving in sorted or clustered order give a deep, list-like tree.
+    A whole snapshot is better loaded with build, which replaces the content with a balanced tree
+    (median split on every level, subtrees built in parallel) and returns the IDs in input order
+
+        std::vector<std::uint64_t> ids = kdTree.build(positions, players);      // all hardware threads
+        std::vector<std::uint64_t> ids = kdTree.build(positions, players, 1);   // on the calling thread
+
+    A read-mostly snapshot can be frozen into a FlatKDTree (contiguous, pointer-free, see FlatKDTree.h),
+    its queries return the same IDs, which still resolve through this tree
+
+        FlatKDTree<double, 3> index = kdTree.flatten();
+        std::shared_ptr<UserBaseStruct> nearest = kdTree.getUserData(index.nearestNeighbor(queryPoint));
+
+    Many queries at once (one per entity and tick, say) go through the batch functions, which split the
+    queries over threads and return the results in input order. With sortQueries the queries are
+    visited along a Z-order curve, so consecutive ones walk mostly the same nodes while they are in cache
+
+        std::vector<std::uint64_t> nearest = kdTree.nearestNeighborBatch(positions);          // all hardware threads
+        auto closest = kdTree.kNearestBatch(positions, 10, 4, true);                         // 4 threads, Z-order
+        std::vector<std::vector<std::uint64_t>> near = kdTree.rangeSearchBatch(positions, 5.0);
+
+    The queries carry the depth of every node down an explicit stack, a query on a balanced tree of 1M
+    points takes microseconds. See Examples/IDMappedKDTreeBenchmark.h for the numbers.
+
+    Tree nodes, the ID map entries and the shared user data are all allocated through the optional
+    Alloc parameter (rebound to the type needed)
+
+        IDMappedKDTree<double, 3, PlayerData, MyAllocator<char>> kdTree(alloc);
+
+    Arena mode, for trees that are built once, queried and then rebuilt from scratch:
+
+        ArenaIDMappedKDTree<double, 3, PlayerData> kdTree;
+
+    Tree nodes are bumped out of a MonotonicArena and clear() resets it instead of visiting every node,
+    the ID map and the user data stay on std::allocator since they are freed one entry at a time.
+
 
 */
 
@@ -60,11 +106,15 @@ struct KDNode {
 };
 
 // KD Tree that stores points in K-dimensional space
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc = std::allocator<KDNode<CoordType, KDimensions>>>
 class IDMappedKDTree {
 private:
+    using MapEntry = std::pair<std::shared_ptr<DerivedUserData>, std::array<CoordType, KDimensions>>;
+    using MapAllocator = SideAllocatorFor<Alloc, std::pair<const std::uint64_t, MapEntry>>;
+
     KDNode<CoordType, KDimensions>* root;
-    std::unordered_map<std::uint64_t, std::pair<std::shared_ptr<DerivedUserData>, std::array<CoordType, KDimensions>>> dataMap;
+    NodeAllocatorFor<Alloc, KDNode<CoordType, KDimensions>> nodeAlloc;
+    std::unordered_map<std::uint64_t, MapEntry, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>, MapAllocator> dataMap;
 
     // Helper functions
 
@@ -72,8 +122,6 @@ private:
         const std::uint64_t insertIntoMap(KDNode<CoordType, KDimensions>* node, const DerivedUserData& userData);
 
         // tree helper functions
-        std::size_t getTreeDepth() const;
-        std::size_t calculateTreeDepth(KDNode<CoordType, KDimensions>* currentNode) const;
         void updateKdCoords(const std::array<CoordType, KDimensions>& oldCoords, const std::array<CoordType, KDimensions>& newCoords);
 
         KDNode<CoordType, KDimensions>* findNode(const std::array<CoordType, KDimensions>& point, uint64_t uniqueID) const;
@@ -82,29 +130,60 @@ private:
         KDNode<CoordType, KDimensions>* smallest(KDNode<CoordType, KDimensions>* node, int i, int j);
 
         KDNode<CoordType, KDimensions>* insertIntoTree(const std::array<CoordType, KDimensions>& point);
+
+        // query helper functions, the walks keep their own stack of subtrees still to visit
+        struct PendingNode {
+            KDNode<CoordType, KDimensions>* node;
+            std::size_t depth;   // Depth of node, it splits on depth % KDimensions
+            CoordType bound;     // Squared distance from the query point to the splitting plane in front of node
+        };
+        using Candidates = std::priority_queue<std::pair<CoordType, std::uint64_t>>; // Max-heap on the squared distance
+        static CoordType squaredDistance(const std::array<CoordType, KDimensions>& a, const std::array<CoordType, KDimensions>& b);
+        KDNode<CoordType, KDimensions>* nearestNode(const std::array<CoordType, KDimensions>& point, CoordType limit, CoordType& bestDistance) const;
+        void kNearestCandidates(const std::array<CoordType, KDimensions>& point, std::size_t k, Candidates& candidates) const;
+        void rangeCollect(const std::array<CoordType, KDimensions>& point, CoordType squared, std::vector<std::uint64_t>& result) const;
+        static std::vector<std::size_t> zOrder(const std::vector<std::array<CoordType, KDimensions>>& queries);
+        template <class Query>
+        void runBatch(const std::vector<std::array<CoordType, KDimensions>>& queries, unsigned threads, bool sortQueries, Query query) const;
+        static KDNode<CoordType, KDimensions>* buildRecursive(KDNode<CoordType, KDimensions>** first, KDNode<CoordType, KDimensions>** last,
+            std::size_t depth, unsigned threads);
         void clearTree();
         void clearRecursive(KDNode<CoordType, KDimensions>* node);  
 
 public:
     // constructor & destructor
-    IDMappedKDTree() : root(nullptr) {}
+    IDMappedKDTree() : IDMappedKDTree(Alloc()) {}
+    explicit IDMappedKDTree(const Alloc& alloc) : root(nullptr), nodeAlloc(alloc), dataMap(0, std::hash<std::uint64_t>(), std::equal_to<std::uint64_t>(), sideAllocator<std::pair<const std::uint64_t, MapEntry>>(alloc)) {}
     ~IDMappedKDTree() {
         clear();
-        delete root; 
+        destroyNode(nodeAlloc, root);
     }
 
     // Manage the tree
     std::uint64_t insert(const std::array<CoordType, KDimensions>& point, const DerivedUserData& userData);
+    std::vector<std::uint64_t> build(const std::vector<std::array<CoordType, KDimensions>>& points,
+        const std::vector<DerivedUserData>& userData, unsigned threads = 0); // threads == 0: hardware concurrency
     void remove(std::uint64_t uniqueID);
     void clear();
     std::size_t size() const;
-    std::uint64_t nearestNeighbor(const std::array<CoordType, KDimensions>& point) const;
+    std::uint64_t nearestNeighbor(const std::array<CoordType, KDimensions>& point) const; // 0 when the tree is empty
     std::uint64_t nearestNeighborWithinRange(const std::array<CoordType, KDimensions>& point, CoordType maxDistance) const;
-    void nearestNeighborWithinRangeRecursive(KDNode<CoordType, KDimensions>* node, const std::array<CoordType, KDimensions>& queryPoint,
-        CoordType maxDistance, std::uint64_t& nearestNeighborID, CoordType& nearestDistance) const;
     std::vector<std::uint64_t>  rangeSearch(const std::array<CoordType, KDimensions>& point, CoordType distance) const;
+    std::vector<std::pair<std::uint64_t, CoordType>> kNearest(const std::array<CoordType, KDimensions>& point, std::size_t k) const; // (ID, squared distance), closest first
     bool contains(std::uint64_t uniqueID) const;
 
+    // Batched queries, result i belongs to queries[i], threads == 0: hardware concurrency
+    // sortQueries visits the queries in Z-order for cache reuse, the results keep the input order
+    std::vector<std::uint64_t> nearestNeighborBatch(const std::vector<std::array<CoordType, KDimensions>>& queries,
+        unsigned threads = 0, bool sortQueries = false) const;
+    std::vector<std::vector<std::pair<std::uint64_t, CoordType>>> kNearestBatch(const std::vector<std::array<CoordType, KDimensions>>& queries,
+        std::size_t k, unsigned threads = 0, bool sortQueries = false) const;
+    std::vector<std::vector<std::uint64_t>> rangeSearchBatch(const std::vector<std::array<CoordType, KDimensions>>& queries,
+        CoordType distance, unsigned threads = 0, bool sortQueries = false) const;
+
+    template <std::size_t BucketSize = 16>
+    FlatKDTree<CoordType, KDimensions, BucketSize> flatten() const; // Static copy of the current points and IDs
+
     // Manage user-defined data associated with a point & KD-tree synchronization
     void setPointCoordinates(std::uint64_t uniqueID, const std::array<CoordType, KDimensions>& newCoordinates);
     void setUserData(std::uint64_t uniqueID, const UserBaseStruct& userData);
@@ -112,16 +191,20 @@ public:
     const std::array<CoordType, KDimensions>& getCoordinates(std::uint64_t uniqueID) const;
 };
 
+// Arena construction mode, see MonotonicArena.h
+template <class CoordType, std::size_t KDimensions, class DerivedUserData>
+using ArenaIDMappedKDTree = IDMappedKDTree<CoordType, KDimensions, DerivedUserData, ArenaAllocator<KDNode<CoordType, KDimensions>>>;
+
 // PRIVATE MAP HELPER FUNCTIONS
 
 // Private helper function to insert into the data map
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-const std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::insertIntoMap(KDNode<CoordType, KDimensions>* node, const DerivedUserData& userData){
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+const std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::insertIntoMap(KDNode<CoordType, KDimensions>* node, const DerivedUserData& userData){
     // Get the unique ID from the node
     std::uint64_t uniqueID = node->uniqueID;
 
     // Create a shared pointer to the derived class UserData
-    std::shared_ptr<DerivedUserData> userPtr = std::make_shared<DerivedUserData>(userData);
+    std::shared_ptr<DerivedUserData> userPtr = std::allocate_shared<DerivedUserData>(sideAllocator<DerivedUserData>(nodeAlloc), userData);
 
     // Update the data map with coordinates and user data
     dataMap[uniqueID] = std::make_pair(userPtr, node->point);
@@ -134,28 +217,8 @@ const std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::ins
 
 // PRIVATE TREE HELPER FUNCTIONS
 
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-std::size_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::getTreeDepth() const {
-    // Call a private helper function to calculate the depth of the tree recursively
-    return calculateTreeDepth(root);
-}
-
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-std::size_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::calculateTreeDepth(KDNode<CoordType, KDimensions>* currentNode) const {
-    if (currentNode == nullptr) {
-        return 0;
-    }
-
-    // Recursively calculate the depth of the left and right subtrees
-    std::size_t leftDepth = calculateTreeDepth(currentNode->left);
-    std::size_t rightDepth = calculateTreeDepth(currentNode->right);
-
-    // Return the maximum depth between the left and right subtrees, plus 1 for the current node
-    return 1 + std::max(leftDepth, rightDepth);
-}
-
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::updateKdCoords(
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::updateKdCoords(
     const std::array<CoordType, KDimensions>& oldCoords,
     const std::array<CoordType, KDimensions>& newCoords) {
 
@@ -200,12 +263,12 @@ void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::updateKdCoords(
 
 
 
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::findNode(const std::array<CoordType, KDimensions>& point, std::uint64_t uniqueID) const {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::findNode(const std::array<CoordType, KDimensions>& point, std::uint64_t uniqueID) const {
     KDNode<CoordType, KDimensions>* currentNode = root;
 
-    // Calculate the traversal depth using the tree depth
-    std::size_t depth = getTreeDepth();
+    // The root splits on the first axis, as in insertIntoTree
+    std::size_t depth = 0;
 
     // Traverse the KD-tree to find the node with matching coordinates and unique ID
     while (currentNode != nullptr) {
@@ -233,18 +296,18 @@ KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUs
 
 
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::deleteFromKDTree(const std::array<CoordType, KDimensions>& point, std::uint64_t uniqueID) {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::deleteFromKDTree(const std::array<CoordType, KDimensions>& point, std::uint64_t uniqueID) {
 
     KDNode<CoordType, KDimensions>* p = findNode(point, uniqueID);
     deleteNode(p, 0); // Pass the appropriate dimension index
 }
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::deleteNode(KDNode<CoordType, KDimensions>* node, int i) {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::deleteNode(KDNode<CoordType, KDimensions>* node, int i) {
     if (node->left == nullptr && node->right == nullptr) {
         // Node is a leaf, just delete it
-        delete node;
+        destroyNode(nodeAlloc, node);
     } else {
         KDNode<CoordType, KDimensions>* q;
         if (node->right != nullptr) {
@@ -264,8 +327,8 @@ void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::deleteNode(KDNode<
     }
 }
 
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::smallest(KDNode<CoordType, KDimensions>* node, int i, int j) {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::smallest(KDNode<CoordType, KDimensions>* node, int i, int j) {
     KDNode<CoordType, KDimensions>* qq = node;
 
     if (i == j) {
@@ -295,8 +358,8 @@ KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUs
 
 
 // Private helper function to insert into the KD-tree
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::insertIntoTree(const std::array<CoordType, KDimensions>& point) {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::insertIntoTree(const std::array<CoordType, KDimensions>& point) {
     int i = 0;
     KDNode<CoordType, KDimensions>* p = root;
     KDNode<CoordType, KDimensions>* prev = nullptr;
@@ -312,7 +375,7 @@ KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUs
     }
 
     // create a new node
-    KDNode<CoordType, KDimensions>* newNode = new KDNode<CoordType, KDimensions>(std::array<CoordType, KDimensions>(point));
+    KDNode<CoordType, KDimensions>* newNode = constructNode(nodeAlloc, point);
 
 
     if (root == nullptr)
@@ -327,25 +390,343 @@ KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUs
 }
 
 
+// Private helper function, squared Euclidean distance
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+CoordType IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::squaredDistance(
+    const std::array<CoordType, KDimensions>& a, const std::array<CoordType, KDimensions>& b) {
+    CoordType distance = 0;
+    for (std::size_t i = 0; i < KDimensions; ++i) {
+        CoordType diff = a[i] - b[i];
+        distance += diff * diff;
+    }
+    return distance;
+}
+
+
+// Private helper function behind the nearest neighbor queries, the closest node within limit (squared,
+// inclusive), or nullptr with bestDistance == limit.
+// Every pass walks down on the side of point and leaves the far children on the stack together with
+// the distance to their splitting plane, a far child is dropped once that distance is beyond the best.
+// The axis comes from the depth carried along, the queries never measure the tree.
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::nearestNode(
+    const std::array<CoordType, KDimensions>& point, CoordType limit, CoordType& bestDistance) const {
+    KDNode<CoordType, KDimensions>* best = nullptr;
+    bestDistance = limit;
+
+    std::vector<PendingNode> stack;
+    stack.reserve(64);
+    stack.push_back(PendingNode{root, 0, CoordType()});
+    while (!stack.empty()) {
+        PendingNode pending = stack.back();
+        stack.pop_back();
+        if (bestDistance < pending.bound) {
+            continue;
+        }
+
+        KDNode<CoordType, KDimensions>* node = pending.node;
+        for (std::size_t level = pending.depth; node != nullptr; ++level) {
+            CoordType distance = squaredDistance(point, node->point);
+            if (distance < bestDistance || (best == nullptr && distance <= bestDistance)) {
+                best = node;
+                bestDistance = distance;
+            }
+
+            // Points on the splitting plane are in the right subtree
+            std::size_t axis = level % KDimensions;
+            CoordType planeDiff = point[axis] - node->point[axis];
+            KDNode<CoordType, KDimensions>* farChild = planeDiff < 0 ? node->right : node->left;
+            if (farChild != nullptr && !(bestDistance < planeDiff * planeDiff)) {
+                stack.push_back(PendingNode{farChild, level + 1, planeDiff * planeDiff});
+            }
+            node = planeDiff < 0 ? node->left : node->right;
+        }
+    }
+    return best;
+}
+
+
+// Private helper function for kNearest, the same walk as nearestNode. candidates holds the k closest
+// points seen so far with the farthest of them on top, it is the pruning distance once it is full
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::kNearestCandidates(
+    const std::array<CoordType, KDimensions>& point, std::size_t k, Candidates& candidates) const {
+    auto pruneDistance = [&candidates, k]() {
+        return candidates.size() < k ? std::numeric_limits<CoordType>::max() : candidates.top().first;
+    };
+
+    std::vector<PendingNode> stack;
+    stack.reserve(64);
+    stack.push_back(PendingNode{root, 0, CoordType()});
+    while (!stack.empty()) {
+        PendingNode pending = stack.back();
+        stack.pop_back();
+        if (!(pending.bound < pruneDistance())) {
+            continue;
+        }
+
+        KDNode<CoordType, KDimensions>* node = pending.node;
+        for (std::size_t level = pending.depth; node != nullptr; ++level) {
+            CoordType distance = squaredDistance(point, node->point);
+            if (candidates.size() < k) {
+                candidates.emplace(distance, node->uniqueID);
+            } else if (distance < candidates.top().first) {
+                candidates.pop();
+                candidates.emplace(distance, node->uniqueID);
+            }
+
+            std::size_t axis = level % KDimensions;
+            CoordType planeDiff = point[axis] - node->point[axis];
+            KDNode<CoordType, KDimensions>* farChild = planeDiff < 0 ? node->right : node->left;
+            if (farChild != nullptr && planeDiff * planeDiff < pruneDistance()) {
+                stack.push_back(PendingNode{farChild, level + 1, planeDiff * planeDiff});
+            }
+            node = planeDiff < 0 ? node->left : node->right;
+        }
+    }
+}
+
+
+// Private helper function for rangeSearch, appends the ID of every point within sqrt(squared)
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::rangeCollect(
+    const std::array<CoordType, KDimensions>& point, CoordType squared, std::vector<std::uint64_t>& result) const {
+    std::vector<PendingNode> stack;
+    stack.reserve(64);
+    stack.push_back(PendingNode{root, 0, CoordType()});
+    while (!stack.empty()) {
+        PendingNode pending = stack.back();
+        stack.pop_back();
+
+        KDNode<CoordType, KDimensions>* node = pending.node;
+        for (std::size_t level = pending.depth; node != nullptr; ++level) {
+            if (squaredDistance(point, node->point) <= squared) {
+                result.push_back(node->uniqueID);
+            }
+
+            // The far side can still hold a point at exactly the range when it lies on the plane
+            std::size_t axis = level % KDimensions;
+            CoordType planeDiff = point[axis] - node->point[axis];
+            KDNode<CoordType, KDimensions>* farChild = planeDiff < 0 ? node->right : node->left;
+            if (farChild != nullptr && planeDiff * planeDiff <= squared) {
+                stack.push_back(PendingNode{farChild, level + 1, planeDiff * planeDiff});
+            }
+            node = planeDiff < 0 ? node->left : node->right;
+        }
+    }
+}
+
+
+// Private helper function, the query indices sorted along a Z-order (Morton) curve over the bounding
+// box of the queries, nearby queries end up next to each other
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::vector<std::size_t> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::zOrder(
+    const std::vector<std::array<CoordType, KDimensions>>& queries) {
+    std::vector<std::size_t> order(queries.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+
+    // 64 bit codes, the dimensions share the bits (21 each in 3D, at most 32)
+    constexpr unsigned bits = KDimensions < 2 ? 32u : KDimensions < 64 ? static_cast<unsigned>(64 / KDimensions) : 1u;
+    constexpr std::size_t coded = KDimensions < 64 ? KDimensions : 64;
+    if (queries.size() < 2) {
+        return order;
+    }
+
+    std::array<CoordType, KDimensions> low = queries[0], high = queries[0];
+    for (const std::array<CoordType, KDimensions>& query : queries) {
+        for (std::size_t d = 0; d < KDimensions; ++d) {
+            low[d] = std::min(low[d], query[d]);
+            high[d] = std::max(high[d], query[d]);
+        }
+    }
+    std::array<double, KDimensions> scale;
+    const double cells = static_cast<double>((std::uint64_t(1) << bits) - 1);
+    for (std::size_t d = 0; d < KDimensions; ++d) {
+        double extent = static_cast<double>(high[d] - low[d]);
+        scale[d] = extent > 0 ? cells / extent : 0.0;
+    }
+
+    std::vector<std::pair<std::uint64_t, std::size_t>> keyed(queries.size());
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        std::array<std::uint64_t, coded> cell;
+        for (std::size_t d = 0; d < coded; ++d) {
+            cell[d] = static_cast<std::uint64_t>(static_cast<double>(queries[i][d] - low[d]) * scale[d]);
+        }
+        std::uint64_t code = 0;
+        for (unsigned b = bits; b > 0; --b) {
+            for (std::size_t d = 0; d < coded; ++d) {
+                code = (code << 1) | ((cell[d] >> (b - 1)) & 1u);
+            }
+        }
+        keyed[i] = std::make_pair(code, i);
+    }
+    std::sort(keyed.begin(), keyed.end());
+    for (std::size_t i = 0; i < keyed.size(); ++i) {
+        order[i] = keyed[i].second;
+    }
+    return order;
+}
+
+
+// Private helper function behind the batch queries, calls query(i) once for every query index. The
+// (possibly Z-ordered) indices are cut into one contiguous slice per thread, the calling thread takes
+// the last one. query(i) must only write to the result slot of i.
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+template <class Query>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::runBatch(
+    const std::vector<std::array<CoordType, KDimensions>>& queries, unsigned threads, bool sortQueries, Query query) const {
+    std::vector<std::size_t> order;
+    if (sortQueries) {
+        order = zOrder(queries);
+    } else {
+        order.resize(queries.size());
+        std::iota(order.begin(), order.end(), std::size_t(0));
+    }
+
+    // A thread has to get enough queries to pay for its start
+    const std::size_t minQueriesPerThread = 256;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t slices = std::min<std::size_t>(threads, (order.size() + minQueriesPerThread - 1) / minQueriesPerThread);
+    slices = std::max<std::size_t>(slices, 1);
+
+    auto runSlice = [&order, &query](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            query(order[i]);
+        }
+    };
+
+    // With the room reserved, starting a thread is the only thing below that can throw
+    std::vector<std::thread> workers;
+    workers.reserve(slices - 1);
+    std::vector<std::exception_ptr> errors(slices);
+    std::size_t begin = 0;
+    for (std::size_t slice = 0; slice + 1 < slices; ++slice) {
+        std::size_t end = order.size() * (slice + 1) / slices;
+        try {
+            workers.emplace_back([&runSlice, &errors, slice, begin, end]() {
+                try {
+                    runSlice(begin, end);
+                } catch (...) {
+                    errors[slice] = std::current_exception();
+                }
+            });
+        } catch (const std::system_error&) {
+            // No thread available, the calling thread takes the rest
+            break;
+        } catch (...) {
+            // Out of memory for the thread state, the running threads must be joined before unwinding
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+            throw;
+        }
+        begin = end;
+    }
+    try {
+        runSlice(begin, order.size());
+    } catch (...) {
+        errors.back() = std::current_exception();
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+
+// Private helper function to build a balanced subtree from the nodes in [first, last)
+// The node with the median coordinate on the axis of this depth becomes the subtree root, everything
+// strictly below it goes left and the rest right, the same rule insertIntoTree and the queries follow.
+// With threads > 1 the left subtree is built on a new thread while this one builds the right subtree,
+// the ranges are disjoint so no synchronisation is needed beyond the join.
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+KDNode<CoordType, KDimensions>* IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::buildRecursive(
+    KDNode<CoordType, KDimensions>** first, KDNode<CoordType, KDimensions>** last, std::size_t depth, unsigned threads) {
+    if (first == last) {
+        return nullptr;
+    }
+
+    std::size_t axis = depth % KDimensions;
+    auto below = [axis](const KDNode<CoordType, KDimensions>* a, const KDNode<CoordType, KDimensions>* b) {
+        return a->point[axis] < b->point[axis];
+    };
+
+    // Median split, then move the first node equal to the median into the middle so the left side
+    // only holds smaller coordinates
+    KDNode<CoordType, KDimensions>** middle = first + (last - first) / 2;
+    std::nth_element(first, middle, last, below);
+    CoordType median = (*middle)->point[axis];
+    KDNode<CoordType, KDimensions>** split = std::partition(first, middle, [axis, median](const KDNode<CoordType, KDimensions>* node) {
+        return node->point[axis] < median;
+    });
+    std::swap(*split, *middle);
+    KDNode<CoordType, KDimensions>* node = *split;
+
+    // Small subtrees are not worth a thread
+    const std::ptrdiff_t parallelThreshold = 1 << 14;
+    if (threads > 1 && last - first >= parallelThreshold) {
+        std::thread leftBuilder;
+        std::exception_ptr leftError; // What the left build threw, rethrown here after the join
+        try {
+            leftBuilder = std::thread([&node, &leftError, first, split, depth, threads]() {
+                try {
+                    node->left = buildRecursive(first, split, depth + 1, threads / 2);
+                } catch (...) {
+                    leftError = std::current_exception();
+                }
+            });
+        } catch (const std::system_error&) {
+            // No thread available, build the left side here as well
+        }
+        if (leftBuilder.joinable()) {
+            try {
+                node->right = buildRecursive(split + 1, last, depth + 1, threads - threads / 2);
+            } catch (...) {
+                leftBuilder.join(); // Never unwind past a joinable thread
+                throw;
+            }
+            leftBuilder.join();
+            if (leftError) {
+                std::rethrow_exception(leftError);
+            }
+            return node;
+        }
+    }
+    node->left = buildRecursive(first, split, depth + 1, 1);
+    node->right = buildRecursive(split + 1, last, depth + 1, 1);
+    return node;
+}
+
+
 // Private helper function to clear the KD-tree
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::clearTree() {
-    // Call a private recursive function to clear the tree starting from the root
-    clearRecursive(root);
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::clearTree() {
+    // Drop every node at once when the allocator supports it, otherwise clear recursively from the root
+    if (!tryReleaseAllNodes(nodeAlloc)) {
+        clearRecursive(root);
+        releaseAllNodes(nodeAlloc);
+    }
 
     // Set the root pointer to nullptr
     root = nullptr;
 }
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::clearRecursive(KDNode<CoordType, KDimensions>* node) {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::clearRecursive(KDNode<CoordType, KDimensions>* node) {
     if (node) {
         // Recursively clear the left subtree
         clearRecursive(node->left);
         // Recursively clear the right subtree
         clearRecursive(node->right);
         // Delete the current node
-        delete node;
+        destroyNode(nodeAlloc, node);
     }
 }
 
@@ -355,8 +736,8 @@ void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::clearRecursive(KDN
 */
 
 // Manage the tree
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::insert(
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::insert(
     const std::array<CoordType, KDimensions>& point, const DerivedUserData& userData) {
 
     // call tree insert helper and make it return ID, set this ID to a var
@@ -368,8 +749,46 @@ std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::insert(
 }
 
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::remove(std::uint64_t uniqueID) {
+// Replaces the content with a balanced tree of the given points, userData[i] belongs to points[i]
+// Nodes and map entries are created on the calling thread (the allocator and the ID counter are not
+// shared safely), only the partitioning runs in parallel. Returns the unique IDs in input order.
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::vector<std::uint64_t> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::build(
+    const std::vector<std::array<CoordType, KDimensions>>& points, const std::vector<DerivedUserData>& userData, unsigned threads) {
+    if (points.size() != userData.size()) {
+        throw std::invalid_argument("build expects one userData entry per point");
+    }
+
+    clear();
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<KDNode<CoordType, KDimensions>*> nodes;
+    std::vector<std::uint64_t> ids;
+    nodes.reserve(points.size());
+    ids.reserve(points.size());
+    try {
+        dataMap.reserve(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            nodes.push_back(constructNode(nodeAlloc, points[i]));
+            ids.push_back(insertIntoMap(nodes.back(), userData[i]));
+        }
+        root = buildRecursive(nodes.data(), nodes.data() + nodes.size(), 0, threads);
+    } catch (...) {
+        // Nothing is reachable from root yet, drop the nodes made so far
+        for (KDNode<CoordType, KDimensions>* node : nodes) {
+            destroyNode(nodeAlloc, node);
+        }
+        dataMap.clear();
+        throw;
+    }
+    return ids;
+}
+
+
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::remove(std::uint64_t uniqueID) {
     auto it = dataMap.find(uniqueID);
     if (it != dataMap.end()) {
         // Get the coordinates from the tuple
@@ -384,8 +803,8 @@ void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::remove(std::uint64
 }
 
 // Public method to clear the KD-tree
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::clear() {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::clear() {
     // Clear the KD-tree
     clearTree();
     // Clear the data map
@@ -393,208 +812,126 @@ void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::clear() {
 }
 
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-std::size_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::size() const {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::size_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::size() const {
     // Return the size of the dataMap, which is equivalent to the number of points in the KD-tree
     return dataMap.size();
 }
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::nearestNeighbor(
-    const std::array<CoordType, KDimensions>& point)const  {
-
-    // Initialize the best candidate and its distance
-    KDNode<CoordType, KDimensions>* bestCandidate = nullptr;
-    CoordType bestDistance = std::numeric_limits<CoordType>::max();
-
-    // Helper function to calculate squared Euclidean distance between two points
-    auto calculateSquaredDistance = [](const std::array<CoordType, KDimensions>& p1,
-                                        const std::array<CoordType, KDimensions>& p2) -> CoordType {
-        CoordType squaredDistance = 0;
-        for (std::size_t i = 0; i < KDimensions; ++i) {
-            CoordType diff = p1[i] - p2[i];
-            squaredDistance += diff * diff;
-        }
-        return squaredDistance;
-    };
-
-    // Recursive helper function to traverse the KD-tree and find the nearest neighbor
-    std::function<void(KDNode<CoordType, KDimensions>*, std::size_t)> traverse;
-    traverse = [&](KDNode<CoordType, KDimensions>* node, std::size_t depth) {
-        if (node == nullptr) {
-            return;
-        }
-
-        // Calculate the distance between the point and the current node's coordinates
-        CoordType distance = calculateSquaredDistance(point, node->point);
-
-        // Update the best candidate if the current node is closer
-        if (distance < bestDistance) {
-            bestCandidate = node;
-            bestDistance = distance;
-        }
-
-        // Determine the splitting axis for the current node
-        std::size_t axis = depth % KDimensions;
-
-        // Choose the appropriate child node to visit first based on the splitting axis
-        KDNode<CoordType, KDimensions>* firstChild = (point[axis] < node->point[axis]) ? node->left : node->right;
-        KDNode<CoordType, KDimensions>* secondChild = (point[axis] < node->point[axis]) ? node->right : node->left;
-
-        // Recursively visit the child that is on the same side as the query point
-        traverse(firstChild, depth + 1);
-
-        // Check if we need to visit the other side based on the distance to the splitting plane
-        if ((node->point[axis] - point[axis]) * (node->point[axis] - point[axis]) < bestDistance) {
-            traverse(secondChild, depth + 1);
-        }
-    };
-
-    // Start traversing the KD-tree from the root
-    traverse(root, 0);
-
-    // Return the unique ID of the nearest point
-    return bestCandidate->uniqueID;
-
-
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::nearestNeighbor(
+    const std::array<CoordType, KDimensions>& point) const {
+    // Every point is within the largest distance, so only an empty tree finds nothing
+    CoordType bestDistance;
+    KDNode<CoordType, KDimensions>* best = nearestNode(point, std::numeric_limits<CoordType>::max(), bestDistance);
+    return best != nullptr ? best->uniqueID : 0;
 }
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::nearestNeighborWithinRange(
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::uint64_t IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::nearestNeighborWithinRange(
     const std::array<CoordType, KDimensions>& queryPoint, CoordType maxDistance) const
 {
-    if (!root) {
-        // Handle the case when the tree is empty
-        // For example, you can throw an exception or return a sentinel value.
-        return 0; // Replace with an appropriate value or logic.
-    }
-
-    // Helper function to calculate the squared distance between two points
-    auto squaredDistance = [](const std::array<CoordType, KDimensions>& p1,
-                              const std::array<CoordType, KDimensions>& p2) {
-        CoordType distance = 0;
-        for (std::size_t i = 0; i < KDimensions; ++i) {
-            CoordType diff = p1[i] - p2[i];
-            distance += diff * diff;
-        }
-        return distance;
-    };
-
-    // Initialize the nearest neighbor ID and distance
-    std::uint64_t nearestNeighborID = 0;
-    CoordType nearestDistance = std::numeric_limits<CoordType>::max();
-
-    // Start recursive traversal to find nearest neighbor within range
-    nearestNeighborWithinRangeRecursive(root, queryPoint, maxDistance, nearestNeighborID, nearestDistance);
+    // 0 when the tree is empty or no point is within maxDistance
+    CoordType bestDistance;
+    KDNode<CoordType, KDimensions>* best = nearestNode(queryPoint, maxDistance * maxDistance, bestDistance);
+    return best != nullptr ? best->uniqueID : 0;
+}
 
-    return nearestNeighborID;
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::vector<std::uint64_t> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::rangeSearch(
+    const std::array<CoordType, KDimensions>& point, CoordType distance) const {
+    // IDs of every point within distance (inclusive), in no particular order
+    std::vector<std::uint64_t> result;
+    rangeCollect(point, distance * distance, result);
+    return result;
 }
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::nearestNeighborWithinRangeRecursive(
-    KDNode<CoordType, KDimensions>* node, const std::array<CoordType, KDimensions>& queryPoint,
-    CoordType maxDistance, std::uint64_t& nearestNeighborID, CoordType& nearestDistance) const
-{
-    if (!node)
-        return;
 
-    // Calculate the squared distance from the query point to the node's point
-    CoordType distance = 0;
-    for (std::size_t i = 0; i < KDimensions; ++i) {
-        CoordType diff = node->point[i] - queryPoint[i];
-        distance += diff * diff;
-    }
 
-    // Update the nearest neighbor if the current node is closer and within range
-    if (distance < nearestDistance && distance <= maxDistance * maxDistance) {
-        nearestNeighborID = node->uniqueID;
-        nearestDistance = distance;
+// The k points closest to point, fewer when the tree holds fewer, sorted by increasing distance
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::vector<std::pair<std::uint64_t, CoordType>> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::kNearest(
+    const std::array<CoordType, KDimensions>& point, std::size_t k) const {
+    std::vector<std::pair<std::uint64_t, CoordType>> result;
+    if (k == 0) {
+        return result;
     }
 
-    // Decide which subtree to visit first based on splitting dimension
-    std::size_t splitDim = getTreeDepth() % KDimensions;
-    if (queryPoint[splitDim] < node->point[splitDim]) {
-        nearestNeighborWithinRangeRecursive(node->left, queryPoint, maxDistance, nearestNeighborID, nearestDistance);
-        if (node->point[splitDim] - queryPoint[splitDim] <= maxDistance)
-            nearestNeighborWithinRangeRecursive(node->right, queryPoint, maxDistance, nearestNeighborID, nearestDistance);
-    } else {
-        nearestNeighborWithinRangeRecursive(node->right, queryPoint, maxDistance, nearestNeighborID, nearestDistance);
-        if (queryPoint[splitDim] - node->point[splitDim] <= maxDistance)
-            nearestNeighborWithinRangeRecursive(node->left, queryPoint, maxDistance, nearestNeighborID, nearestDistance);
+    Candidates candidates;
+    kNearestCandidates(point, k, candidates);
+
+    // The heap pops the farthest first
+    result.resize(candidates.size());
+    for (std::size_t i = result.size(); i > 0; --i) {
+        result[i - 1] = std::make_pair(candidates.top().second, candidates.top().first);
+        candidates.pop();
     }
+    return result;
 }
 
 
+// One nearest neighbor per query, 0 when the tree is empty
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::vector<std::uint64_t> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::nearestNeighborBatch(
+    const std::vector<std::array<CoordType, KDimensions>>& queries, unsigned threads, bool sortQueries) const {
+    std::vector<std::uint64_t> result(queries.size(), 0);
+    runBatch(queries, threads, sortQueries, [this, &queries, &result](std::size_t i) {
+        result[i] = nearestNeighbor(queries[i]);
+    });
+    return result;
+}
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-std::vector<std::uint64_t> IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::rangeSearch(
-    const std::array<CoordType, KDimensions>& point, CoordType distance) const {
-
-    // Initialize a vector to store unique IDs within the range
-    std::vector<std::uint64_t> result;
-
-    // Helper function to calculate squared Euclidean distance between two points
-    auto calculateSquaredDistance = [](const std::array<CoordType, KDimensions>& p1,
-                                        const std::array<CoordType, KDimensions>& p2) -> CoordType {
-        CoordType squaredDistance = 0;
-        for (std::size_t i = 0; i < KDimensions; ++i) {
-            CoordType diff = p1[i] - p2[i];
-            squaredDistance += diff * diff;
-        }
-        return squaredDistance;
-    };
-
-    // Recursive helper function to traverse the KD-tree and find points within the range
-    std::function<void(KDNode<CoordType, KDimensions>*)> traverse;
-    traverse = [&](KDNode<CoordType, KDimensions>* node) {
-        if (node == nullptr) {
-            return;
-        }
-
-        // Calculate the squared distance between the point and the current node's coordinates
-        CoordType squaredDistance = calculateSquaredDistance(point, node->point);
-
-        // If the squared distance is within the specified range, add the unique ID to the result
-        if (squaredDistance <= distance * distance) {
-            result.emplace_back(node->uniqueID);
-        }
-
-        // Determine the splitting axis for the current node using getTreeDepth()
-        std::size_t axis = getTreeDepth() % KDimensions;
 
-        // Check if we need to visit the left or right child based on the splitting axis
-        if (point[axis] < node->point[axis]) {
-            traverse(node->left);
-            if ((node->point[axis] - point[axis]) * (node->point[axis] - point[axis]) < distance * distance) {
-                traverse(node->right);
-            }
-        } else {
-            traverse(node->right);
-            if ((node->point[axis] - point[axis]) * (node->point[axis] - point[axis]) < distance * distance) {
-                traverse(node->left);
-            }
-        }
-    };
+// kNearest for every query
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::vector<std::vector<std::pair<std::uint64_t, CoordType>>> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::kNearestBatch(
+    const std::vector<std::array<CoordType, KDimensions>>& queries, std::size_t k, unsigned threads, bool sortQueries) const {
+    std::vector<std::vector<std::pair<std::uint64_t, CoordType>>> result(queries.size());
+    runBatch(queries, threads, sortQueries, [this, &queries, &result, k](std::size_t i) {
+        result[i] = kNearest(queries[i], k);
+    });
+    return result;
+}
 
-    // Start traversing the KD-tree from the root
-    traverse(root);
 
-    // Return the vector of unique IDs within the specified range
+// rangeSearch for every query, same distance for all of them
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::vector<std::vector<std::uint64_t>> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::rangeSearchBatch(
+    const std::vector<std::array<CoordType, KDimensions>>& queries, CoordType distance, unsigned threads, bool sortQueries) const {
+    std::vector<std::vector<std::uint64_t>> result(queries.size());
+    runBatch(queries, threads, sortQueries, [this, &queries, &result, distance](std::size_t i) {
+        result[i] = rangeSearch(queries[i], distance);
+    });
     return result;
 }
 
 
-
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-bool IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::contains(std::uint64_t uniqueID) const {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+bool IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::contains(std::uint64_t uniqueID) const {
     // Check if the uniqueID exists in the dataMap
     return dataMap.find(uniqueID) != dataMap.end();
 }
 
 
+// The ID map holds every point with its coordinates, no tree walk needed
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+template <std::size_t BucketSize>
+FlatKDTree<CoordType, KDimensions, BucketSize> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::flatten() const {
+    std::vector<std::array<CoordType, KDimensions>> points;
+    std::vector<std::uint64_t> ids;
+    points.reserve(dataMap.size());
+    ids.reserve(dataMap.size());
+    for (const auto& entry : dataMap) {
+        ids.push_back(entry.first);
+        points.push_back(entry.second.second);
+    }
+    return FlatKDTree<CoordType, KDimensions, BucketSize>(points, ids);
+}
+
+
 // Manage user-defined data associated with a point & KD-tree synchronization
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::setPointCoordinates(std::uint64_t uniqueID, const std::array<CoordType, KDimensions>& newCoordinates) {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::setPointCoordinates(std::uint64_t uniqueID, const std::array<CoordType, KDimensions>& newCoordinates) {
     auto it = dataMap.find(uniqueID);
     if (it != dataMap.end()) {
         //get old cords
@@ -606,8 +943,8 @@ void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::setPointCoordinate
     }
 }
 
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::setUserData(std::uint64_t uniqueID, const UserBaseStruct& userData) {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+void IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::setUserData(std::uint64_t uniqueID, const UserBaseStruct& userData) {
     auto it = dataMap.find(uniqueID);
     if (it != dataMap.end()) {
         std::get<0>(it->second) = userData; // Update user data in the tuple
@@ -616,8 +953,8 @@ void IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::setUserData(std::u
 
 
 // Retrieve user data using unique ID
-template <class CoordType, std::size_t KDimensions, class DerivedUserData>
-std::shared_ptr<UserBaseStruct> IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::getUserData(std::uint64_t uniqueID) const {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+std::shared_ptr<UserBaseStruct> IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::getUserData(std::uint64_t uniqueID) const {
     auto it = dataMap.find(uniqueID);
     if (it != dataMap.end()) {
         return it->second.first;
@@ -628,8 +965,8 @@ std::shared_ptr<UserBaseStruct> IDMappedKDTree<CoordType, KDimensions, DerivedUs
 
 
 // Retrieve coordinates using unique ID
-template <class CoordType, std::size_t KDimensions,class DerivedUserData>
-const std::array<CoordType, KDimensions>& IDMappedKDTree<CoordType, KDimensions, DerivedUserData>::getCoordinates(std::uint64_t uniqueID) const {
+template <class CoordType, std::size_t KDimensions, class DerivedUserData, class Alloc>
+const std::array<CoordType, KDimensions>& IDMappedKDTree<CoordType, KDimensions, DerivedUserData, Alloc>::getCoordinates(std::uint64_t uniqueID) const {
     return std::get<1>(dataMap.at(uniqueID));
 }
 
@@ -1,27 +1,31 @@
 #ifndef MAX_HEAP_TREE_H
 #define MAX_HEAP_TREE_H
 
+#include <functional>
+#include <utility>
 #include <vector>
 
 /*
     Max Heap Tree is a complete binary tree where the value of each node is greater than or equal to the value of its children.
     The root node will always contain the largest value.
+    "Greater" is in the order of Compare (std::less<T> by default), as for std::priority_queue.
 */
 
 namespace VLIB{
 
-template <class T>
+template <class T, class Compare = std::less<T>>
 class MaxHeapTree{
 private:
     std::vector<T> _vector;
+    Compare comp;
     void BubbleDown(int index);
     void BubbleUp(int index);
     void Heapify();
 
 public:
-    MaxHeapTree(T* array, int length);
-    MaxHeapTree(const std::vector<T>& vector);
-    MaxHeapTree();
+    MaxHeapTree(T* array, int length, const Compare& comp = Compare());
+    MaxHeapTree(const std::vector<T>& vector, const Compare& comp = Compare());
+    explicit MaxHeapTree(const Compare& comp = Compare());
 
     void Insert(T value);
     T GetMax();
@@ -32,8 +36,8 @@ public:
     const bool empty() const { return _vector.empty(); }
 };
 
-template <class T>
-MaxHeapTree<T>::MaxHeapTree(T* array, int length) : _vector(length)
+template <class T, class Compare>
+MaxHeapTree<T, Compare>::MaxHeapTree(T* array, int length, const Compare& comp) : _vector(length), comp(comp)
 {
     for(int i = 0; i < length; ++i)
     {
@@ -43,19 +47,19 @@ MaxHeapTree<T>::MaxHeapTree(T* array, int length) : _vector(length)
     Heapify();
 }
 
-template <class T>
-MaxHeapTree<T>::MaxHeapTree(const std::vector<T>& vector) : _vector(vector)
+template <class T, class Compare>
+MaxHeapTree<T, Compare>::MaxHeapTree(const std::vector<T>& vector, const Compare& comp) : _vector(vector), comp(comp)
 {
     Heapify();
 }
 
-template <class T>
-MaxHeapTree<T>::MaxHeapTree() 
+template <class T, class Compare>
+MaxHeapTree<T, Compare>::MaxHeapTree(const Compare& comp) : comp(comp)
 {
 }
 
-template <class T>
-void MaxHeapTree<T>::Heapify()
+template <class T, class Compare>
+void MaxHeapTree<T, Compare>::Heapify()
 {
     int length = _vector.size();
     for(int i=length-1; i>=0; --i)
@@ -64,8 +68,8 @@ void MaxHeapTree<T>::Heapify()
     }
 }
 
-template <class T>
-void MaxHeapTree<T>::BubbleDown(int index)
+template <class T, class Compare>
+void MaxHeapTree<T, Compare>::BubbleDown(int index)
 {
     int length = _vector.size();
     int leftChildIndex = 2*index + 1;
@@ -76,12 +80,12 @@ void MaxHeapTree<T>::BubbleDown(int index)
 
     int maxIndex = index;
 
-    if(_vector[index] < _vector[leftChildIndex])
+    if(comp(_vector[index], _vector[leftChildIndex]))
     {
         maxIndex = leftChildIndex;
     }
     
-    if((rightChildIndex < length) && (_vector[maxIndex] < _vector[rightChildIndex]))
+    if((rightChildIndex < length) && comp(_vector[maxIndex], _vector[rightChildIndex]))
     {
         maxIndex = rightChildIndex;
     }
@@ -89,32 +93,28 @@ void MaxHeapTree<T>::BubbleDown(int index)
     if(maxIndex != index)
     {
         //need to swap
-        T temp = _vector[index];
-        _vector[index] = _vector[maxIndex];
-        _vector[maxIndex] = temp;
+        std::swap(_vector[index], _vector[maxIndex]);
         BubbleDown(maxIndex);
     }
 }
 
-template <class T>
-void MaxHeapTree<T>::BubbleUp(int index)
+template <class T, class Compare>
+void MaxHeapTree<T, Compare>::BubbleUp(int index)
 {
     if(index == 0)
         return;
 
     int parentIndex = (index-1)/2;
 
-    if(_vector[parentIndex] < _vector[index])
+    if(comp(_vector[parentIndex], _vector[index]))
     {
-        T temp = _vector[parentIndex];
-        _vector[parentIndex] = _vector[index];
-        _vector[index] = temp;
+        std::swap(_vector[parentIndex], _vector[index]);
         BubbleUp(parentIndex);
     }
 }
 
-template <class T>
-void MaxHeapTree<T>::Insert(T newValue)
+template <class T, class Compare>
+void MaxHeapTree<T, Compare>::Insert(T newValue)
 {
     int length = _vector.size();
     _vector.push_back(newValue);
@@ -122,14 +122,14 @@ void MaxHeapTree<T>::Insert(T newValue)
     BubbleUp(length);
 }
 
-template <class T>
-T MaxHeapTree<T>::GetMax()
+template <class T, class Compare>
+T MaxHeapTree<T, Compare>::GetMax()
 {
     return _vector[0];
 }
     
-template <class T>
-void MaxHeapTree<T>::DeleteMax()
+template <class T, class Compare>
+void MaxHeapTree<T, Compare>::DeleteMax()
 {
     int length = _vector.size();
 
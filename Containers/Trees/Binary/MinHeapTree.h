@@ -3,26 +3,30 @@
 #ifndef MIN_HEAP_TREE_H
 #define MIN_HEAP_TREE_H
 
+#include <functional>
+#include <utility>
 #include <vector>
 
 /*
     Min Heap Tree is a complete binary tree where the value of each node is less than or equal to the value of its children.
     The root node will always contain the smallest value.
+    "Less" is Compare (std::less<T> by default), MinHeapTree<Task, ByDeadline> keeps the earliest deadline on top.
 */
 namespace VLIB{
 
-template <class T>
+template <class T, class Compare = std::less<T>>
 class MinHeapTree{
 private:
     std::vector<T> _vector;
+    Compare comp;
     void BubbleDown(int index);
     void BubbleUp(int index);
     void Heapify();
 
 public:
-    MinHeapTree(T* array, int lenght);
-    MinHeapTree(const std::vector<T>& vector);
-    MinHeapTree();
+    MinHeapTree(T* array, int lenght, const Compare& comp = Compare());
+    MinHeapTree(const std::vector<T>& vector, const Compare& comp = Compare());
+    explicit MinHeapTree(const Compare& comp = Compare());
 
     void Insert(T value);
     T GetMin();
@@ -33,8 +37,8 @@ public:
     const bool empty() const { return _vector.empty(); }
 };
 
-template <class T>
-MinHeapTree<T>::MinHeapTree(T* array, int length) : _vector(length)
+template <class T, class Compare>
+MinHeapTree<T, Compare>::MinHeapTree(T* array, int length, const Compare& comp) : _vector(length), comp(comp)
 {
     for(int i = 0; i < length; ++i)
     {
@@ -44,19 +48,19 @@ MinHeapTree<T>::MinHeapTree(T* array, int length) : _vector(length)
     Heapify();
 }
 
-template <class T>
-MinHeapTree<T>::MinHeapTree(const std::vector<T>& vector) : _vector(vector)
+template <class T, class Compare>
+MinHeapTree<T, Compare>::MinHeapTree(const std::vector<T>& vector, const Compare& comp) : _vector(vector), comp(comp)
 {
     Heapify();
 }
 
-template <class T>
-MinHeapTree<T>::MinHeapTree() 
+template <class T, class Compare>
+MinHeapTree<T, Compare>::MinHeapTree(const Compare& comp) : comp(comp)
 {
 }
 
-template <class T>
-void MinHeapTree<T>::Heapify()
+template <class T, class Compare>
+void MinHeapTree<T, Compare>::Heapify()
 {
     int length = _vector.size();
     for(int i=length-1; i>=0; --i)
@@ -65,8 +69,8 @@ void MinHeapTree<T>::Heapify()
     }
 }
 
-template <class T>
-void MinHeapTree<T>::BubbleDown(int index)
+template <class T, class Compare>
+void MinHeapTree<T, Compare>::BubbleDown(int index)
 {
     int length = _vector.size();
     int leftChildIndex = 2*index + 1;
@@ -77,12 +81,12 @@ void MinHeapTree<T>::BubbleDown(int index)
 
     int minIndex = index;
 
-    if(_vector[index] > _vector[leftChildIndex])
+    if(comp(_vector[leftChildIndex], _vector[index]))
     {
         minIndex = leftChildIndex;
     }
     
-    if((rightChildIndex < length) && (_vector[minIndex] > _vector[rightChildIndex]))
+    if((rightChildIndex < length) && comp(_vector[rightChildIndex], _vector[minIndex]))
     {
         minIndex = rightChildIndex;
     }
@@ -90,47 +94,43 @@ void MinHeapTree<T>::BubbleDown(int index)
     if(minIndex != index)
     {
         //need to swap
-        int temp = _vector[index];
-        _vector[index] = _vector[minIndex];
-        _vector[minIndex] = temp;
+        std::swap(_vector[index], _vector[minIndex]);
         BubbleDown(minIndex);
     }
 }
 
-template <class T>
-void MinHeapTree<T>::BubbleUp(int index)
+template <class T, class Compare>
+void MinHeapTree<T, Compare>::BubbleUp(int index)
 {
     if(index == 0)
         return;
 
     int parentIndex = (index-1)/2;
 
-    if(_vector[parentIndex] > _vector[index])
+    if(comp(_vector[index], _vector[parentIndex]))
     {
-        int temp = _vector[parentIndex];
-        _vector[parentIndex] = _vector[index];
-        _vector[index] = temp;
+        std::swap(_vector[parentIndex], _vector[index]);
         BubbleUp(parentIndex);
     }
 }
 
-template <class T>
-void MinHeapTree<T>::Insert(T newValue)
+template <class T, class Compare>
+void MinHeapTree<T, Compare>::Insert(T newValue)
 {
     int length = _vector.size();
-    _vector[length] = newValue;
+    _vector.push_back(newValue);
 
     BubbleUp(length);
 }
 
-template <class T>
-T MinHeapTree<T>::GetMin()
+template <class T, class Compare>
+T MinHeapTree<T, Compare>::GetMin()
 {
     return _vector[0];
 }
     
-template <class T>
-void MinHeapTree<T>::DeleteMin()
+template <class T, class Compare>
+void MinHeapTree<T, Compare>::DeleteMin()
 {
     int length = _vector.size();
 
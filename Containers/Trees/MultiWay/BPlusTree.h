@@ -1,1546 +1,821 @@
 #ifndef __BPLUS_TREE_H__
 #define __BPLUS_TREE_H__
 
-//Here template is used as T(dataType),N(Max Keys in Internal Node),M(Max Keys in External Node) keys are soley used as
-// routing keys in internal nodes meanwhile keys in external ones are used as data keys.
-
-// The data is embedded in a common base class for internal and external nodes.
-
+//Here template is used as T(dataType),N(Max children of an internal node, so N - 1 routing keys),M(Max keys in an external node)
+// keys are soley used as routing keys in internal nodes meanwhile keys in external ones are used as data keys.
+// V is an optional payload stored next to every data key, void (the default) gives a plain set of keys.
+
+// Nodes are plain structs without virtual functions, the node kind is a flag in the common header.
+// Internal nodes hold a key array and a child array, external (leaf) nodes a contiguous key array and,
+// when V is not void, a payload array of the same length. A lookup reads one key array per level,
+// searched with NodeLowerBound / NodeUpperBound (SIMD for arithmetic keys, see NodeSearch.h).
+
+// Nodes are allocated through Alloc (std::allocator<T> by default) rebound to the concrete node type.
+
+/*
+    Initialization:
+        BPlusTree<int, 4, 4> tree;                   // set of ints
+        tree.Insert(10);
+
+        BPlusTreeMap<int, std::string, 16, 16> map;  // int -> std::string
+        map.Insert(10, "ten");
+        std::string* value = map.Find(10);           // nullptr when the key is missing
+
+    Range scans walk the linked leaf chain, no re-descent per key:
+        auto range = tree.Range(10, 20);             // every key in [10, 20]
+        for (auto it = range.first; it != range.second; ++it)
+            std::cout << *it;                        // it.Value() gives the payload of a map
+        for (int key : tree) ...                     // whole tree in order
+
+    Iterators are invalidated by Insert, Delete and Clear.
+
+    Building from sorted input is linear, leaves are packed left to right and the levels above
+    are stacked on top, no descents and no splits:
+        std::vector<int> sorted = ...;               // strictly increasing
+        tree.BulkLoad(sorted.begin(), sorted.end(), 0.9); // leaves and internal nodes 90% full
+    A map loads from (key, value) pairs.
+
+    T (and V) need to be default constructible. Keys are ordered by Compare (std::less<T> by default),
+    a transparent one (std::less<>) also takes lookup keys of other types:
+        BPlusTree<std::string, 16, 16, std::allocator<std::string>, void, std::less<>> names;
+        names.Search(std::string_view("ada"));
+    std::less<T> and std::less<> keep the SIMD node search, other comparators use a binary search per node.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../../../Memory/NodeAllocator.h"
+#include "../../Compare.h"
+#include "NodeLayout.h"
+#include "NodeSearch.h"
 
 
 namespace VLIB{ // VLIB
 
-// Forward declarations
-template <typename T, int N, int M> class BPlusTreeNode;
-template <typename T, int N, int M> class BPlusTreeExternalNode;
-template <typename T, int N, int M> class BPlusTreeInternalNode;
-
-
+//**** Nodes ****//
 
+// Common header of internal and external nodes. It sits in front of the keys since the node kind has
+// to be read before the node type is known, header and first keys share the first cache line.
+template <typename T, int N, int M, class V = void>
+struct BPlusTreeNode {
+    bool isLeaf;
+    int count; // Number of keys held by the node
 
-//**** Base class for data elements ****//
-// common base class for data elements
-template <typename T, int N, int M>
-class BPlusTreeData {
-    // Common properties or methods for data elements
-public:
-    BPlusTreeData() = default; // Default constructor
-    virtual ~BPlusTreeData() = default; // Default destructor
-    
-    virtual T GetDataValue() const = 0; // Pure virtual method to retrieve the data
-    virtual BPlusTreeNode<T, N, M>* GetNodePointer() const = 0; // Pure virtual method to retrieve the node pointer
-    virtual void setDataValue(T data) = 0;
-    virtual void setNodePointer(BPlusTreeNode<T, N, M>* node) = 0;
+    explicit BPlusTreeNode(bool leaf) : isLeaf(leaf), count(0) {}
 };
 
+// Size and alignment of one payload, nothing for key only trees
+template <class V>
+constexpr std::size_t BPlusTreePayloadBytes = sizeof(V);
+template <>
+constexpr std::size_t BPlusTreePayloadBytes<void> = 0;
+template <class V>
+constexpr std::size_t BPlusTreePayloadAlign = alignof(V);
+template <>
+constexpr std::size_t BPlusTreePayloadAlign<void> = 1;
+
+// Alignment needed by the members of a node holding T keys and V payloads
+template <typename T, class V>
+constexpr std::size_t BPlusTreeNaturalAlign = std::max({alignof(T), alignof(void*), BPlusTreePayloadAlign<V>});
+
+// Internal node, children[i] holds the keys < keys[i] and children[i + 1] the keys >= keys[i]
+template <typename T, int N, int M, class V = void>
+struct alignas(NodeAlignment(BPlusTreeNaturalAlign<T, V>)) BPlusTreeInternalNode : BPlusTreeNode<T, N, M, V> {
+    T keys[N - 1]; // One less key than children
+    BPlusTreeNode<T, N, M, V>* children[N];
 
-// Derived classes for different types of data (e.g., actual data, child node pointers)
-// External node data
-template <typename T, int N, int M>
-class BPlusTreeDataValue final : public BPlusTreeData<T, N, M> {
-private:
-    // Properties specific to data values
-    T value; // Example property
-
-public:
-    BPlusTreeDataValue(T dataValue) : value(dataValue){}
-    BPlusTreeDataValue() = default; // Default constructor
-    ~BPlusTreeDataValue() = default; // Default destructor
-
-    // pure virtual methods from the base class implementations
-    //dont use these
-    void setNodePointer(BPlusTreeNode<T, N, M>* node) override { throw std::runtime_error("External node data does not have a node pointer");}
-    BPlusTreeNode<T, N, M>* GetNodePointer() const override { throw std::runtime_error("External node data does not have a node pointer");}
-
-    // Retrieve the data value
-    T GetDataValue() const override {return value;}
-    // Set the data value
-    void setDataValue(T data) override {value = data;}
+    BPlusTreeInternalNode() : BPlusTreeNode<T, N, M, V>(false) {}
 };
 
-// Internal node data
-template <typename T, int N, int M>
-class BPlusTreeDataNodePointer final : public BPlusTreeData<T, N, M> {
-private:
-    // Properties specific to node pointers
-    BPlusTreeNode<T, N, M>* nodePointer; // Example property
-
-public:
-    BPlusTreeDataNodePointer(BPlusTreeNode<T, N, M>* pointer) : nodePointer(pointer) {}
-    ~BPlusTreeDataNodePointer() = default; // Default destructor
-
-    // Implement the pure virtual methods from the base class
-    //dont use these
-    T GetDataValue() const override { throw std::runtime_error("Internal node data does not have a data value");}
-    void setDataValue(T data) override { throw std::runtime_error("Internal node data does not have a data value");}
-
-    // Retrieve the node pointer
-    BPlusTreeNode<T, N, M>* GetNodePointer() const override {return nodePointer;}
-    // Set the node pointer
-    void setNodePointer(BPlusTreeNode<T, N, M>* node) override {nodePointer = node;}
+// Payload array of an external node, empty for key only trees
+template <class V, int M>
+struct BPlusTreeLeafPayload {
+    V values[M];
 };
 
-//**** B+ Tree nodes 1 base, 2 derived offsprings ****//
+template <int M>
+struct BPlusTreeLeafPayload<void, M> {};
 
-// Common base class for internal and external nodes
-template <typename T, int N, int M>
-class BPlusTreeNode {
-public:
-    BPlusTreeNode() {
-        // Constructor logic here (if needed)
-    }
-    virtual ~BPlusTreeNode() = default; // Default destructor
-
-    enum class NodeType { Internal, External };
-
-    // Basic operations
-    virtual NodeType GetNodeType() const = 0;
-    // 3 variants, Insert(Base) is entry point and route to the right one with casting
-    virtual bool Insert(BPlusTreeData<T, N, M>* data);
-    virtual bool InsertInternal(BPlusTreeDataNodePointer<T, N, M>* data) = 0;
-    virtual bool InsertExternal(BPlusTreeDataValue<T, N, M>* data) = 0;
-    // 3 variants, Delete(Base) is entry point and route to the right one with casting
-    virtual bool Delete(BPlusTreeData<T, N, M>* data);
-    virtual bool DeleteInternal(BPlusTreeDataNodePointer<T, N, M>* data) = 0;
-    virtual bool DeleteExternal(BPlusTreeDataValue<T, N, M>* data) = 0;
-    // 3 variants, Search(Base) is entry point and route to the right one with casting, cast return type to the right one
-    virtual BPlusTreeData<T, N, M>* Search(BPlusTreeData<T, N, M>* data);
-    virtual BPlusTreeDataNodePointer<T, N, M>* SearchInternal(BPlusTreeDataNodePointer<T, N, M>* data) = 0;
-    virtual BPlusTreeDataValue<T, N, M>* SearchExternal(BPlusTreeDataValue<T, N, M>* data) = 0;
-    // While no return type and no params we can soley use pure virtual and overide respectively
-    virtual BPlusTreeNode<T, N, M>* Split();
-    virtual BPlusTreeExternalNode<T, N, M>* SplitExternal() = 0;
-    virtual BPlusTreeInternalNode<T, N, M>* SplitInternal() = 0;
-
-    virtual int ChildCount() = 0;
-    virtual BPlusTreeNode<T, N, M>* GetChild(int index) = 0;
-
-    // While no return type needed(no new allocated memory = no handles created) and no params(parent ptrs) we can soley use pure virtual and overide respectively
-    virtual bool Merge() = 0;
-    // While no return type needed(no new allocated memory = no handles created) and no params we can soley use pure virtual and overide respectively
-    virtual void Print() = 0;
-    virtual bool isFull() = 0;
-    virtual BPlusTreeExternalNode<T, N, M>* FindLeafNode(T data);
-    virtual int FindChildIndex(BPlusTreeNode<T, N, M>* child) = 0;
-
-    //getters and setters
-    virtual BPlusTreeNode<T, N, M>* GetParent() = 0;
-    virtual int GetNumValues() = 0;
-    bool IsRoot();
+// External (leaf) node, keys are sorted and unique, payload.values[i] belongs to keys[i]
+// Leaves are chained in key order through next/prev for range scans
+template <typename T, int N, int M, class V = void>
+struct alignas(NodeAlignment(BPlusTreeNaturalAlign<T, V>)) BPlusTreeExternalNode : BPlusTreeNode<T, N, M, V> {
+    T keys[M];
+    BPlusTreeLeafPayload<V, M> payload;
+    BPlusTreeExternalNode* next;
+    BPlusTreeExternalNode* prev;
 
+    BPlusTreeExternalNode() : BPlusTreeNode<T, N, M, V>(true), next(nullptr), prev(nullptr) {}
 };
 
-// Derived internal node class
-template <typename T, int N, int M>
-class BPlusTreeInternalNode final : public BPlusTreeNode<T, N, M> {
-private:
-
-    // Define maximum and minimum children to merge
-    const int MAXIMUM_CHILDREN_TO_MERGE = N - 1;
-    const int MINIMUM_CHILDREN_TO_MERGE = N / 2;
-
-
-    T keys[N - 1]; // One less key than children
-    BPlusTreeNode<T, N, M>* children[N];
-    BPlusTreeNode<T, N, M>* parent; // Array to store data values
+// Bidirectional iterator over the keys of a BPlusTree in order, walks the leaf chain.
+// The end iterator sits one past the last key of the last leaf, so it can be decremented.
+template <typename T, int N, int M, class V = void>
+class BPlusTreeIterator {
 public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+    using ExternalNode = BPlusTreeExternalNode<T, N, M, V>;
 
-    BPlusTreeInternalNode();
-    virtual ~BPlusTreeInternalNode(); // Default destructor
-
-    //must be implemented but not used, IGNORE THEM
-    bool DeleteExternal(BPlusTreeDataValue<T, N, M>* data) override{ return false;};
-    bool InsertExternal(BPlusTreeDataValue<T, N, M>* data) override{ return false;};
-    BPlusTreeDataValue<T, N, M>* SearchExternal(BPlusTreeDataValue<T, N, M>* data) override{ return nullptr;};
-    BPlusTreeExternalNode<T, N, M>* SplitExternal() override { return nullptr;};
+    BPlusTreeIterator() : leaf(nullptr), index(0) {}
+    BPlusTreeIterator(ExternalNode* leaf, int index) : leaf(leaf), index(index) { Normalize(); }
 
+    const T& operator*() const { return leaf->keys[index]; }
+    const T* operator->() const { return &leaf->keys[index]; }
+    const T& Key() const { return leaf->keys[index]; }
+    template <class U = V>
+    typename std::enable_if<!std::is_void<U>::value, U&>::type Value() const { return leaf->payload.values[index]; }
 
-
-    typename BPlusTreeNode<T, N, M>::NodeType GetNodeType() const override {
-    return BPlusTreeNode<T, N, M>::NodeType::Internal;
+    BPlusTreeIterator& operator++() {
+        ++index;
+        Normalize();
+        return *this;
+    }
+    BPlusTreeIterator operator++(int) {
+        BPlusTreeIterator old = *this;
+        ++*this;
+        return old;
+    }
+    BPlusTreeIterator& operator--() {
+        if (index == 0 && leaf->prev != nullptr) {
+            leaf = leaf->prev;
+            index = leaf->count;
+        }
+        --index;
+        return *this;
+    }
+    BPlusTreeIterator operator--(int) {
+        BPlusTreeIterator old = *this;
+        --*this;
+        return old;
     }
 
-    //Basic Operations
-    bool InsertInternal(BPlusTreeDataNodePointer<T, N, M>* data) override;
-    bool DeleteInternal(BPlusTreeDataNodePointer<T, N, M>* data) override;
-    BPlusTreeDataNodePointer<T, N, M>* SearchInternal(BPlusTreeDataNodePointer<T, N, M>* data) override;
-    BPlusTreeInternalNode<T, N, M>* SplitInternal() override; // Splitting logic not same as external node
-    bool Merge() override; // Merging logic not same as external node
-    void MergeWithParent(BPlusTreeInternalNode<T, N, M>* parent, int indexInParent);
-    void Print() override; // Print logic not same as external node
-    bool isFull() override;
-    int FindChildIndex(BPlusTreeNode<T, N, M>* child) override;
-    int ChildCount() override;
-    void RemoveChild(BPlusTreeNode<T, N, M>* child);
-    bool InsertKeyAndChild(T key, BPlusTreeNode<T, N, M>* child);
-    void RemoveKeyAndChild(int index);
-    
-
-    //getters and setters
-    BPlusTreeNode<T, N, M>* GetChild(int index) override {return children[index];};
-    void SetChild(int index, BPlusTreeNode<T, N, M>* child){children[index] = child;};
-    T GetKey(int index) const {return keys[index];};
-    void SetKey(int index, T key){keys[index] = key;};
-    int GetKeyCount();
-    BPlusTreeNode<T, N, M>* GetParent() override {return parent;};
-    int GetNumValues() override;
+    bool operator==(const BPlusTreeIterator& other) const { return leaf == other.leaf && index == other.index; }
+    bool operator!=(const BPlusTreeIterator& other) const { return !(*this == other); }
 
-};
+    ExternalNode* GetLeaf() const { return leaf; }
+    int GetIndex() const { return index; }
 
-// Derived external (leaf) node class
-template <typename T, int N, int M>
-class BPlusTreeExternalNode final : public BPlusTreeNode<T, N, M> {
 private:
-    // Define maximum and minimum children to merge
-    const int MAXIMUM_CHILDREN_TO_MERGE = M - 1;
-    const int MINIMUM_CHILDREN_TO_MERGE = M / 2;
-
-    BPlusTreeDataValue<T, N, M> values[M];  // Array to store data values
-    BPlusTreeNode<T, N, M>* parent;  // Pointer to the parent node
-public:
-
-    BPlusTreeExternalNode();
-    ~BPlusTreeExternalNode(); // Default destructor
-
-    // must be implemented but not used, IGNORE THEM
-    bool DeleteInternal(BPlusTreeDataNodePointer<T, N, M>* data)override{ return false;};
-    bool InsertInternal(BPlusTreeDataNodePointer<T, N, M>* data)override{ return false;};
-    BPlusTreeDataNodePointer<T, N, M>* SearchInternal(BPlusTreeDataNodePointer<T, N, M>* data) override{ return nullptr;};
-    int FindChildIndex(BPlusTreeNode<T, N, M>* child) override{ return -1;};
-    BPlusTreeInternalNode<T, N, M>* SplitInternal()override{return nullptr;};
-    int ChildCount() override{};
-    BPlusTreeNode<T, N, M>* GetChild(int index) override{ return nullptr;};
- 
-    typename BPlusTreeNode<T, N, M>::NodeType GetNodeType() const override {
-        return BPlusTreeNode<T, N, M>::NodeType::External;
+    // Past the end of a leaf means the first key of the next one, only the last leaf keeps index == count
+    void Normalize() {
+        if (leaf != nullptr && index == leaf->count && leaf->next != nullptr) {
+            leaf = leaf->next;
+            index = 0;
+        }
     }
 
-    //Basic Operations
-    bool InsertExternal(BPlusTreeDataValue<T, N, M>* data) override;
-    bool DeleteExternal(BPlusTreeDataValue<T, N, M>* data) override;
-    BPlusTreeDataValue<T, N, M>* SearchExternal(BPlusTreeDataValue<T, N, M>* data) override;
-    BPlusTreeExternalNode<T, N, M>* SplitExternal() override; // Splitting logic not same as internal node
-    bool Merge() override; // Merging logic not same as internal node
-    void Print() override; // Print logic not same as internal node
-    bool isFull() override;
-    bool Contains(T data);
-
-    //getters and setters
-
-    BPlusTreeNode<T, N, M>* GetParent()override{return parent;};
-    void SetParent(BPlusTreeNode<T, N, M>* parent){this->parent = parent;};
-    int GetNumValues() override;
-    BPlusTreeDataValue<T, N, M>* GetValues(){return values;};
-    void SetValues(BPlusTreeDataValue<T, N, M>* values){this->values = values;};
-    T GetMaxValue();
-
+    ExternalNode* leaf;
+    int index;
 };
 
 //**** B+ Tree ****//
-template <typename T, int N, int M> 
+template <typename T, int N, int M, class Alloc = std::allocator<T>, class V = void, class Compare = std::less<T>>
 class BPlusTree {
-private: // B+ Tree attributes
-    BPlusTreeNode<T, N, M>* root; // Pointer to the root node
+    static_assert(N >= 3, "an internal node needs room for at least 3 children");
+    static_assert(M >= 2, "an external node needs room for at least 2 keys");
 
-    bool _Insert(T data);
-    bool _Delete(T data);
-    bool _Search(T data);
-    void _Print(BPlusTreeNode<T, N, M>* node); // Helper method to print the tree from a given node
-    void _InOrderTraversal(BPlusTreeNode<T, N, M>* node, int depth);
-    void _Clear(BPlusTreeNode<T, N, M>* node); // Helper method to clear the tree from a given node
-    BPlusTreeExternalNode<T, N, M>* _FindAssociatedLeafNode(BPlusTreeNode<T, N, M>* node, T data);
+public:
+    using Node = BPlusTreeNode<T, N, M, V>;
+    using InternalNode = BPlusTreeInternalNode<T, N, M, V>;
+    using ExternalNode = BPlusTreeExternalNode<T, N, M, V>;
+    using Iterator = BPlusTreeIterator<T, N, M, V>;
 
+private: // B+ Tree attributes
+    static constexpr bool HasPayload = !std::is_void<V>::value;
+    static constexpr int MaxDepth = 64;                  // Enough for any tree that fits in memory, N >= 3
+    static constexpr int MinInternalKeys = (N - 1) / 2;  // Internal nodes other than the root keep at least this many keys
+    static constexpr int MinExternalKeys = M / 2;        // Same for external nodes
+
+    Node* root; // Pointer to the root node
+    std::size_t size;
+    NodeAllocatorFor<Alloc, InternalNode> internalAlloc;
+    NodeAllocatorFor<Alloc, ExternalNode> externalAlloc;
+    Compare comp;
+
+    template <class... Args>
+    bool _Insert(const T& data, Args&&... value);
+    bool _Delete(const T& data);
+    template <class K>
+    ExternalNode* _FindLeaf(const K& data) const;
+    ExternalNode* _EdgeLeaf(bool rightmost) const; // First or last leaf of the chain, nullptr for an empty tree
+    template <class K>
+    int _FindInLeaf(const ExternalNode* leaf, const K& data) const; // Index of data in leaf, -1 if missing
+    // Lookups behind the public T and heterogeneous overloads
+    template <class K>
+    bool _Search(const K& data) const;
+    template <class K>
+    V* _Find(const K& data);
+    template <class K>
+    Iterator _LowerBound(const K& data) const;
+    template <class K>
+    Iterator _UpperBound(const K& data) const;
+    template <class K>
+    std::pair<Iterator, Iterator> _Range(const K& low, const K& high) const;
+    T _SplitInternal(InternalNode* node, int index, const T& key, Node* child, InternalNode* sibling);
+    void _RebalanceExternal(ExternalNode* node, InternalNode* parent, int index);
+    void _RebalanceInternal(InternalNode* node, InternalNode* parent, int index);
+    void _MergeInternal(InternalNode* left, InternalNode* right, InternalNode* parent, int separatorIndex);
+    void _RemoveFromInternal(InternalNode* node, int keyIndex); // Removes keys[keyIndex] and children[keyIndex + 1]
+    void _Print(Node* node, int depth); // Helper method to print the tree from a given node
+    void _Clear(Node* node); // Helper method to clear the tree from a given node
+    static std::size_t _BulkGroupCount(std::size_t items, int target, int minimum);
+
+    template <class E>
+    static void _MoveRange(E* first, int count, E* dest); // std::move / std::move_backward, ranges may overlap
+    static void _MoveEntries(ExternalNode* from, int fromIndex, int count, ExternalNode* to, int toIndex);
 
 public: // B+ Tree constructor & destructor
-    BPlusTree() : root(nullptr) {};
+    BPlusTree() : BPlusTree(Alloc()) {};
+    explicit BPlusTree(const Alloc& alloc, const Compare& comp = Compare()) : root(nullptr), size(0), internalAlloc(alloc), externalAlloc(alloc), comp(comp) {};
     ~BPlusTree() {_Clear(root);root = nullptr;};
 
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
     // Public B+ Tree operations
-    bool Insert(T data); //the user will want to insert a data of type T and not a NodePtr, that is an ofspring of our structure and something we internaly create
-    bool Delete(T data);
-    bool Search(T data){return _Search(data);};
-    void Print(BPlusTreeNode<T, N, M>* node){_Print(node);};
-    void Print(){_Print(root);};
-    void Clear(){_Clear(root); root = nullptr;};
-    void UpdateKeys(BPlusTreeNode<T, N, M>* node);
-    T CalculateNewKey(BPlusTreeNode<T, N, M>* node);
+    bool Insert(const T& data){return _Insert(data);}; // Returns false when data is already in the tree, the payload is value initialized
+    template <class U = V> // Not deduced, value converts to V and a key-only tree has no such overload
+    bool Insert(const T& data, const typename std::enable_if<!std::is_void<U>::value, U>::type& value){return _Insert(data, value);};
+    bool Delete(const T& data){return _Delete(data);};
+    bool Search(const T& data) const {return _Search(data);};
+    template <class U = V>
+    typename std::enable_if<!std::is_void<U>::value, U*>::type Find(const T& data){return _Find(data);}; // Payload of data, nullptr if missing
+    void Print(Node* node){_Print(node, 0);};
+    void Print(){_Print(root, 0);};
+    void Clear(){_Clear(root); root = nullptr; size = 0;};
+    template <class ForwardIt>
+    void BulkLoad(ForwardIt first, ForwardIt last, double fillFactor = 1.0); // Replaces the content with the sorted range
+
+    // Ordered access
+    Iterator Begin() const {return Iterator(_EdgeLeaf(false), 0);};
+    Iterator End() const;
+    Iterator LowerBound(const T& data) const {return _LowerBound(data);}; // First key not less than data
+    Iterator UpperBound(const T& data) const {return _UpperBound(data);}; // First key greater than data
+    std::pair<Iterator, Iterator> Range(const T& low, const T& high) const {return _Range(low, high);}; // Every key in [low, high]
+    Iterator begin() const {return Begin();};
+    Iterator end() const {return End();};
+
+    // Heterogeneous lookups, only with a transparent Compare (see Compare.h): data is compared to the
+    // keys as is, e.g. a std::string_view against std::string keys
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    bool Search(const K& data) const {return _Search(data);};
+    template <class K, class U = V, class C = Compare, EnableIfTransparent<C> = 0>
+    typename std::enable_if<!std::is_void<U>::value, U*>::type Find(const K& data){return _Find(data);};
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    Iterator LowerBound(const K& data) const {return _LowerBound(data);};
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    Iterator UpperBound(const K& data) const {return _UpperBound(data);};
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    std::pair<Iterator, Iterator> Range(const K& low, const K& high) const {return _Range(low, high);};
 
     // Getters and setters
-    bool IsRoot(BPlusTreeNode<T, N, M>* node){return node == root;};
-    BPlusTreeNode<T, N, M>* GetRoot(){return root;};
-
+    std::size_t Size() const {return size;};
+    bool IsEmpty() const {return size == 0;};
+    bool IsRoot(Node* node) const {return node == root;};
+    const Compare& KeyComp() const {return comp;};
+    Node* GetRoot(){return root;};
 };
 
-    //** B+ Base Tree node (Common Base for external and internal nodes:) ) **//
-template <typename T, int N, int M>
-bool BPlusTreeNode<T, N, M>::Delete(BPlusTreeData<T, N, M>* data) {
-    // Attempt to cast the data to BPlusTreeDataValue (external node data)
-    BPlusTreeDataValue<T, N, M>* dataValue = dynamic_cast<BPlusTreeDataValue<T, N, M>*>(data);
-
-    if (dataValue) {
-        // Handle deletion logic for external (leaf) nodes
-        return DeleteExternal(dataValue);
-    }
-
-    // Attempt to cast the data to BPlusTreeDataNodePointer (internal node data)
-    BPlusTreeDataNodePointer<T, N, M>* dataNodePointer = dynamic_cast<BPlusTreeDataNodePointer<T, N, M>*>(data);
-
-    if (dataNodePointer) {
-        // Handle deletion logic for internal nodes
-        return DeleteInternal(dataNodePointer);
-    }
-
-    // Handle unsupported data types or errors
-    return false;
+// Map flavour, a B+ tree with a payload next to every key
+template <typename K, typename V, int N, int M, class Alloc = std::allocator<K>, class Compare = std::less<K>>
+using BPlusTreeMap = BPlusTree<K, N, M, Alloc, V, Compare>;
+
+// Largest internal fan-out / leaf capacity whose node stays within NodeBytes (at least 3 / 2)
+template <typename T, class V, std::size_t NodeBytes,
+          int N = NodeFanOutEstimate(NodeBytes, static_cast<long long>(2 * sizeof(int)) - static_cast<long long>(sizeof(T)),
+                                     sizeof(T) + sizeof(void*), 3)>
+struct BPlusTreeInternalFanOut : std::conditional<(N <= 3 || sizeof(BPlusTreeInternalNode<T, N, 2, V>) <= NodeBytes),
+                                                  std::integral_constant<int, N>, BPlusTreeInternalFanOut<T, V, NodeBytes, N - 1>>::type {};
+
+template <typename T, class V, std::size_t NodeBytes,
+          int M = NodeFanOutEstimate(NodeBytes, static_cast<long long>(2 * sizeof(int) + 2 * sizeof(void*)),
+                                     sizeof(T) + BPlusTreePayloadBytes<V>, 2)>
+struct BPlusTreeLeafCapacity : std::conditional<(M <= 2 || sizeof(BPlusTreeExternalNode<T, 3, M, V>) <= NodeBytes),
+                                                std::integral_constant<int, M>, BPlusTreeLeafCapacity<T, V, NodeBytes, M - 1>>::type {};
+
+// B+ tree whose fan-out and leaf capacity are derived from a target node size, see NodeLayout.h
+template <typename T, std::size_t NodeBytes = NodeBytesSmall, class Alloc = std::allocator<T>, class V = void, class Compare = std::less<T>>
+using BPlusTreeAuto = BPlusTree<T, BPlusTreeInternalFanOut<T, V, NodeBytes>::value, BPlusTreeLeafCapacity<T, V, NodeBytes>::value, Alloc, V, Compare>;
+
+//** B+ Tree public operations **//
+
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class K>
+bool BPlusTree<T, N, M, Alloc, V, Compare>::_Search(const K& data) const {
+    ExternalNode* leaf = _FindLeaf(data);
+    return leaf != nullptr && _FindInLeaf(leaf, data) >= 0;
 }
 
-
-template <typename T, int N, int M>
-bool BPlusTreeNode<T, N, M>::Insert(BPlusTreeData<T, N, M>* data) {
-    // Attempt to cast the data to BPlusTreeDataValue (external node data)
-    BPlusTreeDataValue<T, N, M>* dataValue = dynamic_cast<BPlusTreeDataValue<T, N, M>*>(data);
-
-    if (dataValue) {
-
-        return InsertExternal(dataValue);
-    }
-
-    // Attempt to cast the data to BPlusTreeDataNodePointer (internal node data)
-    BPlusTreeDataNodePointer<T, N, M>* dataNodePointer = dynamic_cast<BPlusTreeDataNodePointer<T, N, M>*>(data);
-
-    if (dataNodePointer) {
-        // Handle insertion logic for internal nodes
-        return InsertInternal(dataNodePointer);
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class K>
+V* BPlusTree<T, N, M, Alloc, V, Compare>::_Find(const K& data) {
+    if constexpr (HasPayload) {
+        ExternalNode* leaf = _FindLeaf(data);
+        if (leaf == nullptr)
+            return nullptr;
+        int index = _FindInLeaf(leaf, data);
+        return index >= 0 ? &leaf->payload.values[index] : nullptr;
+    } else {
+        return nullptr;
     }
-
-    // Handle unsupported data types or errors
-    return false;
 }
 
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+typename BPlusTree<T, N, M, Alloc, V, Compare>::Iterator BPlusTree<T, N, M, Alloc, V, Compare>::End() const {
+    ExternalNode* last = _EdgeLeaf(true);
+    return Iterator(last, last != nullptr ? last->count : 0);
+}
 
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class K>
+typename BPlusTree<T, N, M, Alloc, V, Compare>::Iterator BPlusTree<T, N, M, Alloc, V, Compare>::_LowerBound(const K& data) const {
+    ExternalNode* leaf = _FindLeaf(data);
+    if (leaf == nullptr)
+        return Iterator();
+    // Keys in the following leaves are never below data, so an index past this leaf moves on to the next one
+    return Iterator(leaf, NodeLowerBound(leaf->keys, leaf->count, data, comp));
+}
 
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class K>
+typename BPlusTree<T, N, M, Alloc, V, Compare>::Iterator BPlusTree<T, N, M, Alloc, V, Compare>::_UpperBound(const K& data) const {
+    ExternalNode* leaf = _FindLeaf(data);
+    if (leaf == nullptr)
+        return Iterator();
+    return Iterator(leaf, NodeUpperBound(leaf->keys, leaf->count, data, comp));
+}
 
-    template <typename T, int N, int M>
-    BPlusTreeData<T, N, M>* BPlusTreeNode<T, N, M>::Search(BPlusTreeData<T, N, M>* data) {
-        // Attempt to cast the data to BPlusTreeDataValue (external node data)
-        BPlusTreeDataValue<T, N, M>* dataValue = dynamic_cast<BPlusTreeDataValue<T, N, M>*>(data);
-        
-        if (dataValue) {
-            // Handle search logic for external (leaf) nodes
-            return SearchExternal(dataValue);
-        }
-        
-        // Attempt to cast the data to BPlusTreeDataNodePointer (internal node data)
-        BPlusTreeDataNodePointer<T, N, M>* dataNodePointer = dynamic_cast<BPlusTreeDataNodePointer<T, N, M>*>(data);
-        
-        if (dataNodePointer) {
-            // Handle search logic for internal nodes
-            return SearchInternal(dataNodePointer);
-        }
-        
-        // Handle unsupported data types or errors
-        return nullptr;
-    }
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class K>
+std::pair<typename BPlusTree<T, N, M, Alloc, V, Compare>::Iterator, typename BPlusTree<T, N, M, Alloc, V, Compare>::Iterator>
+BPlusTree<T, N, M, Alloc, V, Compare>::_Range(const K& low, const K& high) const {
+    if (comp(high, low))
+        return std::make_pair(End(), End());
+    return std::make_pair(_LowerBound(low), _UpperBound(high));
+}
 
-    template <typename T, int N, int M>
-    BPlusTreeNode<T, N, M>* BPlusTreeNode<T, N, M>::Split() 
-    {
-        //route to right split
-        if(GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::Internal)
-            return SplitInternal();
+// Builds the tree bottom-up: the sorted keys are cut into leaves of about fillFactor * M keys, then every
+// level above groups about fillFactor * N children per node until a single root is left.
+// Nodes never drop below the minimum fill that Delete maintains.
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class ForwardIt>
+void BPlusTree<T, N, M, Alloc, V, Compare>::BulkLoad(ForwardIt first, ForwardIt last, double fillFactor) {
+    auto keyOf = [](const auto& item) -> const T& {
+        if constexpr (HasPayload)
+            return item.first;
         else
-            return SplitExternal();
-    }
-
-
- template <typename T, int N, int M>
-    BPlusTreeExternalNode<T, N, M>* BPlusTreeNode<T, N, M>::FindLeafNode(T data)
-    {
-        // Check if the current node is a leaf node
-        if (GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::External)
-        {
-            return dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(this);
-        }
-
-        // Cast to internal node
-        BPlusTreeInternalNode<T, N, M>* internalNode = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(this);
-
-        // Find the correct child node to search
-        int searchIndex = 0;
-
-        while (searchIndex < internalNode->ChildCount() && data >= internalNode->GetKey(searchIndex))
-        {
-            searchIndex++;
-        }
-
-        // Check if the child pointer was found
-        if (searchIndex < internalNode->ChildCount())
-        {
-            // Check if the child is an external node
-            BPlusTreeExternalNode<T, N, M>* leafNode = internalNode->GetChild(searchIndex)->FindLeafNode(data);
-            
-            if (leafNode)
-            {
-                return leafNode; // Found the leaf node
-            }
-            else
-            {
-                // Continue searching in the next internal node
-                return internalNode->GetChild(searchIndex)->FindLeafNode(data);
+            return item;
+    };
+
+    // Count and validate before the current content is dropped
+    std::size_t count = 0;
+    for (ForwardIt previous = first, it = first; it != last; previous = it++, ++count) {
+        if (count > 0 && !comp(keyOf(*previous), keyOf(*it)))
+            throw std::invalid_argument("BulkLoad expects strictly increasing keys");
+    }
+
+    Clear();
+    if (count == 0)
+        return;
+
+    std::vector<Node*> level;
+    std::vector<T> separators; // separators[i] sits between level[i] and level[i + 1]
+    std::vector<Node*> nextLevel;
+    std::vector<T> nextSeparators;
+    std::size_t consumed = 0; // Nodes of level already attached to a parent
+    try {
+        // Leaves
+        int leafTarget = std::min(M, std::max(std::max(MinExternalKeys, 1), static_cast<int>(fillFactor * M)));
+        std::size_t leafCount = _BulkGroupCount(count, leafTarget, MinExternalKeys);
+        level.reserve(leafCount);
+        separators.reserve(leafCount);
+        ExternalNode* previousLeaf = nullptr;
+        ForwardIt it = first;
+        for (std::size_t i = 0; i < leafCount; ++i) {
+            ExternalNode* leaf = constructNode(externalAlloc);
+            level.push_back(leaf);
+            int keys = static_cast<int>(count / leafCount + (i < count % leafCount ? 1 : 0));
+            for (; leaf->count < keys; ++it) {
+                leaf->keys[leaf->count] = keyOf(*it);
+                if constexpr (HasPayload)
+                    leaf->payload.values[leaf->count] = it->second;
+                ++leaf->count;
+            }
+            leaf->prev = previousLeaf;
+            if (previousLeaf != nullptr) {
+                previousLeaf->next = leaf;
+                separators.push_back(leaf->keys[0]);
+            }
+            previousLeaf = leaf;
+        }
+
+        // Internal levels
+        int childTarget = std::min(N, std::max(MinInternalKeys + 1, static_cast<int>(fillFactor * N)));
+        while (level.size() > 1) {
+            std::size_t children = level.size();
+            std::size_t parents = _BulkGroupCount(children, childTarget, MinInternalKeys + 1);
+            nextLevel.clear();
+            nextSeparators.clear();
+            nextLevel.reserve(parents);
+            consumed = 0;
+            for (std::size_t p = 0; p < parents; ++p) {
+                InternalNode* node = constructNode(internalAlloc);
+                nextLevel.push_back(node);
+                if (p > 0)
+                    nextSeparators.push_back(std::move(separators[consumed - 1]));
+                int group = static_cast<int>(children / parents + (p < children % parents ? 1 : 0));
+                node->children[0] = level[consumed];
+                for (int j = 1; j < group; ++j) {
+                    node->keys[j - 1] = std::move(separators[consumed + j - 1]);
+                    node->children[j] = level[consumed + j];
+                }
+                node->count = group - 1;
+                consumed += group;
             }
+            level.swap(nextLevel);
+            separators.swap(nextSeparators);
+            nextLevel.clear();
+            consumed = 0;
         }
-
-        return nullptr; // Child pointer not found
+    } catch (...) {
+        // Built nodes are either attached to a node of nextLevel or still loose in level
+        for (Node* node : nextLevel)
+            _Clear(node);
+        for (std::size_t i = consumed; i < level.size(); ++i)
+            _Clear(level[i]);
+        throw;
     }
 
-    template <typename T, int N, int M>
-    bool BPlusTreeNode<T, N, M>::IsRoot()
-    {
-        if(GetParent() == nullptr)
-            return true;
-        else
-            return false;
-    }
+    root = level[0];
+    size = count;
+}
 
+//** B+ Tree private helpers **//
 
-//** Derived internal node class **//
+// Number of nodes to spread items over so each gets about target of them but never less than minimum
+// (a single node, the root, is exempt)
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+std::size_t BPlusTree<T, N, M, Alloc, V, Compare>::_BulkGroupCount(std::size_t items, int target, int minimum) {
+    std::size_t groups = (items + target - 1) / target;
+    if (groups > 1 && items / groups < static_cast<std::size_t>(minimum))
+        groups = std::max<std::size_t>(1, items / minimum);
+    return groups;
+}
 
-    template <typename T, int N, int M>
-    BPlusTreeInternalNode<T, N, M>::BPlusTreeInternalNode()
-    {
-        parent = nullptr;
-        for (int i = 0; i < N; i++)
-        {
-            children[i] = nullptr;
-        }
-        for (int i = 0; i < N - 1; i++)
-        {
-            keys[i] = 0;
-        }
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+typename BPlusTree<T, N, M, Alloc, V, Compare>::ExternalNode* BPlusTree<T, N, M, Alloc, V, Compare>::_EdgeLeaf(bool rightmost) const {
+    Node* currentNode = root;
+    if (currentNode == nullptr)
+        return nullptr;
+    while (!currentNode->isLeaf) {
+        InternalNode* internalNode = static_cast<InternalNode*>(currentNode);
+        currentNode = internalNode->children[rightmost ? internalNode->count : 0];
     }
+    return static_cast<ExternalNode*>(currentNode);
+}
 
-    template <typename T, int N, int M>
-    BPlusTreeInternalNode<T, N, M>::~BPlusTreeInternalNode()
-    {
-        parent = nullptr;
-        for (int i = 0; i < N; i++)
-        {
-            delete children[i];
-            children[i] = nullptr;
-        }
-        for (int i = 0; i < N - 1; i++)
-        {
-            keys[i] = 0;
-        }
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class K>
+typename BPlusTree<T, N, M, Alloc, V, Compare>::ExternalNode* BPlusTree<T, N, M, Alloc, V, Compare>::_FindLeaf(const K& data) const {
+    Node* currentNode = root;
+    if (currentNode == nullptr)
+        return nullptr;
+    // Follow the routing keys down to the leaf that would hold data
+    while (!currentNode->isLeaf) {
+        InternalNode* internalNode = static_cast<InternalNode*>(currentNode);
+        currentNode = internalNode->children[NodeUpperBound(internalNode->keys, internalNode->count, data, comp)];
     }
+    return static_cast<ExternalNode*>(currentNode);
+}
 
-    //Basic Operations
-    template <typename T, int N, int M>
-    bool BPlusTreeInternalNode<T, N, M>::InsertInternal(BPlusTreeDataNodePointer<T, N, M>* data) {
-        // Check if the node is full (should not happen if called correctly)
-        if (isFull())
-            throw std::runtime_error("Internal node is full, Insertion to InternalNode used incorrectly please move/split beforehand");
-
-        // Find the correct position to insert based on keys
-        int insertIndex = 0;
-        while (insertIndex < N && children[insertIndex] != nullptr && GetKey(insertIndex) < data->GetDataValue()) {
-            insertIndex++;
-        }
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class K>
+int BPlusTree<T, N, M, Alloc, V, Compare>::_FindInLeaf(const ExternalNode* leaf, const K& data) const {
+    int index = NodeLowerBound(leaf->keys, leaf->count, data, comp);
+    return index < leaf->count && !comp(data, leaf->keys[index]) ? index : -1;
+}
 
-        // Shift elements to make space for the new one
-        for (int i = N - 1; i > insertIndex; i--) {
-            children[i] = children[i - 1];
-            SetKey(i, GetKey(i - 1)); // Shift keys along with children
-        }
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class E>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_MoveRange(E* first, int count, E* dest) {
+    if (std::less<E*>()(first, dest))
+        std::move_backward(first, first + count, dest + count);
+    else
+        std::move(first, first + count, dest);
+}
 
-        // Insert the new element and its corresponding key
-        children[insertIndex] = data->GetNodePointer();
-        SetKey(insertIndex, data->GetDataValue());
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_MoveEntries(ExternalNode* from, int fromIndex, int count, ExternalNode* to, int toIndex) {
+    _MoveRange(from->keys + fromIndex, count, to->keys + toIndex);
+    if constexpr (HasPayload)
+        _MoveRange(from->payload.values + fromIndex, count, to->payload.values + toIndex);
+}
 
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+template <class... Args>
+bool BPlusTree<T, N, M, Alloc, V, Compare>::_Insert(const T& data, Args&&... value) {
+    // Check if the tree is empty
+    if (root == nullptr)
+        root = constructNode(externalAlloc);
+
+    // Walk down to the leaf, remembering the path for the splits
+    InternalNode* path[MaxDepth];
+    int pathIndex[MaxDepth];
+    int depth = 0;
+    Node* currentNode = root;
+    while (!currentNode->isLeaf) {
+        InternalNode* internalNode = static_cast<InternalNode*>(currentNode);
+        int childIndex = NodeUpperBound(internalNode->keys, internalNode->count, data, comp);
+        path[depth] = internalNode;
+        pathIndex[depth] = childIndex;
+        ++depth;
+        currentNode = internalNode->children[childIndex];
+    }
+
+    ExternalNode* leaf = static_cast<ExternalNode*>(currentNode);
+    int position = NodeLowerBound(leaf->keys, leaf->count, data, comp);
+    if (position < leaf->count && !comp(data, leaf->keys[position]))
+        return false; // Already in the tree
+
+    // A full leaf is split first, the upper half moves to a new right sibling
+    ExternalNode* target = leaf;
+    ExternalNode* sibling = nullptr;
+    if (leaf->count == M) {
+        sibling = constructNode(externalAlloc);
+        int leftCount = (M + 2) / 2; // Keys left of the split once data is in
+        if (position < leftCount) {
+            _MoveEntries(leaf, leftCount - 1, M - leftCount + 1, sibling, 0);
+            leaf->count = leftCount - 1;
+            sibling->count = M - leftCount + 1;
+        } else {
+            _MoveEntries(leaf, leftCount, M - leftCount, sibling, 0);
+            leaf->count = leftCount;
+            sibling->count = M - leftCount;
+            target = sibling;
+            position -= leftCount;
+        }
+        sibling->next = leaf->next;
+        sibling->prev = leaf;
+        if (leaf->next != nullptr)
+            leaf->next->prev = sibling;
+        leaf->next = sibling;
+    }
+
+    _MoveEntries(target, position, target->count - position, target, position + 1);
+    target->keys[position] = data;
+    if constexpr (HasPayload)
+        target->payload.values[position] = V(std::forward<Args>(value)...);
+    ++target->count;
+    ++size;
+
+    if (sibling == nullptr)
         return true;
-    }
-
-
-    
-    template <typename T, int N, int M>
-    bool BPlusTreeInternalNode<T, N, M>::DeleteInternal(BPlusTreeDataNodePointer<T, N, M>* data)
-    {
-    //check for underflow and call exception if needed
-    if (children[MINIMUM_CHILDREN_TO_MERGE+1] == nullptr)
-        throw std::runtime_error("Internal node is underflow, not meeting minimum children, Deletion from InternalNode used incorrectly please move/merge beforehand");
-
-    // Find the correct position to delete
-    int deleteIndex = 0;
-
-    // Go through each child and check if it is the one we want to delete
-    for (auto child : children)
-    {
-        if (child == data->GetNodePointer())
-        {
-            break;
-        }
-        deleteIndex++;
-    }
-
-    // Check if the child pointer was found
-    if (deleteIndex < N && children[deleteIndex] == data->GetNodePointer())
-    {
-        // Delete the element and set to null
-        delete children[deleteIndex];
-        children[deleteIndex] = nullptr;
-
-        // Shift the remaining child pointers to fill the gap
-        for (int i = deleteIndex; i < N - 1; i++)
-        {
-            children[i] = children[i + 1];
-        }
-        children[N - 1] = nullptr;
-
-        return true; // Deletion successful
-    }
-
-    return false; // Child pointer not found
-    }
-
-
-    template <typename T, int N, int M>
-    BPlusTreeDataNodePointer<T, N, M>* BPlusTreeInternalNode<T, N, M>::SearchInternal(BPlusTreeDataNodePointer<T, N, M>* data)
-    {
-    // Find the correct child node if it exists
-    // Go through each child and check if it is the one we want to delete
-    for (auto child : children) {
-        if (child == data->GetNodePointer()) {
-            return new BPlusTreeDataNodePointer<T, N, M>(child); // Create and return a new BPlusTreeDataNodePointer
-        }
-    }
-    return nullptr; // Child pointer not found
-    }
-
-
-
-    template <typename T, int N, int M>
-    BPlusTreeInternalNode<T, N, M>* BPlusTreeInternalNode<T, N, M>::SplitInternal()
-    {
-        // Create a new sibling internal node
-        BPlusTreeInternalNode<T, N, M>* newSibling = new BPlusTreeInternalNode<T, N, M>();
-
-        // Calculate the midpoint to split the keys and children
-        int midpoint = N / 2;
-
-        // Move the keys and corresponding children from the current node to the new sibling
-        for (int i = midpoint; i < N; i++)
-        {
-            newSibling->children[i - midpoint] = children[i];
-            children[i] = nullptr; // Clear the reference in the current node
-        }
-
-        // Update the parent reference for the new sibling
-        newSibling->parent = parent;
-
-        // Update the keys in the current node
-        // Update the children in the current node
-        for (int i = midpoint; i < N; i++)
-        {
-            // Move the child reference to the new sibling
-            newSibling->children[i - midpoint] = children[i];
-            children[i] = nullptr; // Clear the reference in the current node
-        }
-
-
-        // Update the parent's reference to the new sibling
-        if (parent)
-            parent->InsertInternal(new BPlusTreeDataNodePointer<T, N, M>(newSibling));
-
-        return newSibling; // Return the new sibling node
-    }
-
-
-    template <typename T, int N, int M>
-    bool BPlusTreeInternalNode<T, N, M>::Merge()
-    {
-        // Check if this node is underfull (has fewer keys than required)
-        if (GetKeyCount() >= MINIMUM_CHILDREN_TO_MERGE)
-        {
-            return false; // Cannot merge
-        }
-
-        BPlusTreeInternalNode<T, N, M>* leftSibling = nullptr;
-        BPlusTreeInternalNode<T, N, M>* rightSibling = nullptr;
-
-        // Find left and right siblings if they exist
-        BPlusTreeInternalNode<T, N, M>* parent = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(GetParent());
-
-        if (parent)
-        {
-            int indexInParent = parent->FindChildIndex(this);
-
-            if (indexInParent > 0)
-            {
-                leftSibling = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(parent->GetChild(indexInParent - 1));
-            }
-
-            if (indexInParent < parent->ChildCount() - 1)
-            {
-                rightSibling = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(parent->GetChild(indexInParent + 1));
-            }
-        }
-
-        // Merge with the left sibling if possible
-        if (leftSibling && leftSibling->GetKeyCount() > MINIMUM_CHILDREN_TO_MERGE)
-        {
-            // Redistribute keys from leftSibling
-            int totalKeys = GetKeyCount() + leftSibling->GetKeyCount();
-            int keysToMove = (totalKeys / 2) - GetKeyCount(); // Move half of the keys
-
-            // Move keys from leftSibling to this node
-            for (int i = 0; i < keysToMove; i++)
-            {
-                int leftSiblingIndex = leftSibling->GetKeyCount() - 1;
-                T redistributedKey = leftSibling->GetKey(leftSiblingIndex);
-                BPlusTreeNode<T, N, M>* redistributedChild = leftSibling->GetChild(leftSiblingIndex + 1);
-
-                // Insert the redistributed key and child
-                InsertKeyAndChild(redistributedKey, redistributedChild);
-
-                // Remove the key and child from leftSibling
-                leftSibling->RemoveKeyAndChild(leftSiblingIndex);
-            }
-
-            // Update parent's key
-            if (parent)
-            {
-                parent->SetKey(parent->FindChildIndex(this), GetKey(0));
-            }
 
+    // Hand the separator up, splitting full internal nodes on the way
+    T separator = sibling->keys[0];
+    Node* newChild = sibling;
+    while (depth > 0) {
+        --depth;
+        InternalNode* parent = path[depth];
+        int childIndex = pathIndex[depth];
+        if (parent->count < N - 1) {
+            _MoveRange(parent->keys + childIndex, parent->count - childIndex, parent->keys + childIndex + 1);
+            _MoveRange(parent->children + childIndex + 1, parent->count - childIndex, parent->children + childIndex + 2);
+            parent->keys[childIndex] = separator;
+            parent->children[childIndex + 1] = newChild;
+            ++parent->count;
             return true;
         }
-
-        // Merge with the right sibling if possible
-        if (rightSibling && rightSibling->GetKeyCount() > MINIMUM_CHILDREN_TO_MERGE)
-        {
-            // Redistribute keys from rightSibling
-            int totalKeys = GetKeyCount() + rightSibling->GetKeyCount();
-            int keysToMove = (totalKeys / 2) - GetKeyCount(); // Move half of the keys
-
-            // Move keys from rightSibling to this node
-            for (int i = 0; i < keysToMove; i++)
-            {
-                T redistributedKey = rightSibling->GetKey(0);
-                BPlusTreeNode<T, N, M>* redistributedChild = rightSibling->GetChild(0);
-
-                // Insert the redistributed key and child
-                InsertKeyAndChild(redistributedKey, redistributedChild);
-
-                // Remove the key and child from rightSibling
-                rightSibling->RemoveKeyAndChild(0);
-            }
-
-            // Update parent's key
-            if (parent)
-            {
-                parent->SetKey(parent->FindChildIndex(this), rightSibling->GetKey(0));
-            }
-
-            return true;
-        }
-
-        // If merging with siblings is not possible, consider merging with the parent
-        if (parent)
-        {
-            // Check if merging with the parent is possible and beneficial
-            if (parent->ChildCount() > MINIMUM_CHILDREN_TO_MERGE)
-            {
-                // Merge this node with the parent node
-                int indexInParent = parent->FindChildIndex(this);
-
-                // Merge this node with the parent
-                MergeWithParent(parent, indexInParent);
-
-                return true;
-            }
-        }
-
-        return false; // Cannot merge
+        InternalNode* newSibling = constructNode(internalAlloc);
+        separator = _SplitInternal(parent, childIndex, separator, newChild, newSibling);
+        newChild = newSibling;
     }
 
-    template <typename T, int N, int M>
-    void BPlusTreeInternalNode<T, N, M>::MergeWithParent(BPlusTreeInternalNode<T, N, M>* parent, int indexInParent) {
-        if (parent && indexInParent >= 0 && indexInParent < parent->GetKeyCount()) {
-            // Get the key from the parent at the specified index
-            T parentKey = parent->GetKey(indexInParent);
-
-            // Remove the key at the specified index in the parent
-            parent->RemoveKeyAndChild(indexInParent);
-
-            // Insert the key from the parent into the current node
-            InsertKeyAndChild(parentKey, nullptr);
-
-            // Transfer children from the parent to the current node
-            // Start transferring from the parent's child at indexInParent + 1
-            BPlusTreeInternalNode<T, N, M>* parentChild = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(parent->GetChild(indexInParent + 1));
-            for (int i = 0; i < parentChild->GetKeyCount(); i++) {
-                InsertKeyAndChild(parentChild->GetKey(i), parentChild->GetChild(i));
-            }
-
-            // Remove the parentChild from the parent's children
-            parent->RemoveChild(parentChild);
-
-            // Free memory for the parentChild (optional)
-            delete parentChild;
-        }
-    }
-
-
-
-    template <typename T, int N, int M>
-    void BPlusTreeInternalNode<T, N, M>::Print() // Print logic not same as external node
-    {
-        std::cout << "[";
-        for (int i = 0; i < N; i++)
-        {
-            if (children[i] != nullptr)
-            {
-                children[i]->Print();
-            }
-            if (i < N - 1)
-            {
-                std::cout << ", ";
-            }
-        }
-        std::cout << "]";
-    }
-
-    template <typename T, int N, int M>
-    bool BPlusTreeInternalNode<T, N, M>::isFull()
-    {
-        for (int i = 0; i < N; i++)
-        {
-            if (children[i] == nullptr)
-                return false;
-        }
-        return true;
-    }
-
-    template <typename T, int N, int M>
-    int BPlusTreeInternalNode<T, N, M>::FindChildIndex(BPlusTreeNode<T, N, M>* child)
-    {
-        for (int i = 0; i < N; i++)
-        {
-            if (children[i] == child)
-                return i;
-        }
-        return -1;
-    }
-
-    template <typename T, int N, int M>
-    int BPlusTreeInternalNode<T, N, M>::ChildCount()
-    {
-        int count = 0;
-        for (int i = 0; i < N; i++)
-        {
-            if (children[i] != nullptr)
-                count++;
-        }
-        return count;
-    }
-
-    template <typename T, int N, int M>
-    int BPlusTreeInternalNode<T, N, M>::GetNumValues()
-    {
-        int count = 0;
-        for (int i = 0; i < N; i++)
-        {
-            if (children[i] != nullptr)
-                count++;
-        }
-        return count;
-    }
-
-    template <typename T, int N, int M>
-    int BPlusTreeInternalNode<T, N, M>::GetKeyCount()
-    {
-        int count = 0;
-        for (int i = 0; i < N - 1; i++)
-        {
-            if (keys[i] != 0)
-                count++;
-        }
-        return count;
-    }
-
-    template <typename T, int N, int M>
-    void BPlusTreeInternalNode<T, N, M>::RemoveChild(BPlusTreeNode<T, N, M>* child)
-    {
-        for (int i = 0; i < N; i++)
-        {
-            if (children[i] == child)
-            {
-                children[i] = nullptr;
-                break;
-            }
-        }
-    }
-
-    template <typename T, int N, int M>
-    bool BPlusTreeInternalNode<T, N, M>::InsertKeyAndChild(T key, BPlusTreeNode<T, N, M>* child)
-    {
-        // Check if the node is full (should not happen if called correctly)
-        if (isFull())
-            throw std::runtime_error("Internal node is full, Insertion to InternalNode used incorrectly please move/split beforehand");
-
-        // Find the correct position to insert based on keys
-        int insertIndex = 0;
-        while (insertIndex < N && children[insertIndex] != nullptr && GetKey(insertIndex) < key) {
-            insertIndex++;
-        }
-
-        // Shift elements to make space for the new one
-        for (int i = N - 1; i > insertIndex; i--) {
-            children[i] = children[i - 1];
-            SetKey(i, GetKey(i - 1)); // Shift keys along with children
-        }
-
-        // Insert the new element and its corresponding key
-        children[insertIndex] = child;
-        SetKey(insertIndex, key);
-
-        return true;
-    }
-
-   template <typename T, int N, int M>
-    void BPlusTreeInternalNode<T, N, M>::RemoveKeyAndChild(int indexInParent) {
-        if (indexInParent >= 0 && indexInParent < GetKeyCount()) {
-            // Shift keys and children to remove the key at indexInParent
-            for (int i = indexInParent; i < GetKeyCount() - 1; i++) {
-                keys[i] = keys[i + 1];
-                children[i + 1] = children[i + 2];
-            }
-        }
-    }
-
-
-//** Derived external (leaf) node class **//
-
-    
-
-    template <typename T, int N, int M>
-    BPlusTreeExternalNode<T, N, M>::BPlusTreeExternalNode() : parent(nullptr) {
-        for (int i = 0; i < M; i++) {
-            // Initialize each element of the 'values' array here
-            values[i] = BPlusTreeDataValue<T, N, M>(0); // Use the default constructor of BPlusTreeDataValue
-        }
-    }
-
-
+    // The root was split, the tree grows one level
+    InternalNode* newRoot = constructNode(internalAlloc);
+    newRoot->keys[0] = separator;
+    newRoot->children[0] = root;
+    newRoot->children[1] = newChild;
+    newRoot->count = 1;
+    root = newRoot;
+    return true;
+}
 
+// Splits the full node while inserting key/child at index, the upper half goes to sibling.
+// Returns the middle key, which moves up to the parent.
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+T BPlusTree<T, N, M, Alloc, V, Compare>::_SplitInternal(InternalNode* node, int index, const T& key, Node* child, InternalNode* sibling) {
+    T keys[N];
+    Node* children[N + 1];
+    std::move(node->keys, node->keys + index, keys);
+    keys[index] = key;
+    std::move(node->keys + index, node->keys + N - 1, keys + index + 1);
+    std::copy(node->children, node->children + index + 1, children);
+    children[index + 1] = child;
+    std::copy(node->children + index + 1, node->children + N, children + index + 2);
+
+    int middle = N / 2;
+    std::move(keys, keys + middle, node->keys);
+    std::copy(children, children + middle + 1, node->children);
+    node->count = middle;
+    std::move(keys + middle + 1, keys + N, sibling->keys);
+    std::copy(children + middle + 1, children + N + 1, sibling->children);
+    sibling->count = N - 1 - middle;
+    return std::move(keys[middle]);
+}
 
-    template <typename T, int N, int M>
-    BPlusTreeExternalNode<T, N, M>::~BPlusTreeExternalNode() // Default destructor
-    {
-        parent = nullptr;
-        for (int i = 0; i < M; i++)
-        {
-            values[i] = 0;
-        }
-    }
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+bool BPlusTree<T, N, M, Alloc, V, Compare>::_Delete(const T& data) {
+    if (root == nullptr)
+        return false;
 
-    //Basic Operations
-    template <typename T, int N, int M>
-    bool BPlusTreeExternalNode<T, N, M>::InsertExternal(BPlusTreeDataValue<T, N, M>* data)
-    {
-        // Check if the node is full (should not happen if called correctly)
-        if (isFull())
-            throw std::runtime_error("External node is full, Insertion to ExternalNode used incorrectly please move/split beforehand");
-
-        // Find the correct position to insert
-        int insertIndex = 0;
-        while (insertIndex < M && values[insertIndex].GetDataValue() != 0 && values[insertIndex].GetDataValue() < data->GetDataValue())
-        {
-            insertIndex++;
-        }
+    InternalNode* path[MaxDepth];
+    int pathIndex[MaxDepth];
+    int depth = 0;
+    Node* currentNode = root;
+    while (!currentNode->isLeaf) {
+        InternalNode* internalNode = static_cast<InternalNode*>(currentNode);
+        int childIndex = NodeUpperBound(internalNode->keys, internalNode->count, data, comp);
+        path[depth] = internalNode;
+        pathIndex[depth] = childIndex;
+        ++depth;
+        currentNode = internalNode->children[childIndex];
+    }
+
+    ExternalNode* leaf = static_cast<ExternalNode*>(currentNode);
+    int position = _FindInLeaf(leaf, data);
+    if (position < 0)
+        return false;
+    _MoveEntries(leaf, position + 1, leaf->count - position - 1, leaf, position);
+    --leaf->count;
+    --size;
 
-        // Shift elements to make space for the new ones
-        for (int i = M - 1; i >= insertIndex; i--)
-        {
-            values[i + 1] = values[i];
+    // Routing keys may keep the deleted value, they still separate the subtrees correctly
+    if (depth == 0) {
+        if (leaf->count == 0) {
+            destroyNode(externalAlloc, leaf);
+            root = nullptr;
         }
-
-        // Insert the new element
-        values[insertIndex].setDataValue(data->GetDataValue());
-
         return true;
     }
-
-
-
-    template <typename T, int N, int M>
-    bool BPlusTreeExternalNode<T, N, M>::DeleteExternal(BPlusTreeDataValue<T, N, M>* data)
-    {
-        // node should have atleast M/2 elements
-        if(values[MINIMUM_CHILDREN_TO_MERGE+1].GetDataValue() == 0)
-            throw std::runtime_error("External node is underflow, not meeting minimum children, Deletion from ExternalNode used incorrectly please move/merge beforehand");
-        // we are allowed to delete now lets find the element
-        int deleteIndex = 0;
-        for(auto value: values)
-        {
-            if(value.GetDataValue() == data->GetDataValue())
-            {
-                break;
-            }
-            deleteIndex++;
-        }
-        // Check if the value was found
-        if (deleteIndex < M && values[deleteIndex].GetDataValue() == data->GetDataValue())
-        {
-            // Delete the element and set to null
-            values[deleteIndex].setDataValue(0);
-
-            // Shift the remaining values to fill the gap
-            for (int i = deleteIndex; i < M - 1; i++)
-            {
-                values[i] = values[i + 1];
-            }
-            values[M - 1].setDataValue(0);
-
-            return true; // Deletion successful
-        }
-        else
-            return false; // Value not found
-    }
-
-   template <typename T, int N, int M>
-    BPlusTreeDataValue<T, N, M>* BPlusTreeExternalNode<T, N, M>::SearchExternal(BPlusTreeDataValue<T, N, M>* data)
-    {
-        // Find the correct value if it exists
-        for (auto& value : values)
-        {
-            if (value.GetDataValue() == data->GetDataValue())
-            {
-                return &value; // Return a pointer to the found value
-            }
-        }
-        return nullptr; // Return nullptr if not found
-    }
-
-
-    template <typename T, int N, int M>
-    BPlusTreeExternalNode<T, N, M>* BPlusTreeExternalNode<T, N, M>::SplitExternal()
-    {
-        // Create a new sibling external node
-        BPlusTreeExternalNode<T, N, M>* newSibling = new BPlusTreeExternalNode<T, N, M>();
-
-        // Calculate the midpoint to split the data values
-        int midpoint = M / 2;
-
-        // Move the data values from the current node to the new sibling
-        for (int i = midpoint; i < M; i++)
-        {
-            newSibling->values[i - midpoint].setDataValue(values[i].GetDataValue());
-            values[i].setDataValue(0); // Clear the reference in the current node
-        }
-
-        // Update the parent reference for the new sibling
-        newSibling->parent = parent;
-
-        // Update the parent's reference to the new sibling using the InsertKeyAndChild function
-        if (parent)
-        {
-            // parent will never be leaf node therefore we can cast to internal node
-            auto newparent = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(parent);
-            newparent->InsertKeyAndChild(newSibling->values[0].GetDataValue(), newSibling);
-        }
-
-        return newSibling; // Return the new sibling node
-    }
-
-
-
-
-
-   template <typename T, int N, int M>
-    bool BPlusTreeExternalNode<T, N, M>::Merge()
-    {
-        // Ensure this node is not underfull (has enough values to merge)
-        if (GetNumValues() >= MINIMUM_CHILDREN_TO_MERGE)
-        {
-            return false; // Cannot merge
-        }
-
-        // Find the left sibling and right sibling of this node if they exist
-        BPlusTreeExternalNode<T, N, M>* leftSibling = nullptr;
-        BPlusTreeExternalNode<T, N, M>* rightSibling = nullptr;
-
-        BPlusTreeInternalNode<T, N, M>* parent = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(GetParent());
-
-        if (parent)
-        {
-            int indexInParent = parent->FindChildIndex(this);
-
-            if (indexInParent > 0)
-            {
-                leftSibling = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(parent->GetChild(indexInParent - 1));
-            }
-
-            if (indexInParent < parent->ChildCount() - 1)
-            {
-                rightSibling = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(parent->GetChild(indexInParent + 1));
-            }
-        }
-
-        // Merge with the left sibling if possible
-        if (leftSibling && leftSibling->GetNumValues() > MINIMUM_CHILDREN_TO_MERGE)
-        {
-            // Transfer values from the left sibling to this node
-            for (int i = GetNumValues(); i > 0; i--)
-            {
-                values[i] = values[i - 1];
-            }
-
-            values[0] = leftSibling->values[leftSibling->GetNumValues() - 1];
-
-            // Update the parent's key
-            if (parent)
-            {
-                parent->SetKey(parent->FindChildIndex(this), values[0].GetDataValue());
-            }
-
-            // Remove the value from the left sibling
-            leftSibling->values[leftSibling->GetNumValues() - 1].setDataValue(0);
-
-            return true;
-        }
-
-        // Merge with the right sibling if possible
-        if (rightSibling && rightSibling->GetNumValues() > MINIMUM_CHILDREN_TO_MERGE)
-        {
-            // Transfer values from the right sibling to this node
-            values[GetNumValues()] = rightSibling->values[0];
-
-            // Update the parent's key
-            if (parent)
-            {
-                parent->SetKey(parent->FindChildIndex(rightSibling), rightSibling->values[1].GetDataValue());
-            }
-
-            // Shift values in the right sibling
-            for (int i = 0; i < rightSibling->GetNumValues() - 1; i++)
-            {
-                rightSibling->values[i] = rightSibling->values[i + 1];
-            }
-
-            // Remove the last value from the right sibling
-            rightSibling->values[rightSibling->GetNumValues() - 1].setDataValue(0);
-
-            return true;
-        }
-
-        // If merging with siblings is not possible, consider merging with the parent
-        if (parent)
-        {
-            // Check if merging with the parent is possible and beneficial
-            if (parent->ChildCount() > MINIMUM_CHILDREN_TO_MERGE)
-            {
-                int indexInParent = parent->FindChildIndex(this);
-
-                if (indexInParent > 0)
-                {
-                    // Merge with the left sibling and update the parent's key
-                    BPlusTreeExternalNode<T, N, M>* leftSibling = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(parent->GetChild(indexInParent - 1));
-                    leftSibling->Merge();
-                    parent->RemoveChild(this);
-                    delete this;
-                }
-                else if (indexInParent < parent->ChildCount() - 1)
-                {
-                    // Merge with the right sibling and update the parent's key
-                    BPlusTreeExternalNode<T, N, M>* rightSibling = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(parent->GetChild(indexInParent + 1));
-                    rightSibling->Merge();
-                    parent->RemoveChild(rightSibling);
-                    delete rightSibling;
-                }
-            }
-        }
-
-        return false; // Cannot merge
-    }
-
-
-
-    template <typename T, int N, int M>
-    void BPlusTreeExternalNode<T, N, M>::Print() // Print logic not same as internal node
-    {
-        std::cout << "[";
-        for (int i = 0; i < M; i++)
-        {
-            if (values[i].GetDataValue() != 0)
-            {
-                std::cout << values[i].GetDataValue();
-            }
-            if (i < M - 1)
-            {
-                std::cout << ", ";
-            }
-        }
-        std::cout << "]";
-    }
-
-    template <typename T, int N, int M>
-    bool BPlusTreeExternalNode<T, N, M>::isFull()
-    {
-        for (int i = 0; i < M; i++)
-        {
-            if (values[i].GetDataValue() == 0)
-                return false;
-        }
+    if (leaf->count >= MinExternalKeys)
         return true;
-    }
-
-    template <typename T, int N, int M>
-    bool BPlusTreeExternalNode<T, N, M>::Contains(T data)
-    {
-        for (int i = 0; i < M; i++)
-        {
-            if (values[i].GetDataValue() == data)
-                return true;
-        }
-        return false;
-    }
- 
-
-    template <typename T, int N, int M>
-    int BPlusTreeExternalNode<T, N, M>::GetNumValues()
-    {
-        int count = 0;
-        for (int i = 0; i < M; i++)
-        {
-            if (values[i].GetDataValue() != 0)
-                count++;
-        }
-        return count;
-    }
-
-    template <typename T, int N, int M>
-    T BPlusTreeExternalNode<T, N, M>::GetMaxValue()
-    {
-        return values[M - 1].GetDataValue();
-    }
-//** B+ Tree **//
-
-    template <typename T, int N, int M>
-    bool BPlusTree<T, N, M>::Insert(T data) {
-        // Create a BPlusTreeDataValue object with the provided data
-        BPlusTreeDataValue<T, N, M> dataValue(data);
-
-        // Attempt to insert the data into the tree
-        bool insertionResult = _Insert(dataValue.GetDataValue());
-
-        if (insertionResult) {
-            // If insertion was successful, update the keys in internal nodes
-            UpdateKeys(root);
-        }
-
-        return insertionResult;
-    }
-
-    template <typename T, int N, int M>
-    bool BPlusTree<T, N, M>::Delete(T data) {
-        // Attempt to delete the data from the tree
-        bool deletionResult = _Delete(data);
+    _RebalanceExternal(leaf, path[depth - 1], pathIndex[depth - 1]);
 
-        if (deletionResult) {
-            // If deletion was successful, update the keys in internal nodes
-            UpdateKeys(root);
-        }
-
-        return deletionResult;
-    }
-
-
-    template <typename T, int N, int M>
-    bool BPlusTree<T, N, M>::_Insert(T data) {
-        // Check if the tree is empty
-        if (root == nullptr) {
-            // Create a new root external node
-            BPlusTreeExternalNode<T, N, M>* newRoot = new BPlusTreeExternalNode<T, N, M>();
-
-            // Insert the new data value into the new root external node
-            newRoot->InsertExternal(new BPlusTreeDataValue<T, N, M>(data));
-
-            // Set the root to the new root
-            root = newRoot;
-            return true; // Insertion was successful
-        }
-
-        // Find the leaf node where the data should be inserted
-        BPlusTreeExternalNode<T, N, M>* leafNode = root->FindLeafNode(data);
-
-        // Check if the leaf node is full and needs to be split
-        if (leafNode->isFull()) {
-            // Split the leaf node and update the parent nodes as necessary
-            BPlusTreeExternalNode<T, N, M>* newSibling = leafNode->SplitExternal();
-            if (newSibling) {
-                // Create a new internal node as the parent of the split nodes
-                BPlusTreeInternalNode<T, N, M>* newParent = new BPlusTreeInternalNode<T, N, M>();
-                newParent->InsertInternal(new BPlusTreeDataNodePointer<T, N, M>(leafNode));
-                newParent->InsertInternal(new BPlusTreeDataNodePointer<T, N, M>(newSibling));
-
-                // Update the parent pointers for the split nodes
-                leafNode->SetParent(newParent);
-                newSibling->SetParent(newParent);
-
-                // Update the root if necessary
-                if (root == leafNode) {
-                    root = newParent;
-                }
-            }
-        }
-
-        // Insert the data into the leaf node
-        leafNode->InsertExternal(new BPlusTreeDataValue<T, N, M>(data));
-        return true; // Insertion was successful
-    }
-
-
-
-
-   template <typename T, int N, int M>
-    bool BPlusTree<T, N, M>::_Delete(T data)
-    {
-        // Step 1: Find the leaf node
-        BPlusTreeExternalNode<T, N, M>* leafNode = root->FindLeafNode(data);
-
-        if (!leafNode)
-        {
-            // Data not found, no action required
-            return false;
-        }
-
-        // Step 2: Check if we need to merge or move
-        const int MIN_MERGE_VAL = M / 2;
-
-        // Step 2.1: Can we delete?
-        if (leafNode->GetNumValues() > MIN_MERGE_VAL)
-        {
-            // Step 2.1.1: Yes, delete
-            bool deleted = leafNode->DeleteExternal(data);
-
-            // Check if the deletion was successful
-            if (!deleted)
-            {
-            std::cout << "Error: Data couldn't be deleted, leafNode->DeleteExternal(data) returned false" << std::endl;
-            return false;
+    // A merge took a key from the parent, fix underfull internal nodes up to the root
+    for (int level = depth - 1; level >= 0; --level) {
+        InternalNode* internalNode = path[level];
+        if (level == 0) {
+            if (internalNode->count == 0) {
+                root = internalNode->children[0];
+                destroyNode(internalAlloc, internalNode);
             }
+            break;
         }
-        else
-        {
-            // Step 2.2: Can we borrow from a sibling? (left or right)
-            BPlusTreeNode<T, N, M>* parent = leafNode->parent;
-            int indexInParent = parent->FindChildIndex(leafNode);
-
-            // Attempt to borrow from left sibling
-            if (indexInParent > 0)
-            {
-                BPlusTreeExternalNode<T, N, M>* leftSibling = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(parent->children[indexInParent - 1]);
-
-                if (leftSibling && leftSibling->GetNumValues() > MIN_MERGE_VAL)
-                {
-                    // Step 2.2.1: Yes, borrow from leftSibling
-
-                    // Get the largest value from the left sibling
-                    BPlusTreeDataValue<T, N, M>* borrowedValue = leftSibling->values[leftSibling->GetNumValues() - 1];
-
-                    // Find the position to insert the borrowed value
-                    int insertIndex = 0;
-                    while (insertIndex < M && leafNode->values[insertIndex] != nullptr && leafNode->values[insertIndex]->GetValue() < borrowedValue->GetValue())
-                    {
-                        insertIndex++;
-                    }
-
-                    // Shift elements to make space for the borrowed value
-                    for (int i = M - 1; i > insertIndex; i--)
-                    {
-                        leafNode->values[i] = leafNode->values[i - 1];
-                    }
-
-                    // Insert the borrowed value into the leaf node
-                    leafNode->values[insertIndex] = borrowedValue;
-
-                    // Remove the borrowed value from the left sibling
-                    leftSibling->values[leftSibling->GetNumValues() - 1] = nullptr;
-
-                    return true;
-                }
-            }
-
-            // Attempt to borrow from right sibling
-            if (indexInParent < parent->ChildCount() - 1)
-            {
-                BPlusTreeExternalNode<T, N, M>* rightSibling = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(parent->children[indexInParent + 1]);
-
-                if (rightSibling && rightSibling->GetNumValues() > MIN_MERGE_VAL)
-                {
-                    // Step 2.2.2: Yes, borrow from rightSibling
-
-                    // Get the smallest value from the right sibling
-                    BPlusTreeDataValue<T, N, M>* borrowedValue = rightSibling->values[0];
-
-                    // Find the position to insert the borrowed value
-                    int insertIndex = 0;
-                    while (insertIndex < M && leafNode->values[insertIndex] != nullptr && leafNode->values[insertIndex]->GetValue() < borrowedValue->GetValue())
-                    {
-                        insertIndex++;
-                    }
-
-                    // Shift elements to make space for the borrowed value
-                    for (int i = M - 1; i > insertIndex; i--)
-                    {
-                        leafNode->values[i] = leafNode->values[i - 1];
-                    }
-
-                    // Insert the borrowed value into the leaf node
-                    leafNode->values[insertIndex] = borrowedValue;
-
-                    // Remove the borrowed value from the right sibling
-                    for (int i = 0; i < rightSibling->GetNumValues() - 1; i++)
-                    {
-                        rightSibling->values[i] = rightSibling->values[i + 1];
-                    }
-                    rightSibling->values[rightSibling->GetNumValues() - 1] = nullptr;
-
-                    return true;
-                }
-            }
-            else
-            {
-                // Step 2.2.3: No, go to Step 2.3
-                // Implement the merge logic in Step 2.3
-            }
-        }
-
-        // Handle the root if needed
-        if (root->ChildCount() == 0)
-        {
-            // The root node is empty, update it accordingly
-            // This might involve changing the root node
-        }
-
-        return true; // Deletion was successful
-    }
-
-
-
-template <typename T, int N, int M>
-bool BPlusTree<T, N, M>::_Search(T data) {
-    // Start the search from the root node
-    BPlusTreeNode<T, N, M>* currentNode = root;
-
-    while (currentNode) {
-        if (currentNode->GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::External) {
-            // If the current node is a leaf (external node), search for the data in it
-            BPlusTreeExternalNode<T, N, M>* leafNode = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(currentNode);
-            
-            if (leafNode->Contains(data)) {
-                // Data found in the leaf node
-                return true;
-            } else {
-                // Data not found
-                return false;
-            }
-        } else if (currentNode->GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::Internal) {
-            // If the current node is an internal node, find the child node to traverse
-            BPlusTreeInternalNode<T, N, M>* internalNode = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(currentNode);
-
-            // Find the correct child node based on keys
-            int childIndex = 0;
-            while (childIndex < internalNode->ChildCount() && internalNode->GetKey(childIndex) <= data) {
-                childIndex++;
-            }
-
-            // Update the current node to the child node for the next iteration
-            currentNode = internalNode->GetChild(childIndex);
-        }
+        if (internalNode->count >= MinInternalKeys)
+            break;
+        _RebalanceInternal(internalNode, path[level - 1], pathIndex[level - 1]);
     }
-
-    // Data not found in the entire tree
-    return false;
+    return true;
 }
 
-
-
- template <typename T, int N, int M>
-    void BPlusTree<T, N, M>::_Print(BPlusTreeNode<T, N, M>* node)
-    {
-        _InOrderTraversal(node, 0);
+// Refills an underfull leaf from a sibling, or merges it with one when neither can spare a key
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_RebalanceExternal(ExternalNode* node, InternalNode* parent, int index) {
+    ExternalNode* left = index > 0 ? static_cast<ExternalNode*>(parent->children[index - 1]) : nullptr;
+    ExternalNode* right = index < parent->count ? static_cast<ExternalNode*>(parent->children[index + 1]) : nullptr;
+
+    if (left != nullptr && left->count > MinExternalKeys) {
+        _MoveEntries(node, 0, node->count, node, 1);
+        _MoveEntries(left, left->count - 1, 1, node, 0);
+        --left->count;
+        ++node->count;
+        parent->keys[index - 1] = node->keys[0];
+    } else if (right != nullptr && right->count > MinExternalKeys) {
+        _MoveEntries(right, 0, 1, node, node->count);
+        ++node->count;
+        _MoveEntries(right, 1, right->count - 1, right, 0);
+        --right->count;
+        parent->keys[index] = right->keys[0];
+    } else if (left != nullptr) {
+        _MoveEntries(node, 0, node->count, left, left->count);
+        left->count += node->count;
+        left->next = node->next;
+        if (node->next != nullptr)
+            node->next->prev = left;
+        _RemoveFromInternal(parent, index - 1);
+        destroyNode(externalAlloc, node);
+    } else {
+        _MoveEntries(right, 0, right->count, node, node->count);
+        node->count += right->count;
+        node->next = right->next;
+        if (right->next != nullptr)
+            right->next->prev = node;
+        _RemoveFromInternal(parent, index);
+        destroyNode(externalAlloc, right);
     }
+}
 
-    template <typename T, int N, int M>
-    void BPlusTree<T, N, M>::_InOrderTraversal(BPlusTreeNode<T, N, M>* node, int depth)
-    {
-        if (node)
-        {
-            // Recursively traverse and print the left subtree
-            for (int i = 0; i < node->ChildCount(); i++)
-            {
-                _InOrderTraversal(node->GetChild(i), depth + 1);
-            }
-
-            // Print indentation based on depth
-            for (int i = 0; i < depth; i++)
-            {
-                std::cout << "    "; // Use four spaces for each level of depth
-            }
-
-            // Print the keys or values in the current node
-            if (node->GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::External)
-            {
-                BPlusTreeExternalNode<T, N, M>* leafNode = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(node);
-                for (int i = 0; i < M; i++)
-                {
-                    if (leafNode->GetValues()[i].GetDataValue() != 0)
-                    {
-                        std::cout << leafNode->GetValues()[i].GetDataValue() << " ";
-                    }
-                }
-            }
-            else if (node->GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::Internal)
-            {
-                BPlusTreeInternalNode<T, N, M>* internalNode = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(node);
-                for (int i = 0; i < N - 1; i++)
-                {
-                    if (internalNode->GetChild(i) != nullptr)
-                    {
-                        std::cout << internalNode->GetKey(i) << " ";
-                    }
-                }
-            }
-            std::cout << std::endl; // Add a newline for clarity
-
-            // Recursively traverse and print the right subtree
-            if (node->ChildCount() > 0)
-            {
-                _InOrderTraversal(node->GetChild(node->ChildCount() - 1), depth + 1);
-            }
-        }
-    }
-
-    template <typename T, int N, int M>
-    void BPlusTree<T, N, M>::_Clear(BPlusTreeNode<T, N, M>* node)
-    {
-        if (!node)
-        {
-            return; // Nothing to clear
-        }
-
-        if (node->GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::External)
-        {
-            // If the node is a leaf node, cast it to an external node and clear its contents
-            BPlusTreeExternalNode<T, N, M>* leafNode = dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(node);
-            for (int i = 0; i < M; i++)
-            {
-                if (leafNode->GetValues()[i].GetDataValue() != 0)
-                {
-                    leafNode->GetValues()[i].setDataValue(0);
-                }
-            }
-        }
-        else
-        {
-            // If the node is an internal node, cast it to an internal node and recursively clear its children
-            BPlusTreeInternalNode<T, N, M>* internalNode = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(node);
-            for (int i = 0; i < N; i++)
-            {
-                if (internalNode->GetChild(i) != nullptr)
-                {
-                    _Clear(internalNode->GetChild(i));
-                }
-            }
-        }
-
-        // After clearing the children, delete the current node
-        delete node;
-    }
-    
-    template <typename T, int N, int M>
-    void BPlusTree<T, N, M>::UpdateKeys(BPlusTreeNode<T, N, M>* node) {
-        if (!node || node->IsRoot()) {
-            return;
-        }
-
-        // Calculate the new key value for this node based on its children
-        T newKey = CalculateNewKey(node);
-
-        // Update the key value in the node if it's an internal node
-        if (node->GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::Internal) {
-            BPlusTreeInternalNode<T, N, M>* internalNode = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(node);
-
-            // Find the index for inserting the new key
-            int index = 0;
-            while (index < internalNode->GetKeyCount() && internalNode->GetKey(index) < newKey) {
-                index++;
-            }
-
-            // Set the new key value at the specified index
-            internalNode->SetKey(index, newKey);
-        }
-
-        // Recursively update keys for parent nodes
-        UpdateKeys(node->GetParent());
+// Same as _RebalanceExternal for internal nodes, keys rotate through the parent
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_RebalanceInternal(InternalNode* node, InternalNode* parent, int index) {
+    InternalNode* left = index > 0 ? static_cast<InternalNode*>(parent->children[index - 1]) : nullptr;
+    InternalNode* right = index < parent->count ? static_cast<InternalNode*>(parent->children[index + 1]) : nullptr;
+
+    if (left != nullptr && left->count > MinInternalKeys) {
+        _MoveRange(node->keys, node->count, node->keys + 1);
+        _MoveRange(node->children, node->count + 1, node->children + 1);
+        node->keys[0] = std::move(parent->keys[index - 1]);
+        node->children[0] = left->children[left->count];
+        parent->keys[index - 1] = std::move(left->keys[left->count - 1]);
+        --left->count;
+        ++node->count;
+    } else if (right != nullptr && right->count > MinInternalKeys) {
+        node->keys[node->count] = std::move(parent->keys[index]);
+        node->children[node->count + 1] = right->children[0];
+        ++node->count;
+        parent->keys[index] = std::move(right->keys[0]);
+        _MoveRange(right->keys + 1, right->count - 1, right->keys);
+        _MoveRange(right->children + 1, right->count, right->children);
+        --right->count;
+    } else if (left != nullptr) {
+        _MergeInternal(left, node, parent, index - 1);
+    } else {
+        _MergeInternal(node, right, parent, index);
     }
+}
 
-    template <typename T, int N, int M>
-    T BPlusTree<T, N, M>::CalculateNewKey(BPlusTreeNode<T, N, M>* node) {
-        if (!node || node->IsRoot()) {
-            // Handle invalid input or base case if needed
-            // You might return a default key or throw an exception here.
-            // It depends on how you want to handle such cases.
-        }
-
-        T newKey;
-
-        if (node->GetNodeType() == BPlusTreeNode<T, N, M>::NodeType::Internal) {
-            BPlusTreeInternalNode<T, N, M>* internalNode = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(node);
-
-            // Use the first key as the associated data value for calculating the new key
-            newKey = internalNode->GetKey(0);
-        } else {
-            // For leaf nodes, calculate the new key based on the highest value in the leaf node
-            BPlusTreeExternalNode<T, N, M>* associatedLeafNode = _FindAssociatedLeafNode(node, newKey); // Pass 'newKey' here
-            newKey = associatedLeafNode->GetMaxValue();
-        }
+// Appends the separator and all of right to left, then drops right
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_MergeInternal(InternalNode* left, InternalNode* right, InternalNode* parent, int separatorIndex) {
+    left->keys[left->count] = std::move(parent->keys[separatorIndex]);
+    std::move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+    std::copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+    left->count += right->count + 1;
+    _RemoveFromInternal(parent, separatorIndex);
+    destroyNode(internalAlloc, right);
+}
 
-        // Recursively calculate the new key for parent nodes if not the root
-        if (!node->IsRoot()) {
-            newKey = CalculateNewKey(node->GetParent());
-        }
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_RemoveFromInternal(InternalNode* node, int keyIndex) {
+    _MoveRange(node->keys + keyIndex + 1, node->count - keyIndex - 1, node->keys + keyIndex);
+    _MoveRange(node->children + keyIndex + 2, node->count - keyIndex - 1, node->children + keyIndex + 1);
+    --node->count;
+}
 
-        return newKey;
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_Print(Node* node, int depth) {
+    if (!node)
+        return;
+
+    // Print indentation based on depth
+    for (int i = 0; i < depth; i++)
+        std::cout << "    "; // Use four spaces for each level of depth
+
+    // Print the keys in the current node, then its children one level deeper
+    if (node->isLeaf) {
+        ExternalNode* leafNode = static_cast<ExternalNode*>(node);
+        for (int i = 0; i < leafNode->count; i++)
+            std::cout << leafNode->keys[i] << " ";
+        std::cout << std::endl;
+    } else {
+        InternalNode* internalNode = static_cast<InternalNode*>(node);
+        for (int i = 0; i < internalNode->count; i++)
+            std::cout << internalNode->keys[i] << " ";
+        std::cout << std::endl;
+        for (int i = 0; i <= internalNode->count; i++)
+            _Print(internalNode->children[i], depth + 1);
     }
+}
 
+template <typename T, int N, int M, class Alloc, class V, class Compare>
+void BPlusTree<T, N, M, Alloc, V, Compare>::_Clear(Node* node) {
+    if (!node)
+        return; // Nothing to clear
 
-
-    template <typename T, int N, int M>
-    BPlusTreeExternalNode<T, N, M>* BPlusTree<T, N, M>::_FindAssociatedLeafNode(BPlusTreeNode<T, N, M>* node, T data) { // Pass 'data' as a parameter
-        BPlusTreeNode<T, N, M>* currentNode = node;
-
-        while (currentNode->GetNodeType()!= BPlusTreeNode<T, N, M>::NodeType::External) {
-            BPlusTreeInternalNode<T, N, M>* internalNode = dynamic_cast<BPlusTreeInternalNode<T, N, M>*>(currentNode);
-
-            // Find the index of the child to follow based on the data
-            int index = 0;
-            while (index < internalNode->GetKeyCount() && data >= internalNode->GetKey(index)) {
-                index++;
-            }
-
-            // Move to the appropriate child
-            currentNode = internalNode->GetChild(index);
-        }
-
-        // At this point, currentNode is a leaf node associated with the given data
-        return dynamic_cast<BPlusTreeExternalNode<T, N, M>*>(currentNode);
+    if (node->isLeaf) {
+        destroyNode(externalAlloc, static_cast<ExternalNode*>(node));
+        return;
     }
+    InternalNode* internalNode = static_cast<InternalNode*>(node);
+    for (int i = 0; i <= internalNode->count; i++)
+        _Clear(internalNode->children[i]);
+    destroyNode(internalAlloc, internalNode);
+}
 
 
 } // VLIB
-#endif // __BPLUS_TREE_H__
\ No newline at end of file
+
+#endif // __BPLUS_TREE_H__
@@ -1,19 +1,28 @@
 #ifndef BTree_H
 #define BTree_H
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "../../../Memory/NodeAllocator.h"
+#include "../../Compare.h"
+#include "NodeLayout.h"
+#include "NodeSearch.h"
 
 namespace VLIB
 {
 // A node in a BTree with a maximum of n children
-template <typename T, int NumOfChildren>
-class BTreeNode {
+// The keys come first so a search reads them from the start of the (cache line aligned) node
+template <typename T, int NumOfChildren, class Compare = std::less<T>>
+class alignas(NodeAlignment(alignof(T) > alignof(void*) ? alignof(T) : alignof(void*))) BTreeNode {
 private:
     T data[NumOfChildren - 1];  // Array to store data
-    BTreeNode<T, NumOfChildren> *children[NumOfChildren];  // Array of child pointers
     int numElements;  // Number of elements currently in the node
-    BTreeNode<T, NumOfChildren> *parent;  // Pointer to the parent node
+    BTreeNode<T, NumOfChildren, Compare> *children[NumOfChildren];  // Array of child pointers
+    BTreeNode<T, NumOfChildren, Compare> *parent;  // Pointer to the parent node
 
 public:
     BTreeNode();
@@ -27,57 +36,89 @@ public:
     T* getData() { return data; }
     T getElement(int index) { return data[index]; }
     T _getHighestElement();
-    BTreeNode<T, NumOfChildren>** getChildren() { return children; }
-    BTreeNode<T, NumOfChildren>* getParent() { return parent; }
-    BTreeNode<T, NumOfChildren>* getChild(int index) { return children[index]; }
-    BTreeNode<T, NumOfChildren>* getLeftSibling();
-    BTreeNode<T, NumOfChildren>* getRightSibling();
-
-    void setChild(int index, BTreeNode<T, NumOfChildren> *child) { children[index] = child; }
-    void setParent(BTreeNode<T, NumOfChildren> *parent) { this->parent = parent; }
+    BTreeNode<T, NumOfChildren, Compare>** getChildren() { return children; }
+    BTreeNode<T, NumOfChildren, Compare>* getParent() { return parent; }
+    BTreeNode<T, NumOfChildren, Compare>* getChild(int index) { return children[index]; }
+    BTreeNode<T, NumOfChildren, Compare>* getLeftSibling();
+    BTreeNode<T, NumOfChildren, Compare>* getRightSibling();
+
+    void setChild(int index, BTreeNode<T, NumOfChildren, Compare> *child) { children[index] = child; }
+    void setParent(BTreeNode<T, NumOfChildren, Compare> *parent) { this->parent = parent; }
     void replaceElement(int index, T data) { this->data[index] = data; }
-    int findChildIndex(BTreeNode<T, NumOfChildren> *child);
+    void setNumElements(int count) { numElements = count; }
+    int findChildIndex(BTreeNode<T, NumOfChildren, Compare> *child);
+    // The ordering is passed in by the tree, nodes do not keep a copy of the comparator
+    template <class K>
+    int lowerBound(const K& value, const Compare& comp = Compare()) const { return NodeLowerBound(data, numElements, value, comp); } // First element not less than value
+    template <class K>
+    int upperBound(const K& value, const Compare& comp = Compare()) const { return NodeUpperBound(data, numElements, value, comp); } // First element greater than value
     void removeChild(int index) { children[index] = nullptr; }
 
     // Methods for B-tree operations
-    bool search(T data);
-    void insert(const T& value);
+    template <class K>
+    bool search(const K& data, const Compare& comp = Compare());
+    void insert(const T& value, const Compare& comp = Compare());
     T* remove(T data);
     T removeElement(int index);
     void clearElements();
 };
 
-// A BTree with a maximum of n children
-template <typename T, int n>
+// A BTree with a maximum of n children, nodes are allocated through Alloc (rebound to BTreeNode)
+// BulkLoad(first, last, fillFactor) builds the tree bottom-up from sorted input in linear time,
+// nodes are packed to fillFactor * (n - 1) elements but never below the (n - 1) / 2 minimum
+// Elements are ordered by Compare, a transparent one also lets search take other key types (see Compare.h)
+template <typename T, int n, class Alloc = std::allocator<T>, class Compare = std::less<T>>
 class BTree {
 private:
-    BTreeNode<T, n> *root;
+    BTreeNode<T, n, Compare> *root;
+    NodeAllocatorFor<Alloc, BTreeNode<T, n, Compare>> nodeAlloc;
+    Compare comp;
 
     void _insert(T data);
     void _remove(T data);
-    bool _search(T data, BTreeNode<T, n>* node);
-    BTreeNode<T, n> * _splitNode(BTreeNode<T, n> *node);
-    void _mergeNodes(BTreeNode<T, n> *currentNode, int indexOfCurrentNode);
-    void _leftRotate(BTreeNode<T, n> *currentNode, int indexOfCurrentNode);
-    void _replaceWithSmallest(BTreeNode<T, n> *currentNode);
+    template <class K>
+    bool _search(const K& data, BTreeNode<T, n, Compare>* node);
+    BTreeNode<T, n, Compare> * _splitNode(BTreeNode<T, n, Compare> *node);
+    void _mergeNodes(BTreeNode<T, n, Compare> *currentNode, int indexOfCurrentNode);
+    void _leftRotate(BTreeNode<T, n, Compare> *currentNode, int indexOfCurrentNode);
+    void _replaceWithSmallest(BTreeNode<T, n, Compare> *currentNode);
     void _printTree();
-    void _inOrderTraversal(BTreeNode<T, n> *node, int depth);
+    void _inOrderTraversal(BTreeNode<T, n, Compare> *node, int depth);
+    void _clear(BTreeNode<T, n, Compare> *node);
+    static std::size_t _bulkGroupCount(std::size_t items, int target, int minimum);
 
 public:
     BTree();
+    explicit BTree(const Alloc& alloc, const Compare& comp = Compare());
     ~BTree();
     
     void insert(T data) { _insert(data); }
     void remove(T data) { _remove(data); }
-    bool search(T data) { return _search(data, root); }
+    bool search(const T& data) { return _search(data, root); }
+    template <class K, class C = Compare, EnableIfTransparent<C> = 0>
+    bool search(const K& data) { return _search(data, root); } // Heterogeneous lookup, needs a transparent Compare
     void printTree() { _printTree(); }
+    template <class ForwardIt>
+    void BulkLoad(ForwardIt first, ForwardIt last, double fillFactor = 1.0); // Replaces the content with the sorted range
 };
 
 
+// Largest number of children per node that keeps a BTreeNode<T, n> within NodeBytes (at least 3)
+template <typename T, std::size_t NodeBytes,
+          int n = NodeFanOutEstimate(NodeBytes, static_cast<long long>(sizeof(int) + 2 * sizeof(void*)) - static_cast<long long>(sizeof(T)),
+                                     sizeof(T) + sizeof(void*), 3)>
+struct BTreeFanOut : std::conditional<(n <= 3 || sizeof(BTreeNode<T, n>) <= NodeBytes),
+                                      std::integral_constant<int, n>, BTreeFanOut<T, NodeBytes, n - 1>>::type {};
+
+// BTree whose fan-out is derived from a target node size, see NodeLayout.h
+template <typename T, std::size_t NodeBytes = NodeBytesSmall, class Alloc = std::allocator<T>, class Compare = std::less<T>>
+using BTreeAuto = BTree<T, BTreeFanOut<T, NodeBytes>::value, Alloc, Compare>;
+
+
 //** Body for node struct **//
 
-template <typename T, int NumOfChildren>
-BTreeNode<T, NumOfChildren>::BTreeNode() {
+template <typename T, int NumOfChildren, class Compare>
+BTreeNode<T, NumOfChildren, Compare>::BTreeNode() {
     numElements = 0;
     parent = nullptr;
     for (int i = 0; i < NumOfChildren; i++) {
@@ -85,14 +126,14 @@ BTreeNode<T, NumOfChildren>::BTreeNode() {
     }
 }
 
-template <typename T, int NumOfChildren>
-int BTreeNode<T, NumOfChildren>::getNumElements() {
+template <typename T, int NumOfChildren, class Compare>
+int BTreeNode<T, NumOfChildren, Compare>::getNumElements() {
     return numElements; // Simply return the tracked numElements variable
 }
 
 
-template <typename T, int NumOfChildren>
-bool BTreeNode<T, NumOfChildren>::isLeaf() { //returns true if the node is a leaf
+template <typename T, int NumOfChildren, class Compare>
+bool BTreeNode<T, NumOfChildren, Compare>::isLeaf() { //returns true if the node is a leaf
     for (int i = 0; i < NumOfChildren; i++) {
         if (children[i] != nullptr) {
             return false;
@@ -101,30 +142,24 @@ bool BTreeNode<T, NumOfChildren>::isLeaf() { //returns true if the node is a lea
     return true;
 }
 
-template <typename T, int NumOfChildren>
-bool BTreeNode<T, NumOfChildren>::search(T dataToFind) {
-    // Traverse the element array and see if one matches the dataToFind
-    for (int i = 0; i < numElements; i++) {
-        if (dataToFind == data[i]) {
-            return &data[i]; // Return a pointer to the matching element
-        }
-    }
-    return false; // Data not found
+template <typename T, int NumOfChildren, class Compare>
+template <class K>
+bool BTreeNode<T, NumOfChildren, Compare>::search(const K& dataToFind, const Compare& comp) {
+    // The elements are sorted, only the first one not less than dataToFind can match
+    int i = lowerBound(dataToFind, comp);
+    return i < numElements && !comp(dataToFind, data[i]);
 }
 
 
-template <typename T, int NumOfChildren>
-void BTreeNode<T, NumOfChildren>::insert(const T& value) {
+template <typename T, int NumOfChildren, class Compare>
+void BTreeNode<T, NumOfChildren, Compare>::insert(const T& value, const Compare& comp) {
     // Check if the node is full
     if (isFull()) {
         throw std::overflow_error("Node is full");
     }
 
-    int i = 0;
     // Find the correct position to insert 'value' among the existing data elements
-    while (i < getNumElements() && data[i] < value) {
-        i++;
-    }
+    int i = lowerBound(value, comp);
 
     // Shift elements to the right to make space for 'value' if node is not empty
     if (!isEmpty()) {
@@ -142,8 +177,8 @@ void BTreeNode<T, NumOfChildren>::insert(const T& value) {
 
 
 
-template <typename T, int NumOfChildren>
-T *BTreeNode<T, NumOfChildren>::remove(T data)
+template <typename T, int NumOfChildren, class Compare>
+T *BTreeNode<T, NumOfChildren, Compare>::remove(T data)
 {
     // remove data from node and return it
     for (int i = 0; i < NumOfChildren; i++) {
@@ -154,8 +189,8 @@ T *BTreeNode<T, NumOfChildren>::remove(T data)
     }
 }
 
-template <typename T, int NumOfChildren>
-T BTreeNode<T, NumOfChildren>::removeElement(int index) {
+template <typename T, int NumOfChildren, class Compare>
+T BTreeNode<T, NumOfChildren, Compare>::removeElement(int index) {
     if (index >= 0 && index < numElements) {
         T removedElement = data[index]; // Store the element to be removed
 
@@ -175,19 +210,19 @@ T BTreeNode<T, NumOfChildren>::removeElement(int index) {
 }
 
 
-template <typename T, int NumOfChildren>
-void BTreeNode<T, NumOfChildren>::clearElements() {
+template <typename T, int NumOfChildren, class Compare>
+void BTreeNode<T, NumOfChildren, Compare>::clearElements() {
     // Clear all elements from the node
     for (int i = 0; i < numElements; i++)
     {
-        data[i] = 0;
+        data[i] = T(); // Also frees what the old element held
     }
     numElements = 0;
     
 }
 
-template <typename T, int NumOfChildren>
-T BTreeNode<T, NumOfChildren>::_getHighestElement(){
+template <typename T, int NumOfChildren, class Compare>
+T BTreeNode<T, NumOfChildren, Compare>::_getHighestElement(){
     this->getNumElements();
     if (numElements > 0) {
         return data[numElements - 1]; // Return the last element (the highest)
@@ -200,8 +235,8 @@ T BTreeNode<T, NumOfChildren>::_getHighestElement(){
 }
 
 
-template <typename T, int NumOfChildren>
-BTreeNode<T, NumOfChildren>* BTreeNode<T, NumOfChildren>::getLeftSibling()
+template <typename T, int NumOfChildren, class Compare>
+BTreeNode<T, NumOfChildren, Compare>* BTreeNode<T, NumOfChildren, Compare>::getLeftSibling()
 {
     // get the left sibling of the node
     // if the node is the leftmost child, return nullptr
@@ -212,8 +247,8 @@ BTreeNode<T, NumOfChildren>* BTreeNode<T, NumOfChildren>::getLeftSibling()
     }
 }
 
-template <typename T, int NumOfChildren>
-BTreeNode<T, NumOfChildren>* BTreeNode<T, NumOfChildren>::getRightSibling()
+template <typename T, int NumOfChildren, class Compare>
+BTreeNode<T, NumOfChildren, Compare>* BTreeNode<T, NumOfChildren, Compare>::getRightSibling()
 {
     // get the right sibling of the node
     // if the node is the rightmost child, return nullptr
@@ -224,8 +259,8 @@ BTreeNode<T, NumOfChildren>* BTreeNode<T, NumOfChildren>::getRightSibling()
     }
 }
 
-template <typename T, int NumOfChildren>
-int BTreeNode<T, NumOfChildren>::findChildIndex(BTreeNode<T, NumOfChildren> *child)
+template <typename T, int NumOfChildren, class Compare>
+int BTreeNode<T, NumOfChildren, Compare>::findChildIndex(BTreeNode<T, NumOfChildren, Compare> *child)
 {
     for (int i = 0; i < NumOfChildren; i++) {
         if (children[i] == child) {
@@ -238,28 +273,143 @@ int BTreeNode<T, NumOfChildren>::findChildIndex(BTreeNode<T, NumOfChildren> *chi
 
 //** Body for BTree class **//
 
-template <typename T, int n>
-BTree<T, n>::BTree() {
+template <typename T, int n, class Alloc, class Compare>
+BTree<T, n, Alloc, Compare>::BTree() : nodeAlloc(Alloc()) {
     root = nullptr;
     }
 
-template <typename T, int n>
-BTree<T, n>::~BTree() {
+template <typename T, int n, class Alloc, class Compare>
+BTree<T, n, Alloc, Compare>::BTree(const Alloc& alloc, const Compare& comp) : nodeAlloc(alloc), comp(comp) {
+    root = nullptr;
+    }
+
+template <typename T, int n, class Alloc, class Compare>
+BTree<T, n, Alloc, Compare>::~BTree() {
     // delete all nodes in the tree
-    delete root;
+    _clear(root);
+    root = nullptr;
     }
-template <typename T, int n>
-void BTree<T, n>::_insert(T data) {
+
+// Frees node and every node below it
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_clear(BTreeNode<T, n, Compare> *node) {
+    if (!node)
+        return;
+    for (int i = 0; i < n; i++) {
+        _clear(node->getChild(i));
+    }
+    destroyNode(nodeAlloc, node);
+}
+// Bottom-up build: the sorted elements are cut into leaves, the element following each leaf becomes
+// the separator in the level above, and the levels are stacked until a single root is left
+template <typename T, int n, class Alloc, class Compare>
+template <class ForwardIt>
+void BTree<T, n, Alloc, Compare>::BulkLoad(ForwardIt first, ForwardIt last, double fillFactor) {
+    // Count and validate before the current content is dropped
+    std::size_t count = 0;
+    for (ForwardIt previous = first, it = first; it != last; previous = it++, ++count) {
+        if (count > 0 && comp(*it, *previous))
+            throw std::invalid_argument("BulkLoad expects sorted input");
+    }
+
+    _clear(root);
+    root = nullptr;
+    if (count == 0)
+        return;
+
+    const int maxElements = n - 1;
+    const int minElements = std::max(1, (n - 1) / 2);
+    std::vector<BTreeNode<T, n, Compare>*> level;
+    std::vector<T> separators; // separators[i] sits between level[i] and level[i + 1]
+    std::vector<BTreeNode<T, n, Compare>*> nextLevel;
+    std::vector<T> nextSeparators;
+    std::size_t consumed = 0; // Nodes of level already attached to a parent
+    try {
+        // Leaves, every leaf but the last hands the element after it up as separator
+        int leafTarget = std::min(maxElements, std::max(minElements, static_cast<int>(fillFactor * maxElements)));
+        std::size_t leafCount = (count + 1 + leafTarget) / (leafTarget + 1);
+        while (leafCount > 1 && (count - leafCount + 1) / leafCount < static_cast<std::size_t>(minElements))
+            --leafCount;
+        std::size_t leafElements = count - (leafCount - 1);
+        level.reserve(leafCount);
+        separators.reserve(leafCount);
+        ForwardIt it = first;
+        for (std::size_t i = 0; i < leafCount; ++i) {
+            BTreeNode<T, n, Compare> *leaf = constructNode(nodeAlloc);
+            level.push_back(leaf);
+            int elements = static_cast<int>(leafElements / leafCount + (i < leafElements % leafCount ? 1 : 0));
+            for (int j = 0; j < elements; ++j, ++it)
+                leaf->replaceElement(j, *it);
+            leaf->setNumElements(elements);
+            if (i + 1 < leafCount) {
+                separators.push_back(*it);
+                ++it;
+            }
+        }
+
+        // Internal levels, grouping children and the separators between them
+        int childTarget = std::min(n, std::max(minElements + 1, static_cast<int>(fillFactor * n)));
+        while (level.size() > 1) {
+            std::size_t children = level.size();
+            std::size_t parents = _bulkGroupCount(children, childTarget, minElements + 1);
+            nextLevel.clear();
+            nextSeparators.clear();
+            nextLevel.reserve(parents);
+            consumed = 0;
+            for (std::size_t p = 0; p < parents; ++p) {
+                BTreeNode<T, n, Compare> *node = constructNode(nodeAlloc);
+                nextLevel.push_back(node);
+                if (p > 0)
+                    nextSeparators.push_back(separators[consumed - 1]);
+                int group = static_cast<int>(children / parents + (p < children % parents ? 1 : 0));
+                for (int j = 0; j < group; ++j) {
+                    if (j > 0)
+                        node->replaceElement(j - 1, separators[consumed + j - 1]);
+                    node->setChild(j, level[consumed + j]);
+                    level[consumed + j]->setParent(node);
+                }
+                node->setNumElements(group - 1);
+                consumed += group;
+            }
+            level.swap(nextLevel);
+            separators.swap(nextSeparators);
+            nextLevel.clear();
+            consumed = 0;
+        }
+    } catch (...) {
+        // Built nodes are either attached to a node of nextLevel or still loose in level
+        for (BTreeNode<T, n, Compare> *node : nextLevel)
+            _clear(node);
+        for (std::size_t i = consumed; i < level.size(); ++i)
+            _clear(level[i]);
+        throw;
+    }
+
+    root = level[0];
+}
+
+// Number of nodes to spread items over so each gets about target of them but never less than minimum
+// (a single node, the root, is exempt)
+template <typename T, int n, class Alloc, class Compare>
+std::size_t BTree<T, n, Alloc, Compare>::_bulkGroupCount(std::size_t items, int target, int minimum) {
+    std::size_t groups = (items + target - 1) / target;
+    if (groups > 1 && items / groups < static_cast<std::size_t>(minimum))
+        groups = std::max<std::size_t>(1, items / minimum);
+    return groups;
+}
+
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_insert(T data) {
     // Check if the root node is null, and create it if needed
     if (!root) {
-        root = new BTreeNode<T, n>();
-        root->insert(data); // Insert the data into the new root
+        root = constructNode(nodeAlloc);
+        root->insert(data, comp); // Insert the data into the new root
         return; // Return immediately, as the root node now contains the data
     }
 
     // Start at the root node
-    BTreeNode<T, n> *currentNode = root;
-    BTreeNode<T, n> *parentNode = nullptr; // Keep track of the parent node
+    BTreeNode<T, n, Compare> *currentNode = root;
+    BTreeNode<T, n, Compare> *parentNode = nullptr; // Keep track of the parent node
 
     // Traverse the tree to find the leaf node where the data should be inserted
     while (!currentNode->isLeaf()) {
@@ -267,17 +417,13 @@ void BTree<T, n>::_insert(T data) {
         parentNode = currentNode;
 
         // Find the child node where data should be inserted
-        int i = 0;
-        while (i < currentNode->getNumElements() && data >= currentNode->getElement(i)) {
-            i++;
-        }
-        currentNode = currentNode->getChild(i);
+        currentNode = currentNode->getChild(currentNode->upperBound(data, comp));
     }
 
     // Now 'currentNode' is a leaf node where we can insert the data
     if (currentNode->isFull()) {
         // If the leaf node is full, split it, the node being promoted is returned
-        BTreeNode<T, n> *newNode = _splitNode(currentNode); // new node is the node that was promoted, parent of currentNode is updated
+        BTreeNode<T, n, Compare> *newNode = _splitNode(currentNode); // new node is the node that was promoted, parent of currentNode is updated
 
         // Check if the promoted node is the root node
         if(currentNode == root) { root = newNode; }
@@ -287,7 +433,7 @@ void BTree<T, n>::_insert(T data) {
     }
 
     // Insert the data into the leaf node
-    currentNode->insert(data);
+    currentNode->insert(data, comp);
 
 }
 
@@ -295,11 +441,11 @@ void BTree<T, n>::_insert(T data) {
 
 
 // Helper function to split a node into two nodes and return the node that was promoted
-template <typename T, int n>
-BTreeNode<T, n> *BTree<T, n>::_splitNode(BTreeNode<T, n> *node) {
+template <typename T, int n, class Alloc, class Compare>
+BTreeNode<T, n, Compare> *BTree<T, n, Alloc, Compare>::_splitNode(BTreeNode<T, n, Compare> *node) {
     // Step 1: Create two children nodes
-    BTreeNode<T, n> *leftChild = new BTreeNode<T, n>();
-    BTreeNode<T, n> *rightChild = new BTreeNode<T, n>();
+    BTreeNode<T, n, Compare> *leftChild = constructNode(nodeAlloc);
+    BTreeNode<T, n, Compare> *rightChild = constructNode(nodeAlloc);
 
     // Step 2: Calculate the middle index and element
     int middleIndex = (n - 1) / 2;
@@ -307,10 +453,10 @@ BTreeNode<T, n> *BTree<T, n>::_splitNode(BTreeNode<T, n> *node) {
 
     // Step 3: Copy elements to the left and right children nodes
     for (int i = 0; i < middleIndex; i++) {
-        leftChild->insert(node->getElement(i));
+        leftChild->insert(node->getElement(i), comp);
     }
     for (int i = middleIndex + 1; i < n -1; i++) {
-        rightChild->insert(node->getElement(i));
+        rightChild->insert(node->getElement(i), comp);
     }
 
 
@@ -322,7 +468,7 @@ BTreeNode<T, n> *BTree<T, n>::_splitNode(BTreeNode<T, n> *node) {
 
     // Step 5: Update the original node with the middle element
     node->clearElements(); // Clear all elements from the original node
-    node->insert(middleElement);
+    node->insert(middleElement, comp);
 
     // Return the node that was promoted
     return node;
@@ -330,26 +476,23 @@ BTreeNode<T, n> *BTree<T, n>::_splitNode(BTreeNode<T, n> *node) {
 
 
 
-template <typename T, int n>
-void BTree<T, n>::_remove(T data) {
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_remove(T data) {
     // Start at the root node
-    BTreeNode<T, n> *currentNode = root;
+    BTreeNode<T, n, Compare> *currentNode = root;
 
     // Traverse the tree to find the node containing the key 'data'
     while (currentNode) {
-        int i = 0;
-        while (i < currentNode->getNumElements() && data > currentNode->getElement(i)) {
-            i++;
-        }
-        
-        if (i < currentNode->getNumElements() && data == currentNode->getElement(i)) {
+        int i = currentNode->lowerBound(data, comp);
+
+        if (i < currentNode->getNumElements() && !comp(data, currentNode->getElement(i))) {
             // Case 1: Key 'data' is found in the current node
             currentNode->removeElement(i);
 
             // Re-balance the tree if needed
             if (currentNode != root && currentNode->getNumElements() < (n - 1) / 2) {
-                BTreeNode<T, n> *leftSibling = currentNode->getLeftSibling();
-                BTreeNode<T, n> *rightSibling = currentNode->getRightSibling();
+                BTreeNode<T, n, Compare> *leftSibling = currentNode->getLeftSibling();
+                BTreeNode<T, n, Compare> *rightSibling = currentNode->getRightSibling();
 
                 // Case 1a: Left sibling has more than the minimum required elements
                 if (leftSibling && leftSibling->getNumElements() > (n - 1) / 2) {
@@ -380,26 +523,25 @@ void BTree<T, n>::_remove(T data) {
 }
 
 
-template <typename T, int n>
-bool BTree<T, n>::_search(T data, BTreeNode<T, n>* node) {
+template <typename T, int n, class Alloc, class Compare>
+template <class K>
+bool BTree<T, n, Alloc, Compare>::_search(const K& data, BTreeNode<T, n, Compare>* node) {
+    if (!node) {
+        return false; // Empty tree
+    }
+
     // Base Case 1: If the current node is a leaf node and the element is not found, return false
     if (node->isLeaf()) {
-        return node->search(data);
+        return node->search(data, comp);
     }
 
     // Base Case 2: If the element is found in the current node, return true
-    if (node->search(data)) {
+    if (node->search(data, comp)) {
         return true;
     }
 
-    // Find the appropriate child node to traverse to
-    int i = 0;
-    while (i < node->getNumElements() && data > node->getElement(i)) {
-        i++;
-    }
-
-    // Recursively call _search on the chosen child node
-    return _search(data, node->getChild(i));
+    // Find the appropriate child node to traverse to, and recursively call _search on it
+    return _search(data, node->getChild(node->lowerBound(data, comp)));
 }
 
 
@@ -407,12 +549,12 @@ bool BTree<T, n>::_search(T data, BTreeNode<T, n>* node) {
 
 
 // Perform a left rotation between the current node and its right sibling
-template <typename T, int n>
-void BTree<T, n>::_leftRotate(BTreeNode<T, n> *currentNode, int indexOfCurrentNode) {
-    BTreeNode<T, n> *rightSibling = currentNode->getParent()->getChild(indexOfCurrentNode + 1);
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_leftRotate(BTreeNode<T, n, Compare> *currentNode, int indexOfCurrentNode) {
+    BTreeNode<T, n, Compare> *rightSibling = currentNode->getParent()->getChild(indexOfCurrentNode + 1);
 
     // Move a key from the parent node to the left node
-    currentNode->insert(currentNode->getParent()->getElement(indexOfCurrentNode));
+    currentNode->insert(currentNode->getParent()->getElement(indexOfCurrentNode), comp);
     currentNode->getParent()->replaceElement(indexOfCurrentNode, rightSibling->getElement(0));
 
     // Move the first child pointer from the right node to the current node
@@ -424,17 +566,17 @@ void BTree<T, n>::_leftRotate(BTreeNode<T, n> *currentNode, int indexOfCurrentNo
 }
 
 // Merge the current node with its right sibling
-template <typename T, int n>
-void BTree<T, n>::_mergeNodes(BTreeNode<T, n> *currentNode, int indexOfCurrentNode) {
-    BTreeNode<T, n> *rightSibling = currentNode->getParent()->getChild(indexOfCurrentNode + 1);
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_mergeNodes(BTreeNode<T, n, Compare> *currentNode, int indexOfCurrentNode) {
+    BTreeNode<T, n, Compare> *rightSibling = currentNode->getParent()->getChild(indexOfCurrentNode + 1);
 
     // Move a key from the parent node to the left node
-    currentNode->insert(currentNode->getParent()->getElement(indexOfCurrentNode));
+    currentNode->insert(currentNode->getParent()->getElement(indexOfCurrentNode), comp);
     currentNode->getParent()->removeElement(indexOfCurrentNode);
 
     // Move keys and child pointers from the right node to the current node
     for (int i = 0; i < rightSibling->getNumElements(); i++) {
-        currentNode->insert(rightSibling->getElement(i));
+        currentNode->insert(rightSibling->getElement(i), comp);
         currentNode->setChild(currentNode->getNumElements(), rightSibling->getChild(i));
     }
 
@@ -446,9 +588,9 @@ void BTree<T, n>::_mergeNodes(BTreeNode<T, n> *currentNode, int indexOfCurrentNo
 }
 
 // Replace the current node with the smallest element in the right subtree
-template <typename T, int n>
-void BTree<T, n>::_replaceWithSmallest(BTreeNode<T, n> *currentNode) {
-    BTreeNode<T, n> *successorNode = currentNode->getChild(0);
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_replaceWithSmallest(BTreeNode<T, n, Compare> *currentNode) {
+    BTreeNode<T, n, Compare> *successorNode = currentNode->getChild(0);
 
     // Traverse down the left subtree to find the smallest element
     while (!successorNode->isLeaf()) {
@@ -463,13 +605,13 @@ void BTree<T, n>::_replaceWithSmallest(BTreeNode<T, n> *currentNode) {
 }
 
 // Debug
-template <typename T, int n>
-void BTree<T, n>::_printTree() {
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_printTree() {
     _inOrderTraversal(root, 0);
 }
 
-template <typename T, int n>
-void BTree<T, n>::_inOrderTraversal(BTreeNode<T, n> *node, int depth) {
+template <typename T, int n, class Alloc, class Compare>
+void BTree<T, n, Alloc, Compare>::_inOrderTraversal(BTreeNode<T, n, Compare> *node, int depth) {
     if (node) {
         // Recursively traverse and print the right subtree
         _inOrderTraversal(node->getChild(node->getNumElements()), depth + 1);
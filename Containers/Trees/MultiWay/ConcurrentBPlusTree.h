@@ -0,0 +1,461 @@
+#ifndef __CONCURRENT_BPLUS_TREE_H__
+#define __CONCURRENT_BPLUS_TREE_H__
+
+// A thread safe B+ tree using optimistic lock coupling, the template parameters are those of BPlusTree.
+
+// Every node carries an OptimisticLock, a version counter whose lowest bit is the write lock. Readers
+// never write to shared memory: they note the version of a node, read it and check the version again,
+// a change in between means a writer got there first and the operation restarts from the root. On the
+// way down a reader validates the parent after reading the child pointer, so it never follows a
+// pointer out of a node that was being changed.
+// Writers descend the same way and only lock what they change: the leaf for an insert or delete, and
+// a full node plus its parent for a split. Full nodes are split on the way down, so a split never has
+// to go up more than one level.
+
+// Delete never merges nodes, an underfull or empty leaf stays in the tree and takes new keys later.
+// Nodes are therefore never freed while the tree is alive, which is what makes it safe for a reader
+// to look at a node it has not validated yet.
+
+/*
+    Initialization:
+        ConcurrentBPlusTree<int, 64, 64> tree;            // share it between threads, no outer mutex
+        tree.Insert(10);                                  // any thread
+        tree.Search(10);                                  // any thread, scales with cores
+
+        ConcurrentBPlusTree<int, 64, 64, std::allocator<int>, long> map;
+        map.Insert(10, 100);
+        long value;
+        if (map.Find(10, value)) ...                      // the payload is copied out
+
+        tree.Scan(10, 20, [](int key) { ... });           // keys in [10, 20] in order, not a snapshot
+
+    Keys and payloads are read while writers may change them and only used once validated, they have to
+    be trivially copyable. Alloc has to be thread safe, std::allocator is.
+    See Examples/ConcurrentBPlusTreeBenchmark.h for the scaling against a mutex around BPlusTree.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../../../Memory/NodeAllocator.h"
+#include "BPlusTree.h"
+#include "NodeLayout.h"
+#include "NodeSearch.h"
+
+
+namespace VLIB{ // VLIB
+
+// Version counter with a write lock in its lowest bit, a writer bumps the version when it unlocks
+class OptimisticLock {
+public:
+    // Waits out a writer and returns the version to validate against later
+    std::uint64_t ReadLock() const {
+        std::uint64_t version = word.load(std::memory_order_acquire);
+        for (int spins = 0; IsLocked(version); ++spins) {
+            if (spins > 64)
+                std::this_thread::yield();
+            version = word.load(std::memory_order_acquire);
+        }
+        return version;
+    }
+    // True while nothing was written since ReadLock returned version
+    bool Validate(std::uint64_t version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return word.load(std::memory_order_relaxed) == version;
+    }
+    // Takes the write lock if the node is still at version
+    bool TryUpgrade(std::uint64_t version) {
+        return word.compare_exchange_strong(version, version + 1, std::memory_order_acquire);
+    }
+    void Unlock() {word.fetch_add(1, std::memory_order_release);}
+    // Releases a lock under which nothing was written, optimistic readers of version stay valid
+    void UnlockUnchanged(std::uint64_t version) {word.store(version, std::memory_order_release);}
+
+    static bool IsLocked(std::uint64_t version) {return (version & 1) != 0;}
+
+private:
+    std::atomic<std::uint64_t> word{0};
+};
+
+//**** Nodes ****//
+
+// Nodes start on their own cache line, a writer locking one node does not slow down readers of another
+template <typename T, int N, int M, class V = void>
+struct alignas(CacheLineBytes) ConcurrentBPlusTreeNode {
+    OptimisticLock lock;
+    bool isLeaf;
+    int count; // Number of keys held by the node
+
+    explicit ConcurrentBPlusTreeNode(bool leaf) : isLeaf(leaf), count(0) {}
+};
+
+template <typename T, int N, int M, class V = void>
+struct ConcurrentBPlusTreeInternalNode : ConcurrentBPlusTreeNode<T, N, M, V> {
+    T keys[N - 1];
+    ConcurrentBPlusTreeNode<T, N, M, V>* children[N];
+
+    ConcurrentBPlusTreeInternalNode() : ConcurrentBPlusTreeNode<T, N, M, V>(false) {}
+};
+
+template <typename T, int N, int M, class V = void>
+struct ConcurrentBPlusTreeExternalNode : ConcurrentBPlusTreeNode<T, N, M, V> {
+    T keys[M];
+    BPlusTreeLeafPayload<V, M> payload;
+    ConcurrentBPlusTreeExternalNode* next; // Leaf chain for scans, only splits change it
+
+    ConcurrentBPlusTreeExternalNode() : ConcurrentBPlusTreeNode<T, N, M, V>(true), next(nullptr) {}
+};
+
+//**** Concurrent B+ Tree ****//
+template <typename T, int N, int M, class Alloc = std::allocator<T>, class V = void>
+class ConcurrentBPlusTree {
+    static_assert(N >= 3, "an internal node needs room for at least 3 children");
+    static_assert(M >= 2, "an external node needs room for at least 2 keys");
+    static_assert(std::is_trivially_copyable<T>::value, "keys are read optimistically");
+    static_assert(std::is_void<V>::value || std::is_trivially_copyable<V>::value, "payloads are read optimistically");
+
+public:
+    using Node = ConcurrentBPlusTreeNode<T, N, M, V>;
+    using InternalNode = ConcurrentBPlusTreeInternalNode<T, N, M, V>;
+    using ExternalNode = ConcurrentBPlusTreeExternalNode<T, N, M, V>;
+
+private: // Concurrent B+ Tree attributes
+    static constexpr bool HasPayload = !std::is_void<V>::value;
+
+    std::atomic<Node*> root; // Never null, an empty tree is an empty leaf
+    std::atomic<std::size_t> size;
+    NodeAllocatorFor<Alloc, InternalNode> internalAlloc;
+    NodeAllocatorFor<Alloc, ExternalNode> externalAlloc;
+
+    // Key count as read by an optimistic reader, clamped so a torn read cannot index out of the node
+    static int _Count(const Node* node, int capacity) {return std::min(std::max(node->count, 0), capacity);};
+    static void _Backoff(int attempt) {if (attempt > 8) std::this_thread::yield();};
+    bool _FindLeaf(const T& data, ExternalNode*& leaf, std::uint64_t& version) const; // false when it has to restart
+    template <class... Args>
+    bool _Insert(const T& data, Args&&... value);
+    void _Split(InternalNode* parent, std::uint64_t parentVersion, Node* node, std::uint64_t version);
+    void _Clear(Node* node);
+
+public: // Concurrent B+ Tree constructor & destructor
+    ConcurrentBPlusTree() : ConcurrentBPlusTree(Alloc()) {};
+    explicit ConcurrentBPlusTree(const Alloc& alloc) : size(0), internalAlloc(alloc), externalAlloc(alloc) {root.store(constructNode(externalAlloc));};
+    ~ConcurrentBPlusTree() {_Clear(root.load());};
+
+    ConcurrentBPlusTree(const ConcurrentBPlusTree&) = delete;
+    ConcurrentBPlusTree& operator=(const ConcurrentBPlusTree&) = delete;
+
+    // Public Concurrent B+ Tree operations, safe to call from any number of threads at once
+    bool Insert(const T& data){return _Insert(data);}; // Returns false when data is already in the tree, the payload is value initialized
+    template <class U = V> // Not deduced, value converts to V and a key-only tree has no such overload
+    bool Insert(const T& data, const typename std::enable_if<!std::is_void<U>::value, U>::type& value){return _Insert(data, value);};
+    bool Delete(const T& data);
+    bool Search(const T& data) const;
+    template <class U = V>
+    typename std::enable_if<!std::is_void<U>::value, bool>::type Find(const T& data, U& value) const; // Copies the payload out, false if missing
+    template <class Fn>
+    void Scan(const T& low, const T& high, Fn fn) const; // fn(key) or fn(key, value) for every key in [low, high], in order
+
+    // Getters
+    std::size_t Size() const {return size.load(std::memory_order_relaxed);};
+    bool IsEmpty() const {return Size() == 0;};
+};
+
+//** Concurrent B+ Tree public operations **//
+
+template <typename T, int N, int M, class Alloc, class V>
+bool ConcurrentBPlusTree<T, N, M, Alloc, V>::Search(const T& data) const {
+    for (int attempt = 0;; ++attempt) {
+        _Backoff(attempt);
+        ExternalNode* leaf;
+        std::uint64_t version;
+        if (!_FindLeaf(data, leaf, version))
+            continue;
+        int count = _Count(leaf, M);
+        int index = NodeLowerBound(leaf->keys, count, data);
+        bool found = index < count && !(data < leaf->keys[index]);
+        if (leaf->lock.Validate(version))
+            return found;
+    }
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+template <class U>
+typename std::enable_if<!std::is_void<U>::value, bool>::type ConcurrentBPlusTree<T, N, M, Alloc, V>::Find(const T& data, U& value) const {
+    for (int attempt = 0;; ++attempt) {
+        _Backoff(attempt);
+        ExternalNode* leaf;
+        std::uint64_t version;
+        if (!_FindLeaf(data, leaf, version))
+            continue;
+        int count = _Count(leaf, M);
+        int index = NodeLowerBound(leaf->keys, count, data);
+        bool found = index < count && !(data < leaf->keys[index]);
+        U copy;
+        if (found)
+            copy = leaf->payload.values[index];
+        if (leaf->lock.Validate(version)) {
+            if (found)
+                value = copy;
+            return found;
+        }
+    }
+}
+
+// Each leaf is copied out and validated before fn sees its keys, after a failed validation the scan
+// resumes from a fresh descent behind the last key handed out
+template <typename T, int N, int M, class Alloc, class V>
+template <class Fn>
+void ConcurrentBPlusTree<T, N, M, Alloc, V>::Scan(const T& low, const T& high, Fn fn) const {
+    if (high < low)
+        return;
+    std::vector<T> keys;
+    std::vector<typename std::conditional<HasPayload, V, char>::type> values;
+    keys.reserve(M);
+    values.reserve(HasPayload ? M : 0);
+    T from = low;
+    bool inclusive = true; // from itself still has to be handed out
+    for (int attempt = 0;; ++attempt) {
+        _Backoff(attempt);
+        ExternalNode* leaf;
+        std::uint64_t version;
+        if (!_FindLeaf(from, leaf, version))
+            continue;
+        while (true) {
+            keys.clear();
+            values.clear();
+            int count = _Count(leaf, M);
+            int index = inclusive ? NodeLowerBound(leaf->keys, count, from) : NodeUpperBound(leaf->keys, count, from);
+            bool done = false;
+            for (; index < count; ++index) {
+                if (high < leaf->keys[index]) {
+                    done = true;
+                    break;
+                }
+                keys.push_back(leaf->keys[index]);
+                if constexpr (HasPayload)
+                    values.push_back(leaf->payload.values[index]);
+            }
+            ExternalNode* next = leaf->next;
+            if (!leaf->lock.Validate(version))
+                break; // Restart from the last key handed out
+
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                if constexpr (HasPayload)
+                    fn(keys[i], values[i]);
+                else
+                    fn(keys[i]);
+            }
+            if (!keys.empty()) {
+                from = keys.back();
+                inclusive = false;
+            }
+            if (done || next == nullptr)
+                return;
+            leaf = next;
+            version = leaf->lock.ReadLock();
+        }
+    }
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+bool ConcurrentBPlusTree<T, N, M, Alloc, V>::Delete(const T& data) {
+    for (int attempt = 0;; ++attempt) {
+        _Backoff(attempt);
+        ExternalNode* leaf;
+        std::uint64_t version;
+        if (!_FindLeaf(data, leaf, version) || !leaf->lock.TryUpgrade(version))
+            continue;
+        // Locked at the version the descent saw, so leaf is still the one that would hold data
+        int index = NodeLowerBound(leaf->keys, leaf->count, data);
+        if (index == leaf->count || data < leaf->keys[index]) {
+            leaf->lock.UnlockUnchanged(version);
+            return false;
+        }
+        std::move(leaf->keys + index + 1, leaf->keys + leaf->count, leaf->keys + index);
+        if constexpr (HasPayload)
+            std::move(leaf->payload.values + index + 1, leaf->payload.values + leaf->count, leaf->payload.values + index);
+        --leaf->count;
+        leaf->lock.Unlock();
+        size.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+//** Concurrent B+ Tree private helpers **//
+
+template <typename T, int N, int M, class Alloc, class V>
+bool ConcurrentBPlusTree<T, N, M, Alloc, V>::_FindLeaf(const T& data, ExternalNode*& leaf, std::uint64_t& version) const {
+    Node* node = root.load(std::memory_order_acquire);
+    std::uint64_t nodeVersion = node->lock.ReadLock();
+    if (node != root.load(std::memory_order_acquire))
+        return false; // The root was split meanwhile
+    while (!node->isLeaf) {
+        InternalNode* internalNode = static_cast<InternalNode*>(node);
+        Node* child = internalNode->children[NodeUpperBound(internalNode->keys, _Count(internalNode, N - 1), data)];
+        if (!internalNode->lock.Validate(nodeVersion))
+            return false;
+        std::uint64_t childVersion = child->lock.ReadLock();
+        if (!internalNode->lock.Validate(nodeVersion))
+            return false;
+        node = child;
+        nodeVersion = childVersion;
+    }
+    leaf = static_cast<ExternalNode*>(node);
+    version = nodeVersion;
+    return true;
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+template <class... Args>
+bool ConcurrentBPlusTree<T, N, M, Alloc, V>::_Insert(const T& data, Args&&... value) {
+    for (int attempt = 0;; ++attempt) {
+        _Backoff(attempt);
+        Node* node = root.load(std::memory_order_acquire);
+        std::uint64_t version = node->lock.ReadLock();
+        if (node != root.load(std::memory_order_acquire))
+            continue;
+
+        // Descend, splitting the first full node met and restarting after it
+        InternalNode* parent = nullptr;
+        std::uint64_t parentVersion = 0;
+        bool restart = false;
+        while (!node->isLeaf) {
+            InternalNode* internalNode = static_cast<InternalNode*>(node);
+            if (internalNode->count == N - 1) {
+                _Split(parent, parentVersion, node, version);
+                restart = true;
+                break;
+            }
+            Node* child = internalNode->children[NodeUpperBound(internalNode->keys, _Count(internalNode, N - 1), data)];
+            if (!internalNode->lock.Validate(version)) {
+                restart = true;
+                break;
+            }
+            parent = internalNode;
+            parentVersion = version;
+            node = child;
+            version = node->lock.ReadLock();
+            if (!parent->lock.Validate(parentVersion)) {
+                restart = true;
+                break;
+            }
+        }
+        if (restart)
+            continue;
+
+        ExternalNode* leaf = static_cast<ExternalNode*>(node);
+        if (leaf->count == M) {
+            _Split(parent, parentVersion, node, version);
+            continue;
+        }
+        if (!leaf->lock.TryUpgrade(version))
+            continue;
+        if (leaf->count == M) { // Filled up before the lock was taken
+            leaf->lock.UnlockUnchanged(version);
+            continue;
+        }
+
+        int position = NodeLowerBound(leaf->keys, leaf->count, data);
+        if (position < leaf->count && !(data < leaf->keys[position])) {
+            leaf->lock.UnlockUnchanged(version);
+            return false; // Already in the tree
+        }
+        std::move_backward(leaf->keys + position, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+        leaf->keys[position] = data;
+        if constexpr (HasPayload) {
+            std::move_backward(leaf->payload.values + position, leaf->payload.values + leaf->count, leaf->payload.values + leaf->count + 1);
+            leaf->payload.values[position] = V(std::forward<Args>(value)...);
+        }
+        ++leaf->count;
+        leaf->lock.Unlock();
+        size.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+// Splits the full node under its parent, both locked at the versions the descent saw. Anything else
+// changed meanwhile and the split is left to the retry. The parent is never full, it would have been
+// split on the way down.
+template <typename T, int N, int M, class Alloc, class V>
+void ConcurrentBPlusTree<T, N, M, Alloc, V>::_Split(InternalNode* parent, std::uint64_t parentVersion, Node* node, std::uint64_t version) {
+    if (parent != nullptr && !parent->lock.TryUpgrade(parentVersion))
+        return;
+    if (!node->lock.TryUpgrade(version)) {
+        if (parent != nullptr)
+            parent->lock.UnlockUnchanged(parentVersion);
+        return;
+    }
+    if (parent == nullptr && node != root.load(std::memory_order_relaxed)) {
+        node->lock.UnlockUnchanged(version); // Root split by someone else, there is a parent now
+        return;
+    }
+
+    // The upper half moves to a new right sibling, nobody can reach it before the parent links it
+    T separator;
+    Node* sibling;
+    if (node->isLeaf) {
+        ExternalNode* leaf = static_cast<ExternalNode*>(node);
+        ExternalNode* right = constructNode(externalAlloc);
+        int leftCount = M - M / 2;
+        std::copy(leaf->keys + leftCount, leaf->keys + M, right->keys);
+        if constexpr (HasPayload)
+            std::copy(leaf->payload.values + leftCount, leaf->payload.values + M, right->payload.values);
+        right->count = M - leftCount;
+        right->next = leaf->next;
+        leaf->count = leftCount;
+        leaf->next = right;
+        separator = right->keys[0];
+        sibling = right;
+    } else {
+        InternalNode* internalNode = static_cast<InternalNode*>(node);
+        InternalNode* right = constructNode(internalAlloc);
+        int middle = (N - 1) / 2;
+        separator = internalNode->keys[middle];
+        std::copy(internalNode->keys + middle + 1, internalNode->keys + N - 1, right->keys);
+        std::copy(internalNode->children + middle + 1, internalNode->children + N, right->children);
+        right->count = N - 2 - middle;
+        internalNode->count = middle;
+        sibling = right;
+    }
+
+    if (parent != nullptr) {
+        int index = NodeUpperBound(parent->keys, parent->count, separator);
+        std::move_backward(parent->keys + index, parent->keys + parent->count, parent->keys + parent->count + 1);
+        std::move_backward(parent->children + index + 1, parent->children + parent->count + 1, parent->children + parent->count + 2);
+        parent->keys[index] = separator;
+        parent->children[index + 1] = sibling;
+        ++parent->count;
+    } else {
+        InternalNode* newRoot = constructNode(internalAlloc);
+        newRoot->keys[0] = separator;
+        newRoot->children[0] = node;
+        newRoot->children[1] = sibling;
+        newRoot->count = 1;
+        root.store(newRoot, std::memory_order_release);
+    }
+    node->lock.Unlock();
+    if (parent != nullptr)
+        parent->lock.Unlock();
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+void ConcurrentBPlusTree<T, N, M, Alloc, V>::_Clear(Node* node) {
+    if (node->isLeaf) {
+        destroyNode(externalAlloc, static_cast<ExternalNode*>(node));
+        return;
+    }
+    InternalNode* internalNode = static_cast<InternalNode*>(node);
+    for (int i = 0; i <= internalNode->count; i++)
+        _Clear(internalNode->children[i]);
+    destroyNode(internalAlloc, internalNode);
+}
+
+} // namespace VLIB
+
+#endif // __CONCURRENT_BPLUS_TREE_H__
@@ -0,0 +1,122 @@
+#ifndef __CONCURRENT_BPLUS_TREE_BENCHMARK_H__
+#define __CONCURRENT_BPLUS_TREE_BENCHMARK_H__
+
+#include "../BPlusTree.h"
+#include "../ConcurrentBPlusTree.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Throughput of ConcurrentBPlusTree against a BPlusTree behind one global mutex, for 1, 2, 4 .. maxThreads
+// threads and a few read/write mixes. Every thread runs opsPerThread random operations over a key space
+// of keySpace ints, half of which are in the tree at the start. A write is an insert or a delete.
+//
+//     exampleConcurrentBPlusTree::runScalingBenchmark();    // prints Mops/s per thread count and mix
+class exampleConcurrentBPlusTree {
+public:
+    static void runScalingBenchmark(int maxThreads = static_cast<int>(std::thread::hardware_concurrency()),
+                                    int opsPerThread = 1000000, int keySpace = 1 << 22) {
+        if (maxThreads < 1)
+            maxThreads = 1;
+        const int writePercents[] = {0, 5, 50};
+
+        std::cout << std::setw(8) << "threads" << std::setw(8) << "writes"
+                  << std::setw(14) << "mutex Mops/s" << std::setw(14) << "OLC Mops/s" << std::endl;
+        std::vector<int> threadCounts;
+        for (int threads = 1; threads < maxThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(maxThreads);
+
+        for (int writePercent : writePercents) {
+            for (int threads : threadCounts) {
+                double locked = runLocked(threads, opsPerThread, keySpace, writePercent);
+                double optimistic = runOptimistic(threads, opsPerThread, keySpace, writePercent);
+                std::cout << std::setw(8) << threads << std::setw(7) << writePercent << "%"
+                          << std::setw(14) << std::fixed << std::setprecision(2) << locked
+                          << std::setw(14) << optimistic << std::endl;
+            }
+        }
+    }
+
+private:
+    using Locked = VLIB::BPlusTree<int, 64, 64>;
+    using Optimistic = VLIB::ConcurrentBPlusTree<int, 64, 64>;
+
+    // Small xorshift per thread, rand() would serialize the threads on its own lock
+    static std::uint32_t nextRandom(std::uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Runs body(random state) on every thread at once, returns the throughput in Mops/s
+    template <class Body>
+    static double timeThreads(int threads, int opsPerThread, Body body) {
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::uint32_t state = 0x9E3779B9u * static_cast<std::uint32_t>(t + 1);
+                ++ready;
+                while (!go.load())
+                    std::this_thread::yield();
+                body(state);
+            });
+        }
+        while (ready.load() != threads)
+            std::this_thread::yield();
+        auto start = std::chrono::steady_clock::now();
+        go.store(true);
+        for (std::thread& worker : workers)
+            worker.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(threads) * opsPerThread / seconds / 1e6;
+    }
+
+    static double runLocked(int threads, int opsPerThread, int keySpace, int writePercent) {
+        Locked tree;
+        std::mutex mutex;
+        for (int key = 0; key < keySpace; key += 2)
+            tree.Insert(key);
+        return timeThreads(threads, opsPerThread, [&](std::uint32_t& state) {
+            for (int i = 0; i < opsPerThread; ++i) {
+                int key = static_cast<int>(nextRandom(state) % static_cast<std::uint32_t>(keySpace));
+                bool write = static_cast<int>(nextRandom(state) % 100) < writePercent;
+                std::lock_guard<std::mutex> guard(mutex);
+                if (!write)
+                    tree.Search(key);
+                else if (key & 1)
+                    tree.Insert(key);
+                else
+                    tree.Delete(key);
+            }
+        });
+    }
+
+    static double runOptimistic(int threads, int opsPerThread, int keySpace, int writePercent) {
+        Optimistic tree;
+        for (int key = 0; key < keySpace; key += 2)
+            tree.Insert(key);
+        return timeThreads(threads, opsPerThread, [&](std::uint32_t& state) {
+            for (int i = 0; i < opsPerThread; ++i) {
+                int key = static_cast<int>(nextRandom(state) % static_cast<std::uint32_t>(keySpace));
+                bool write = static_cast<int>(nextRandom(state) % 100) < writePercent;
+                if (!write)
+                    tree.Search(key);
+                else if (key & 1)
+                    tree.Insert(key);
+                else
+                    tree.Delete(key);
+            }
+        });
+    }
+};
+
+#endif // __CONCURRENT_BPLUS_TREE_BENCHMARK_H__
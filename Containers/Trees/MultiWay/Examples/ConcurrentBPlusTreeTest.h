@@ -0,0 +1,169 @@
+#ifndef __CONCURRENT_BPLUS_TREE_TEST_H__
+#define __CONCURRENT_BPLUS_TREE_TEST_H__
+
+#include "../ConcurrentBPlusTree.h"
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Multi-threaded checks of ConcurrentBPlusTree. The nodes are kept small so the threads split leaves,
+// internal nodes and the root all the time, and the checks only look at what has to hold whatever the
+// interleaving: every key inserted once, the successful calls adding up to the final size, and scans
+// seeing the keys no thread touches in order.
+//
+//     bool ok = exampleConcurrentBPlusTreeTest::runContentionTest();    // 4 threads
+class exampleConcurrentBPlusTreeTest {
+public:
+    static bool runContentionTest(int threads = 4, int keysPerThread = 20000) {
+        if (threads < 2)
+            threads = 2;
+        bool ok = true;
+        ok &= runDisjointInserts(threads, keysPerThread);
+        ok &= runSameKeys(threads, keysPerThread);
+        ok &= runScansDuringSplits(threads, keysPerThread);
+        std::cout << (ok ? "ConcurrentBPlusTree contention: passed" : "ConcurrentBPlusTree contention: FAILED") << std::endl;
+        return ok;
+    }
+
+private:
+    using Map = VLIB::ConcurrentBPlusTree<int, 4, 4, std::allocator<int>, long>;
+
+    // Interleaved keys from every thread, the splits race on the same leaves
+    static bool runDisjointInserts(int threads, int keysPerThread) {
+        Map map;
+        std::atomic<int> failed(0);
+        runThreads(threads, [&](int thread) {
+            for (int i = 0; i < keysPerThread; ++i) {
+                int key = i * threads + thread;
+                if (!map.Insert(key, static_cast<long>(key) * 10))
+                    ++failed;
+            }
+        });
+
+        int total = threads * keysPerThread;
+        bool ok = failed.load() == 0 && map.Size() == static_cast<std::size_t>(total);
+        int expected = 0;
+        map.Scan(0, total, [&](int key, long value) {
+            ok &= key == expected && value == static_cast<long>(key) * 10;
+            ++expected;
+        });
+        ok &= expected == total;
+        return report(ok, "disjoint inserts");
+    }
+
+    // Every thread inserts and then deletes the same keys, each key goes in once and out once
+    static bool runSameKeys(int threads, int keysPerThread) {
+        Map map;
+        std::atomic<int> inserted(0);
+        std::atomic<int> deleted(0);
+        runThreads(threads, [&](int thread) {
+            for (int i = 0; i < keysPerThread; ++i) {
+                int key = thread % 2 == 0 ? i : keysPerThread - 1 - i; // Half the threads come from the other end
+                if (map.Insert(key, static_cast<long>(key) * 10))
+                    ++inserted;
+            }
+        });
+        bool ok = inserted.load() == keysPerThread && map.Size() == static_cast<std::size_t>(keysPerThread);
+        for (int key = 0; key < keysPerThread; ++key) {
+            long value = 0;
+            ok &= map.Find(key, value) && value == static_cast<long>(key) * 10;
+        }
+
+        runThreads(threads, [&](int thread) {
+            for (int i = 0; i < keysPerThread; ++i) {
+                int key = thread % 2 == 0 ? i : keysPerThread - 1 - i;
+                if (map.Delete(key))
+                    ++deleted;
+            }
+        });
+        ok &= deleted.load() == keysPerThread && map.IsEmpty();
+        for (int key = 0; key < keysPerThread; ++key)
+            ok &= !map.Search(key);
+
+        // Every thread toggles the same small set of keys, the successful calls give the final size
+        std::atomic<int> net(0);
+        runThreads(threads, [&](int thread) {
+            for (int i = 0; i < keysPerThread; ++i) {
+                int key = (i * 7 + thread) % 64;
+                if (i % 3 == 2) {
+                    if (map.Delete(key))
+                        --net;
+                } else if (map.Insert(key, static_cast<long>(key) * 10)) {
+                    ++net;
+                }
+            }
+        });
+        std::size_t present = 0;
+        for (int key = 0; key < 64; ++key)
+            present += map.Search(key) ? 1 : 0;
+        ok &= net.load() >= 0 && map.Size() == static_cast<std::size_t>(net.load()) && present == map.Size();
+        return report(ok, "same keys");
+    }
+
+    // Even keys are loaded first and never touched, writers insert and delete odd keys around them
+    // (splitting the leaves the scanners are walking) while scanners check the even keys in each scan
+    static bool runScansDuringSplits(int threads, int keysPerThread) {
+        Map map;
+        const int range = 2 * keysPerThread;
+        for (int key = 0; key < range; key += 2)
+            map.Insert(key, static_cast<long>(key) * 10);
+
+        std::atomic<int> writersLeft(threads / 2);
+        std::atomic<bool> ok(true);
+        runThreads(threads, [&](int thread) {
+            if (thread < threads / 2) {
+                for (int round = 0; round < 2; ++round) {
+                    for (int key = 1 + 2 * thread; key < range; key += threads)
+                        map.Insert(key, static_cast<long>(key) * 10);
+                    for (int key = 1 + 2 * thread; key < range; key += threads)
+                        map.Delete(key);
+                }
+                --writersLeft;
+                return;
+            }
+            do {
+                int previous = -1;
+                int nextEven = 0;
+                bool good = true;
+                map.Scan(0, range, [&](int key, long value) {
+                    good &= key > previous && value == static_cast<long>(key) * 10;
+                    previous = key;
+                    if (key % 2 == 0) {
+                        good &= key == nextEven;
+                        nextEven += 2;
+                    }
+                });
+                good &= nextEven == range;
+                if (!good)
+                    ok = false;
+            } while (writersLeft.load() > 0);
+        });
+
+        bool good = ok.load();
+        for (int key = 1; key < range; key += 2)
+            good &= !map.Search(key);
+        good &= map.Size() == static_cast<std::size_t>(keysPerThread);
+        return report(good, "scans during splits");
+    }
+
+    template <class Body>
+    static void runThreads(int threads, Body body) {
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (int thread = 0; thread < threads; ++thread)
+            workers.emplace_back(body, thread);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    static bool report(bool ok, const char* name) {
+        if (!ok)
+            std::cout << "ConcurrentBPlusTree " << name << ": FAILED" << std::endl;
+        return ok;
+    }
+};
+
+
+#endif // __CONCURRENT_BPLUS_TREE_TEST_H__
@@ -0,0 +1,173 @@
+#ifndef __LOGGED_BPLUS_TREE_TEST_H__
+#define __LOGGED_BPLUS_TREE_TEST_H__
+
+#include "../LoggedBPlusTree.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Recovery checks of LoggedBPlusTree. The crashes are made by hand: the log is cut or overwritten the
+// way a torn write leaves it, and the files of a checkpoint are put back into the state they have
+// between its steps. Every case reopens the tree and compares it with the keys committed before.
+// The files are <path>.wal, <path>.snapshot and <path>.snapshot.tmp, they are removed before and after.
+//
+//     bool ok = exampleLoggedBPlusTree::runRecoveryTest();
+class exampleLoggedBPlusTree {
+public:
+    static bool runRecoveryTest(const std::string& path = "loggedBPlusTreeTest") {
+        bool ok = true;
+        ok &= runTornTail(path);
+        ok &= runCorruptRecord(path);
+        ok &= runCheckpointBeforeRename(path);
+        ok &= runCheckpointBeforeLogReset(path);
+        ok &= runCheckpointDuringLogReset(path);
+        removeFiles(path);
+        std::cout << (ok ? "LoggedBPlusTree recovery: passed" : "LoggedBPlusTree recovery: FAILED") << std::endl;
+        return ok;
+    }
+
+private:
+    using Tree = VLIB::LoggedBPlusTree<int, 8, 8, std::allocator<int>, long>;
+
+    static constexpr long HeaderBytes = 16;       // Magic and generation of the log
+    static constexpr long RecordBytes = 8 + 13;   // Length and CRC, then operation, int key and long payload
+
+    // The last record lost half its bytes, the log ends with the record before it
+    static bool runTornTail(const std::string& path) {
+        removeFiles(path);
+        fill(path, 1, 100);
+        long size = fileSize(path + ".wal");
+        ::truncate((path + ".wal").c_str(), size - RecordBytes / 2);
+        bool ok = expect(path, 1, 99, "torn tail");
+        ok &= report(fileSize(path + ".wal") == size - RecordBytes, "torn tail cut off");
+        return ok;
+    }
+
+    // A record in the middle was overwritten, it and everything after it are dropped
+    static bool runCorruptRecord(const std::string& path) {
+        removeFiles(path);
+        fill(path, 1, 100);
+        overwriteByte(path + ".wal", HeaderBytes + 40 * RecordBytes + 12);
+        bool ok = expect(path, 1, 40, "corrupt record");
+        ok &= report(fileSize(path + ".wal") == HeaderBytes + 40 * RecordBytes, "corrupt record cut off");
+
+        // The log takes new records again after the cut
+        fill(path, 41, 60);
+        ok &= expect(path, 1, 60, "append after the cut");
+        return ok;
+    }
+
+    // Crash while the snapshot was written: a half written .tmp file, the old snapshot and log hold it all
+    static bool runCheckpointBeforeRename(const std::string& path) {
+        removeFiles(path);
+        fill(path, 1, 50);
+        {
+            Tree tree(path);
+            tree.Checkpoint();
+        }
+        fill(path, 51, 80);
+        std::ofstream(path + ".snapshot.tmp", std::ios::binary) << "half a snapshot";
+        return expect(path, 1, 80, "crash before the snapshot rename");
+    }
+
+    // Crash after the rename but before the log reset: the log of the previous generation is stale
+    static bool runCheckpointBeforeLogReset(const std::string& path) {
+        removeFiles(path);
+        fill(path, 1, 50);
+        std::vector<char> staleLog = readFile(path + ".wal");
+        {
+            Tree tree(path);
+            tree.Delete(10);
+            tree.Checkpoint();
+        }
+        writeFile(path + ".wal", staleLog);
+
+        // Replaying the stale log on the snapshot would bring 10 back
+        bool ok = expect(path, 1, 50, "crash before the log reset", 10);
+        fill(path, 51, 60);
+        ok &= expect(path, 1, 60, "append after the stale log", 10);
+        return ok;
+    }
+
+    // Crash while the new log header was written, the log is shorter than its header
+    static bool runCheckpointDuringLogReset(const std::string& path) {
+        removeFiles(path);
+        fill(path, 1, 50);
+        {
+            Tree tree(path);
+            tree.Checkpoint();
+        }
+        ::truncate((path + ".wal").c_str(), 3);
+        bool ok = expect(path, 1, 50, "crash during the log reset");
+        fill(path, 51, 70);
+        ok &= expect(path, 1, 70, "append after the log reset");
+        return ok;
+    }
+
+    // Inserts first .. last with the payload key * 10 and commits
+    static void fill(const std::string& path, int first, int last) {
+        Tree tree(path);
+        for (int key = first; key <= last; ++key)
+            tree.Insert(key, static_cast<long>(key) * 10);
+        tree.Commit();
+    }
+
+    // Reopens the tree, it has to hold first .. last (without missing) and nothing else
+    static bool expect(const std::string& path, int first, int last, const char* name, int missing = 0) {
+        Tree tree(path);
+        std::size_t count = 0;
+        bool ok = true;
+        for (int key = first; key <= last; ++key) {
+            if (key == missing) {
+                ok &= !tree.Search(key);
+                continue;
+            }
+            const long* value = tree.Find(key);
+            ok &= value != nullptr && *value == static_cast<long>(key) * 10;
+            ++count;
+        }
+        ok &= tree.Size() == count;
+        return report(ok, name);
+    }
+
+    static bool report(bool ok, const char* name) {
+        if (!ok)
+            std::cout << "LoggedBPlusTree " << name << ": FAILED" << std::endl;
+        return ok;
+    }
+
+    static long fileSize(const std::string& file) {
+        struct stat status;
+        return ::stat(file.c_str(), &status) == 0 ? static_cast<long>(status.st_size) : -1;
+    }
+
+    static std::vector<char> readFile(const std::string& file) {
+        std::ifstream in(file, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    static void writeFile(const std::string& file, const std::vector<char>& bytes) {
+        std::ofstream(file, std::ios::binary | std::ios::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    static void overwriteByte(const std::string& file, long offset) {
+        std::vector<char> bytes = readFile(file);
+        bytes[static_cast<std::size_t>(offset)] ^= 0x5A;
+        writeFile(file, bytes);
+    }
+
+    static void removeFiles(const std::string& path) {
+        std::remove((path + ".wal").c_str());
+        std::remove((path + ".snapshot").c_str());
+        std::remove((path + ".snapshot.tmp").c_str());
+    }
+};
+
+
+#endif // __LOGGED_BPLUS_TREE_TEST_H__
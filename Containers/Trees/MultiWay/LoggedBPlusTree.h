@@ -0,0 +1,314 @@
+#ifndef __LOGGED_BPLUS_TREE_H__
+#define __LOGGED_BPLUS_TREE_H__
+
+// An in-memory BPlusTree made durable by a write-ahead log, the template parameters are those of BPlusTree.
+
+// Insert and Delete change the tree and append a record to <path>.wal, Commit (or every groupRecords
+// records, see WriteAheadLog.h) makes the records durable with a single fsync. Checkpoint writes the
+// whole tree to <path>.snapshot and empties the log, so the log only holds what changed since.
+// Opening loads the snapshot with BulkLoad and replays the log on top: the tree comes back as of the
+// last Commit, whatever happened to the process after it.
+
+/*
+    Initialization:
+        LoggedBPlusTree<int, 64, 64> tree("index", 256);   // index.wal / index.snapshot, fsync every 256 records
+        tree.Insert(10);
+        tree.Delete(3);
+        tree.Commit();                                     // both changes survive a crash from here on
+        tree.Checkpoint();                                 // optional, bounds the log and the replay
+
+    Reads go straight to the tree: Search, Find (read only, a payload written through it would not be
+    logged), Begin / End, Range, ... and GetTree() for the rest.
+
+    T (and V) are logged as raw bytes so they have to be trivially copyable.
+*/
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../../../Storage/WriteAheadLog.h"
+#include "BPlusTree.h"
+
+
+namespace VLIB{ // VLIB
+
+// Layout of the snapshot header, the entries follow and a CRC-32 of everything before closes the file
+struct LoggedBPlusTreeSnapshotHeader {
+    char magic[8];
+    std::uint64_t generation; // Log generation the snapshot continues with
+    std::uint64_t count;
+    std::uint32_t keyBytes;
+    std::uint32_t valueBytes;
+};
+
+constexpr char LoggedBPlusTreeSnapshotMagic[8] = {'V', 'L', 'I', 'B', 'S', 'N', 'P', '\0'};
+
+template <typename T, int N, int M, class Alloc = std::allocator<T>, class V = void>
+class LoggedBPlusTree {
+    static_assert(std::is_trivially_copyable<T>::value, "keys are logged as raw bytes");
+    static_assert(std::is_void<V>::value || std::is_trivially_copyable<V>::value, "payloads are logged as raw bytes");
+
+public:
+    using Tree = BPlusTree<T, N, M, Alloc, V>;
+    using Iterator = typename Tree::Iterator;
+
+private: // Logged B+ Tree attributes
+    enum class Operation : unsigned char {Insert = 1, Delete = 2};
+
+    static constexpr bool HasPayload = !std::is_void<V>::value;
+    static constexpr std::size_t RecordBytes = 1 + sizeof(T) + BPlusTreePayloadBytes<V>; // Operation, key, payload of an insert
+
+    std::string snapshotPath;
+    Tree tree;
+    WriteAheadLog log;
+
+    void _Recover();
+    std::uint64_t _LoadSnapshot(); // Generation of the snapshot, 0 without one
+    void _WriteSnapshot(std::uint64_t generation);
+    void _Log(Operation operation, const T& key, const void* value);
+    void _Apply(const char* record, std::size_t bytes);
+
+public: // Logged B+ Tree constructor
+    // Opens the tree stored at path (path.wal and path.snapshot), or starts an empty one
+    explicit LoggedBPlusTree(const std::string& path, std::size_t groupRecords = 64, const Alloc& alloc = Alloc())
+        : snapshotPath(path + ".snapshot"), tree(alloc), log(path + ".wal", groupRecords) {_Recover();};
+
+    LoggedBPlusTree(const LoggedBPlusTree&) = delete;
+    LoggedBPlusTree& operator=(const LoggedBPlusTree&) = delete;
+
+    // Logged operations, durable once committed
+    bool Insert(const T& data); // Returns false when data is already in the tree, nothing is logged then
+    template <class U = V> // Not deduced, value converts to V and a key-only tree has no such overload
+    bool Insert(const T& data, const typename std::enable_if<!std::is_void<U>::value, U>::type& value);
+    bool Delete(const T& data);
+    void Commit(){log.Commit();}; // Makes every operation so far durable
+    void Checkpoint(); // Snapshot of the tree, the log starts over
+
+    // Reads
+    bool Search(const T& data) const {return tree.Search(data);};
+    template <class U = V>
+    typename std::enable_if<!std::is_void<U>::value, const U*>::type Find(const T& data) const {return const_cast<Tree&>(tree).Find(data);};
+    Iterator Begin() const {return tree.Begin();};
+    Iterator End() const {return tree.End();};
+    Iterator LowerBound(const T& data) const {return tree.LowerBound(data);};
+    Iterator UpperBound(const T& data) const {return tree.UpperBound(data);};
+    std::pair<Iterator, Iterator> Range(const T& low, const T& high) const {return tree.Range(low, high);};
+    Iterator begin() const {return tree.begin();};
+    Iterator end() const {return tree.end();};
+
+    // Getters
+    std::size_t Size() const {return tree.Size();};
+    bool IsEmpty() const {return tree.IsEmpty();};
+    const Tree& GetTree() const {return tree;};
+    WriteAheadLog& GetLog() {return log;};
+};
+
+//** Logged B+ Tree public operations **//
+
+template <typename T, int N, int M, class Alloc, class V>
+bool LoggedBPlusTree<T, N, M, Alloc, V>::Insert(const T& data) {
+    if (!tree.Insert(data))
+        return false;
+    if constexpr (HasPayload)
+        _Log(Operation::Insert, data, tree.Find(data)); // The value initialized payload
+    else
+        _Log(Operation::Insert, data, nullptr);
+    return true;
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+template <class U>
+bool LoggedBPlusTree<T, N, M, Alloc, V>::Insert(const T& data, const typename std::enable_if<!std::is_void<U>::value, U>::type& value) {
+    if (!tree.Insert(data, value))
+        return false;
+    _Log(Operation::Insert, data, &value);
+    return true;
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+bool LoggedBPlusTree<T, N, M, Alloc, V>::Delete(const T& data) {
+    if (!tree.Delete(data))
+        return false;
+    _Log(Operation::Delete, data, nullptr);
+    return true;
+}
+
+// The snapshot is written aside and renamed over the old one, a crash leaves either snapshot in place.
+// Until the log is reset it belongs to the previous generation, which the next open then discards.
+template <typename T, int N, int M, class Alloc, class V>
+void LoggedBPlusTree<T, N, M, Alloc, V>::Checkpoint() {
+    std::uint64_t generation = log.Generation() + 1;
+    _WriteSnapshot(generation);
+    log.Reset(generation);
+}
+
+//** Logged B+ Tree private helpers **//
+
+template <typename T, int N, int M, class Alloc, class V>
+void LoggedBPlusTree<T, N, M, Alloc, V>::_Recover() {
+    std::uint64_t generation = _LoadSnapshot();
+    if (log.Generation() < generation) {
+        log.Reset(generation); // Crash between a checkpoint's rename and its log reset, the snapshot has it all
+        return;
+    }
+    if (log.Generation() > generation)
+        throw std::runtime_error("write-ahead log is newer than the snapshot " + snapshotPath);
+    log.Replay([this](const char* record, std::size_t bytes) {_Apply(record, bytes);});
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+std::uint64_t LoggedBPlusTree<T, N, M, Alloc, V>::_LoadSnapshot() {
+    int fd = ::open(snapshotPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return 0;
+        throw LogFileError("cannot open", snapshotPath);
+    }
+    std::vector<char> bytes;
+    struct stat status;
+    bool ok = ::fstat(fd, &status) == 0;
+    if (ok) {
+        bytes.resize(static_cast<std::size_t>(status.st_size));
+        for (std::size_t done = 0; ok && done < bytes.size();) {
+            ssize_t got = ::pread(fd, bytes.data() + done, bytes.size() - done, static_cast<off_t>(done));
+            ok = got > 0 || (got < 0 && errno == EINTR);
+            done += got > 0 ? static_cast<std::size_t>(got) : 0;
+        }
+    }
+    if (!ok) {
+        std::system_error error = LogFileError("cannot read", snapshotPath);
+        ::close(fd);
+        throw error;
+    }
+    ::close(fd);
+
+    LoggedBPlusTreeSnapshotHeader header;
+    std::uint32_t crc;
+    if (bytes.size() < sizeof(header) + sizeof(crc))
+        throw std::runtime_error(snapshotPath + " is not a snapshot");
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    std::memcpy(&crc, bytes.data() + bytes.size() - sizeof(crc), sizeof(crc));
+    if (std::memcmp(header.magic, LoggedBPlusTreeSnapshotMagic, sizeof(LoggedBPlusTreeSnapshotMagic)) != 0)
+        throw std::runtime_error(snapshotPath + " is not a snapshot");
+    if (header.keyBytes != sizeof(T) || header.valueBytes != BPlusTreePayloadBytes<V>)
+        throw std::runtime_error(snapshotPath + " holds other key or payload types");
+    if (bytes.size() != sizeof(header) + header.count * (sizeof(T) + BPlusTreePayloadBytes<V>) + sizeof(crc)
+        || Crc32(bytes.data(), bytes.size() - sizeof(crc)) != crc)
+        throw std::runtime_error(snapshotPath + " is corrupt");
+
+    // Entries were written in key order, the tree is rebuilt bottom-up
+    const char* entry = bytes.data() + sizeof(header);
+    if constexpr (HasPayload) {
+        std::vector<std::pair<T, V>> entries(static_cast<std::size_t>(header.count));
+        for (auto& item : entries) {
+            std::memcpy(&item.first, entry, sizeof(T));
+            std::memcpy(&item.second, entry + sizeof(T), sizeof(V));
+            entry += sizeof(T) + sizeof(V);
+        }
+        tree.BulkLoad(entries.begin(), entries.end());
+    } else {
+        std::vector<T> entries(static_cast<std::size_t>(header.count));
+        for (auto& item : entries) {
+            std::memcpy(&item, entry, sizeof(T));
+            entry += sizeof(T);
+        }
+        tree.BulkLoad(entries.begin(), entries.end());
+    }
+    return header.generation;
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+void LoggedBPlusTree<T, N, M, Alloc, V>::_WriteSnapshot(std::uint64_t generation) {
+    LoggedBPlusTreeSnapshotHeader header;
+    std::memcpy(header.magic, LoggedBPlusTreeSnapshotMagic, sizeof(LoggedBPlusTreeSnapshotMagic));
+    header.generation = generation;
+    header.count = tree.Size();
+    header.keyBytes = sizeof(T);
+    header.valueBytes = static_cast<std::uint32_t>(BPlusTreePayloadBytes<V>);
+
+    std::vector<char> bytes(sizeof(header) + tree.Size() * (sizeof(T) + BPlusTreePayloadBytes<V>));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    char* entry = bytes.data() + sizeof(header);
+    for (Iterator it = tree.Begin(); it != tree.End(); ++it) {
+        std::memcpy(entry, &it.Key(), sizeof(T));
+        if constexpr (HasPayload)
+            std::memcpy(entry + sizeof(T), &it.Value(), sizeof(V));
+        entry += sizeof(T) + BPlusTreePayloadBytes<V>;
+    }
+    std::uint32_t crc = Crc32(bytes.data(), bytes.size());
+    const char* crcBytes = reinterpret_cast<const char*>(&crc);
+    bytes.insert(bytes.end(), crcBytes, crcBytes + sizeof(crc));
+
+    std::string temporaryPath = snapshotPath + ".tmp";
+    int fd = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw LogFileError("cannot open", temporaryPath);
+    try {
+        WriteFully(fd, bytes.data(), bytes.size(), temporaryPath);
+        if (::fsync(fd) != 0)
+            throw LogFileError("cannot sync", temporaryPath);
+    } catch (...) {
+        ::close(fd);
+        std::remove(temporaryPath.c_str());
+        throw;
+    }
+    ::close(fd);
+    if (std::rename(temporaryPath.c_str(), snapshotPath.c_str()) != 0)
+        throw LogFileError("cannot rename", temporaryPath);
+    SyncParentDirectory(snapshotPath);
+}
+
+template <typename T, int N, int M, class Alloc, class V>
+void LoggedBPlusTree<T, N, M, Alloc, V>::_Log(Operation operation, const T& key, const void* value) {
+    char record[RecordBytes];
+    record[0] = static_cast<char>(operation);
+    std::memcpy(record + 1, &key, sizeof(T));
+    std::size_t bytes = 1 + sizeof(T);
+    if (HasPayload && operation == Operation::Insert) {
+        std::memcpy(record + bytes, value, BPlusTreePayloadBytes<V>);
+        bytes += BPlusTreePayloadBytes<V>;
+    }
+    log.Append(record, bytes);
+}
+
+// Replays one logged operation, straight on the tree
+template <typename T, int N, int M, class Alloc, class V>
+void LoggedBPlusTree<T, N, M, Alloc, V>::_Apply(const char* record, std::size_t bytes) {
+    T key;
+    if (bytes < 1 + sizeof(T))
+        throw std::runtime_error("malformed write-ahead log record");
+    std::memcpy(&key, record + 1, sizeof(T));
+    switch (static_cast<Operation>(record[0])) {
+    case Operation::Insert:
+        if constexpr (HasPayload) {
+            if (bytes != RecordBytes)
+                throw std::runtime_error("malformed write-ahead log record");
+            V value;
+            std::memcpy(&value, record + 1 + sizeof(T), sizeof(V));
+            tree.Insert(key, value);
+        } else {
+            tree.Insert(key);
+        }
+        break;
+    case Operation::Delete:
+        tree.Delete(key);
+        break;
+    default:
+        throw std::runtime_error("malformed write-ahead log record");
+    }
+}
+
+} // namespace VLIB
+
+#endif // __LOGGED_BPLUS_TREE_H__
@@ -0,0 +1,44 @@
+#ifndef NODE_LAYOUT_H
+#define NODE_LAYOUT_H
+
+#include <cstddef>
+
+/*
+    Node sizing shared by BTree and BPlusTree.
+
+    The *Auto aliases (BTreeAuto, BPlusTreeAuto) take a target node size instead of a fan-out,
+    the fan-out is the largest one whose node still fits in that many bytes:
+
+        BTreeAuto<int, NodeBytesCacheLine> small;   // one 64 byte line per node
+        BPlusTreeAuto<double, NodeBytesPage> wide;   // 4 KiB nodes
+
+    Every node is aligned to a cache line, so a node of k lines touches exactly k lines. A node smaller
+    than a line is padded up to a full one, it never straddles two.
+*/
+
+namespace VLIB {
+
+constexpr std::size_t CacheLineBytes = 64;
+
+// Common node size targets
+constexpr std::size_t NodeBytesCacheLine = 64;   // L1 line
+constexpr std::size_t NodeBytesSmall = 256;      // A few lines, adjacent line prefetch friendly
+constexpr std::size_t NodeBytesPage = 4096;      // OS page
+
+// Alignment of a node whose members need naturalAlign. Small nodes get a whole line as well, at their
+// natural alignment a 56 byte node can start mid-line and span two.
+constexpr std::size_t NodeAlignment(std::size_t naturalAlign) {
+    return naturalAlign > CacheLineBytes ? naturalAlign : CacheLineBytes;
+}
+
+// First guess for a fan-out: how many perElement byte slots fit next to fixedBytes of node header.
+// fixedBytes leaves out padding so the guess is never too small, the trees then step it down
+// against the real sizeof of their nodes
+constexpr int NodeFanOutEstimate(std::size_t nodeBytes, long long fixedBytes, std::size_t perElement, int minimum) {
+    long long fit = (static_cast<long long>(nodeBytes) - fixedBytes) / static_cast<long long>(perElement);
+    return fit < minimum ? minimum : static_cast<int>(fit);
+}
+
+} // namespace VLIB
+
+#endif // NODE_LAYOUT_H
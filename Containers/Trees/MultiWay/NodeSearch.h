@@ -0,0 +1,320 @@
+#ifndef NODE_SEARCH_H
+#define NODE_SEARCH_H
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(VLIB_NODE_SEARCH_SCALAR)
+#define VLIB_NODE_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+    Key search inside a single sorted tree node, shared by BTree and BPlusTree.
+
+    NodeLowerBound(keys, count, key)  index of the first key not less than key
+    NodeUpperBound(keys, count, key)  index of the first key greater than key
+
+    Both take an optional comparator, NodeLowerBound(keys, count, key, comp), key may then be of any
+    type comp accepts (transparent comparators). std::less<T> and std::less<> keep the vector path,
+    any other comparator or key type gets the scalar binary search.
+
+    In a sorted node both indexes are just the number of keys below (or not above) key, so for
+    32 and 64 bit integers, float and double the keys are compared a whole register at a time
+    and the index is the popcount of the comparison mask. The instruction set (AVX2, SSE4.2 or
+    plain scalar) is picked once at runtime from what the CPU supports, the binary is built for
+    the baseline target. Other key types use a scalar binary search.
+
+    Define VLIB_NODE_SEARCH_SCALAR to always use the scalar search.
+*/
+
+namespace VLIB {
+
+enum class NodeSearchLevel { Scalar, SSE42, AVX2 };
+
+// Key types with a vectorized search
+template <class T>
+struct NodeSearchVectorizable : std::integral_constant<bool,
+    (std::is_integral<T>::value && !std::is_same<T, bool>::value && (sizeof(T) == 4 || sizeof(T) == 8)) ||
+    std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+inline NodeSearchLevel DetectNodeSearchLevel() {
+#ifdef VLIB_NODE_SEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return NodeSearchLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return NodeSearchLevel::SSE42;
+#endif
+    return NodeSearchLevel::Scalar;
+}
+
+// Level used by NodeLowerBound / NodeUpperBound, detected on first use
+inline NodeSearchLevel ActiveNodeSearchLevel() {
+    static const NodeSearchLevel level = DetectNodeSearchLevel();
+    return level;
+}
+
+namespace NodeSearchDetail {
+
+// Number of keys < key (or <= key with OrEqual), binary search
+template <bool OrEqual, class T>
+int CountScalar(const T* keys, int count, const T& key) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (OrEqual ? !(key < keys[mid]) : keys[mid] < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// Same with a comparator, key can be any type comp takes next to T
+template <bool OrEqual, class T, class K, class Compare>
+int CountScalar(const T* keys, int count, const K& key, const Compare& comp) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (OrEqual ? !comp(key, keys[mid]) : comp(keys[mid], key))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+#ifdef VLIB_NODE_SEARCH_X86
+
+// The kernels stop at the first register that is not entirely below key, the keys are sorted.
+// Unsigned integers are compared as signed after flipping the sign bit (bias).
+
+template <bool OrEqual, class U>
+__attribute__((target("avx2"))) int Count32Avx2(const U* keys, int count, U key, U bias) {
+    const __m256i biased = _mm256_set1_epi32(static_cast<int>(bias));
+    const __m256i needle = _mm256_set1_epi32(static_cast<int>(key ^ bias));
+    int result = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), biased);
+        __m256i below = OrEqual ? _mm256_andnot_si256(_mm256_cmpgt_epi32(v, needle), _mm256_set1_epi32(-1))
+                                : _mm256_cmpgt_epi32(needle, v);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(below));
+        result += __builtin_popcount(mask);
+        if (mask != 0xFF)
+            return result;
+    }
+    for (; i < count; ++i) {
+        typename std::make_signed<U>::type k = keys[i] ^ bias, n = key ^ bias;
+        if (OrEqual ? k > n : k >= n)
+            break;
+        ++result;
+    }
+    return result;
+}
+
+template <bool OrEqual, class U>
+__attribute__((target("sse4.2"))) int Count32Sse(const U* keys, int count, U key, U bias) {
+    const __m128i biased = _mm_set1_epi32(static_cast<int>(bias));
+    const __m128i needle = _mm_set1_epi32(static_cast<int>(key ^ bias));
+    int result = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), biased);
+        __m128i below = OrEqual ? _mm_andnot_si128(_mm_cmpgt_epi32(v, needle), _mm_set1_epi32(-1))
+                                : _mm_cmpgt_epi32(needle, v);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(below));
+        result += __builtin_popcount(mask);
+        if (mask != 0xF)
+            return result;
+    }
+    for (; i < count; ++i) {
+        typename std::make_signed<U>::type k = keys[i] ^ bias, n = key ^ bias;
+        if (OrEqual ? k > n : k >= n)
+            break;
+        ++result;
+    }
+    return result;
+}
+
+template <bool OrEqual, class U>
+__attribute__((target("avx2"))) int Count64Avx2(const U* keys, int count, U key, U bias) {
+    const __m256i biased = _mm256_set1_epi64x(static_cast<long long>(bias));
+    const __m256i needle = _mm256_set1_epi64x(static_cast<long long>(key ^ bias));
+    int result = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), biased);
+        __m256i below = OrEqual ? _mm256_andnot_si256(_mm256_cmpgt_epi64(v, needle), _mm256_set1_epi64x(-1))
+                                : _mm256_cmpgt_epi64(needle, v);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(below));
+        result += __builtin_popcount(mask);
+        if (mask != 0xF)
+            return result;
+    }
+    for (; i < count; ++i) {
+        typename std::make_signed<U>::type k = keys[i] ^ bias, n = key ^ bias;
+        if (OrEqual ? k > n : k >= n)
+            break;
+        ++result;
+    }
+    return result;
+}
+
+template <bool OrEqual, class U>
+__attribute__((target("sse4.2"))) int Count64Sse(const U* keys, int count, U key, U bias) {
+    const __m128i biased = _mm_set1_epi64x(static_cast<long long>(bias));
+    const __m128i needle = _mm_set1_epi64x(static_cast<long long>(key ^ bias));
+    int result = 0, i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), biased);
+        __m128i below = OrEqual ? _mm_andnot_si128(_mm_cmpgt_epi64(v, needle), _mm_set1_epi64x(-1))
+                                : _mm_cmpgt_epi64(needle, v);
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(below));
+        result += __builtin_popcount(mask);
+        if (mask != 0x3)
+            return result;
+    }
+    for (; i < count; ++i) {
+        typename std::make_signed<U>::type k = keys[i] ^ bias, n = key ^ bias;
+        if (OrEqual ? k > n : k >= n)
+            break;
+        ++result;
+    }
+    return result;
+}
+
+template <bool OrEqual>
+__attribute__((target("avx2"))) int CountFloatAvx2(const float* keys, int count, float key) {
+    const __m256 needle = _mm256_set1_ps(key);
+    int result = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_loadu_ps(keys + i);
+        int mask = _mm256_movemask_ps(OrEqual ? _mm256_cmp_ps(v, needle, _CMP_LE_OQ) : _mm256_cmp_ps(v, needle, _CMP_LT_OQ));
+        result += __builtin_popcount(mask);
+        if (mask != 0xFF)
+            return result;
+    }
+    for (; i < count && (OrEqual ? keys[i] <= key : keys[i] < key); ++i)
+        ++result;
+    return result;
+}
+
+template <bool OrEqual>
+__attribute__((target("sse4.2"))) int CountFloatSse(const float* keys, int count, float key) {
+    const __m128 needle = _mm_set1_ps(key);
+    int result = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_loadu_ps(keys + i);
+        int mask = _mm_movemask_ps(OrEqual ? _mm_cmple_ps(v, needle) : _mm_cmplt_ps(v, needle));
+        result += __builtin_popcount(mask);
+        if (mask != 0xF)
+            return result;
+    }
+    for (; i < count && (OrEqual ? keys[i] <= key : keys[i] < key); ++i)
+        ++result;
+    return result;
+}
+
+template <bool OrEqual>
+__attribute__((target("avx2"))) int CountDoubleAvx2(const double* keys, int count, double key) {
+    const __m256d needle = _mm256_set1_pd(key);
+    int result = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_loadu_pd(keys + i);
+        int mask = _mm256_movemask_pd(OrEqual ? _mm256_cmp_pd(v, needle, _CMP_LE_OQ) : _mm256_cmp_pd(v, needle, _CMP_LT_OQ));
+        result += __builtin_popcount(mask);
+        if (mask != 0xF)
+            return result;
+    }
+    for (; i < count && (OrEqual ? keys[i] <= key : keys[i] < key); ++i)
+        ++result;
+    return result;
+}
+
+template <bool OrEqual>
+__attribute__((target("sse4.2"))) int CountDoubleSse(const double* keys, int count, double key) {
+    const __m128d needle = _mm_set1_pd(key);
+    int result = 0, i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d v = _mm_loadu_pd(keys + i);
+        int mask = _mm_movemask_pd(OrEqual ? _mm_cmple_pd(v, needle) : _mm_cmplt_pd(v, needle));
+        result += __builtin_popcount(mask);
+        if (mask != 0x3)
+            return result;
+    }
+    for (; i < count && (OrEqual ? keys[i] <= key : keys[i] < key); ++i)
+        ++result;
+    return result;
+}
+
+#endif // VLIB_NODE_SEARCH_X86
+
+// Number of keys < key (or <= key with OrEqual) using the widest instruction set available
+template <bool OrEqual, class T>
+int Count(const T* keys, int count, const T& key) {
+#ifdef VLIB_NODE_SEARCH_X86
+    if constexpr (NodeSearchVectorizable<T>::value) {
+        NodeSearchLevel level = ActiveNodeSearchLevel();
+        if (level != NodeSearchLevel::Scalar) {
+            bool avx2 = level == NodeSearchLevel::AVX2;
+            if constexpr (std::is_same<T, float>::value) {
+                return avx2 ? CountFloatAvx2<OrEqual>(keys, count, key) : CountFloatSse<OrEqual>(keys, count, key);
+            } else if constexpr (std::is_same<T, double>::value) {
+                return avx2 ? CountDoubleAvx2<OrEqual>(keys, count, key) : CountDoubleSse<OrEqual>(keys, count, key);
+            } else {
+                // Same width unsigned view of the keys, signed and unsigned variants of a type may alias
+                using U = typename std::make_unsigned<T>::type;
+                const U bias = std::is_signed<T>::value ? U(0) : U(U(1) << (sizeof(U) * 8 - 1));
+                const U* raw = reinterpret_cast<const U*>(keys);
+                U needle = static_cast<U>(key);
+                if constexpr (sizeof(T) == 4)
+                    return avx2 ? Count32Avx2<OrEqual>(raw, count, needle, bias) : Count32Sse<OrEqual>(raw, count, needle, bias);
+                else
+                    return avx2 ? Count64Avx2<OrEqual>(raw, count, needle, bias) : Count64Sse<OrEqual>(raw, count, needle, bias);
+            }
+        }
+    }
+#endif
+    return CountScalar<OrEqual>(keys, count, key);
+}
+
+// Comparators that order T like operator<, the vector kernels apply to them
+template <class T, class Compare>
+struct NaturalOrder : std::integral_constant<bool, std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value> {};
+
+template <bool OrEqual, class T, class K, class Compare>
+int Count(const T* keys, int count, const K& key, const Compare& comp) {
+    if constexpr (NaturalOrder<T, Compare>::value && std::is_same<K, T>::value)
+        return Count<OrEqual>(keys, count, key);
+    else
+        return CountScalar<OrEqual>(keys, count, key, comp);
+}
+
+} // namespace NodeSearchDetail
+
+// Index of the first key that is not less than key, count if there is none
+template <class T>
+int NodeLowerBound(const T* keys, int count, const T& key) {
+    return NodeSearchDetail::Count<false>(keys, count, key);
+}
+
+// Index of the first key that is greater than key, count if there is none
+template <class T>
+int NodeUpperBound(const T* keys, int count, const T& key) {
+    return NodeSearchDetail::Count<true>(keys, count, key);
+}
+
+// Same, ordered by comp
+template <class T, class K, class Compare>
+int NodeLowerBound(const T* keys, int count, const K& key, const Compare& comp) {
+    return NodeSearchDetail::Count<false>(keys, count, key, comp);
+}
+
+template <class T, class K, class Compare>
+int NodeUpperBound(const T* keys, int count, const K& key, const Compare& comp) {
+    return NodeSearchDetail::Count<true>(keys, count, key, comp);
+}
+
+} // namespace VLIB
+
+#endif // NODE_SEARCH_H
@@ -0,0 +1,697 @@
+#ifndef __PAGED_BPLUS_TREE_H__
+#define __PAGED_BPLUS_TREE_H__
+
+// A B+ tree whose nodes are fixed-size pages of a file, it outlives the process and opens without a rebuild.
+// Here template is used as T(key type), V(optional payload, void gives a set), Store(page store, see
+// Storage/PageFile.h) and PageBytes(page size).
+
+// Nodes are the page layouts below, children are named by PageId instead of pointers. The fan-out and
+// leaf capacity are the largest that fit in a page. Every page is reached through Store::Pin / Unpin,
+// a lookup pins one page per level and a modification pins at most the path from the root plus a few
+// siblings. The root id, size and height live in the user part of the file header.
+
+/*
+    Initialization:
+        PagedBPlusTree<int> tree("index.db");                      // opens or creates the file
+        tree.Insert(10);
+
+        PagedBPlusTree<std::uint64_t, Record> map("records.db");   // key -> payload
+        map.Insert(7, record);
+        Record found;
+        if (map.Find(7, found)) ...
+
+        map.Scan(10, 20, [](std::uint64_t key, const Record& value) { ... });  // every key in [10, 20]
+        map.Sync();                                                // durable up to here
+
+    The default store maps the file and leaves caching to the OS, a BufferPool caps the memory instead:
+        PagedBPlusTree<int, void, BufferPool> capped("index.db", 256 << 20);  // at most 256 MiB of pages
+
+    T and V are stored as raw bytes so they have to be trivially copyable, T also comparable with
+    operator<. A file can only be reopened with the same T, V and PageBytes, anything else throws.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "../../../Storage/BufferPool.h"
+#include "../../../Storage/PageFile.h"
+#include "BPlusTree.h"
+#include "NodeLayout.h"
+#include "NodeSearch.h"
+
+
+namespace VLIB{ // VLIB
+
+//**** Pages ****//
+
+// Common header of internal and leaf pages
+struct PagedBPlusTreeNodeHeader {
+    std::uint32_t isLeaf;
+    std::int32_t count; // Number of keys held by the node
+    PageId next;        // Leaf chain in key order, InvalidPageId at the ends
+    PageId prev;
+};
+
+// Internal page, children[i] holds the keys < keys[i] and children[i + 1] the keys >= keys[i]
+template <typename T, int N>
+struct PagedBPlusTreeInternalPage {
+    PagedBPlusTreeNodeHeader header;
+    T keys[N - 1];
+    PageId children[N];
+};
+
+// Leaf page, keys are sorted and unique, payload.values[i] belongs to keys[i]
+template <typename T, class V, int M>
+struct PagedBPlusTreeLeafPage {
+    PagedBPlusTreeNodeHeader header;
+    T keys[M];
+    BPlusTreeLeafPayload<V, M> payload;
+};
+
+// Largest internal fan-out / leaf capacity whose page stays within PageBytes
+template <typename T, std::size_t PageBytes,
+          int N = NodeFanOutEstimate(PageBytes, static_cast<long long>(sizeof(PagedBPlusTreeNodeHeader)) - static_cast<long long>(sizeof(T)),
+                                     sizeof(T) + sizeof(PageId), 3)>
+struct PagedBPlusTreeFanOut : std::conditional<(N <= 3 || sizeof(PagedBPlusTreeInternalPage<T, N>) <= PageBytes),
+                                               std::integral_constant<int, N>, PagedBPlusTreeFanOut<T, PageBytes, N - 1>>::type {};
+
+template <typename T, class V, std::size_t PageBytes,
+          int M = NodeFanOutEstimate(PageBytes, static_cast<long long>(sizeof(PagedBPlusTreeNodeHeader)), sizeof(T) + BPlusTreePayloadBytes<V>, 2)>
+struct PagedBPlusTreeLeafCapacity : std::conditional<(M <= 2 || sizeof(PagedBPlusTreeLeafPage<T, V, M>) <= PageBytes),
+                                                     std::integral_constant<int, M>, PagedBPlusTreeLeafCapacity<T, V, PageBytes, M - 1>>::type {};
+
+// Tree state kept in the user part of the file header
+struct PagedBPlusTreeHeader {
+    char magic[8];
+    std::uint32_t keyBytes;
+    std::uint32_t valueBytes;
+    PageId root;
+    std::uint32_t height; // Levels including the leaves, 0 for an empty tree
+    std::uint64_t size;
+};
+
+constexpr char PagedBPlusTreeMagic[8] = {'V', 'L', 'I', 'B', 'B', 'P', 'T', '\0'};
+
+//**** Paged B+ Tree ****//
+template <typename T, class V = void, class Store = MmapPageFile, std::size_t PageBytes = 4096>
+class PagedBPlusTree {
+    static_assert(std::is_trivially_copyable<T>::value, "keys are stored as raw bytes");
+    static_assert(std::is_void<V>::value || std::is_trivially_copyable<V>::value, "payloads are stored as raw bytes");
+    static_assert(sizeof(PagedBPlusTreeHeader) <= UserHeaderBytes, "tree header has to fit in the file header");
+
+public:
+    static constexpr int N = PagedBPlusTreeFanOut<T, PageBytes>::value;          // Max children of an internal page
+    static constexpr int M = PagedBPlusTreeLeafCapacity<T, V, PageBytes>::value; // Max keys of a leaf page
+    using InternalPage = PagedBPlusTreeInternalPage<T, N>;
+    using LeafPage = PagedBPlusTreeLeafPage<T, V, M>;
+
+    static_assert(N >= 3 && sizeof(InternalPage) <= PageBytes, "page too small for 3 children");
+    static_assert(M >= 2 && sizeof(LeafPage) <= PageBytes, "page too small for 2 keys");
+
+private: // Pinned pages
+    // A pinned page, unpinned when the handle goes away. Edit* marks the page dirty.
+    class PageHandle {
+    public:
+        PageHandle() : store(nullptr), id(InvalidPageId), data(nullptr), dirty(false) {}
+        PageHandle(Store& store, PageId id) : store(&store), id(id), data(store.Pin(id)), dirty(false) {}
+        PageHandle(PageHandle&& other) noexcept : store(other.store), id(other.id), data(other.data), dirty(other.dirty) {other.store = nullptr;}
+        PageHandle& operator=(PageHandle&& other) noexcept {
+            if (this != &other) {
+                Release();
+                store = other.store; id = other.id; data = other.data; dirty = other.dirty;
+                other.store = nullptr;
+            }
+            return *this;
+        }
+        ~PageHandle() {Release();}
+
+        void Release() {
+            if (store != nullptr)
+                store->Unpin(id, dirty);
+            store = nullptr;
+        }
+
+        PageId Id() const {return id;}
+        bool IsLeaf() const {return Head()->isLeaf != 0;}
+        const PagedBPlusTreeNodeHeader* Head() const {return reinterpret_cast<const PagedBPlusTreeNodeHeader*>(data);}
+        const InternalPage* Internal() const {return reinterpret_cast<const InternalPage*>(data);}
+        const LeafPage* Leaf() const {return reinterpret_cast<const LeafPage*>(data);}
+        InternalPage* EditInternal() {dirty = true; return reinterpret_cast<InternalPage*>(data);}
+        LeafPage* EditLeaf() {dirty = true; return reinterpret_cast<LeafPage*>(data);}
+
+    private:
+        Store* store;
+        PageId id;
+        char* data;
+        bool dirty;
+    };
+
+private: // Paged B+ Tree attributes
+    static constexpr bool HasPayload = !std::is_void<V>::value;
+    static constexpr int MaxDepth = 32;                  // N >= 3 and 32 bit page ids
+    static constexpr int MinInternalKeys = (N - 1) / 2;  // Internal pages other than the root keep at least this many keys
+    static constexpr int MinExternalKeys = M / 2;        // Same for leaf pages
+
+    mutable Store store;
+    PagedBPlusTreeHeader* meta; // Inside the store's file header
+
+    void _Open();
+    PageHandle _Pin(PageId id) const {return PageHandle(store, id);};
+    PageHandle _NewPage(bool leaf);
+    void _FreePage(PageHandle& page); // Unpins and frees
+    PageHandle _FindLeaf(const T& data) const; // Empty handle for an empty tree
+    int _FindInLeaf(const LeafPage* leaf, const T& data) const; // Index of data in leaf, -1 if missing
+    template <class... Args>
+    bool _Insert(const T& data, Args&&... value);
+    bool _Delete(const T& data);
+    T _SplitInternal(InternalPage* node, int index, const T& key, PageId child, InternalPage* sibling);
+    void _RebalanceExternal(PageHandle& node, PageHandle& parent, int index);
+    void _RebalanceInternal(PageHandle& node, PageHandle& parent, int index);
+    void _MergeInternal(PageHandle& left, PageHandle& right, InternalPage* parent, int separatorIndex);
+    void _RemoveFromInternal(InternalPage* node, int keyIndex); // Removes keys[keyIndex] and children[keyIndex + 1]
+    template <class Fn>
+    void _ScanFrom(PageHandle leaf, int index, const T* high, Fn& fn) const; // Visits keys up to *high (everything when null)
+    void _Print(PageId id, int depth) const;
+    void _Clear(PageId id);
+
+    template <class E>
+    static void _MoveRange(const E* first, int count, E* dest) {std::memmove(dest, first, count * sizeof(E));}; // Ranges may overlap
+    static void _MoveEntries(const LeafPage* from, int fromIndex, int count, LeafPage* to, int toIndex);
+
+public: // Paged B+ Tree constructor & destructor
+    // Opens or creates the tree at path, extra arguments go to the Store constructor after the page size
+    template <class... StoreArgs>
+    explicit PagedBPlusTree(const std::string& path, StoreArgs&&... storeArgs)
+        : store(path, PageBytes, std::forward<StoreArgs>(storeArgs)...), meta(nullptr) {_Open();};
+
+    PagedBPlusTree(const PagedBPlusTree&) = delete;
+    PagedBPlusTree& operator=(const PagedBPlusTree&) = delete;
+
+    // Public Paged B+ Tree operations
+    bool Insert(const T& data){return _Insert(data);}; // Returns false when data is already in the tree, the payload is zeroed
+    template <class U = V> // Not deduced, value converts to V and a key-only tree has no such overload
+    bool Insert(const T& data, const typename std::enable_if<!std::is_void<U>::value, U>::type& value){return _Insert(data, value);};
+    bool Delete(const T& data){return _Delete(data);};
+    bool Search(const T& data) const;
+    template <class U = V>
+    typename std::enable_if<!std::is_void<U>::value, bool>::type Find(const T& data, U& value) const; // Copies the payload out, false if missing
+    template <class Fn>
+    void Scan(const T& low, const T& high, Fn fn) const; // fn(key) or fn(key, value) for every key in [low, high], in order
+    template <class Fn>
+    void ForEach(Fn fn) const; // Same for the whole tree
+    void Print() const {_Print(meta->root, 0);};
+    void Clear();
+    void Sync(){store.Sync();}; // Makes every change so far durable
+
+    // Getters
+    std::size_t Size() const {return static_cast<std::size_t>(meta->size);};
+    bool IsEmpty() const {return meta->size == 0;};
+    int Height() const {return static_cast<int>(meta->height);};
+    PageId GetRoot() const {return meta->root;};
+    Store& GetStore() {return store;};
+};
+
+//** Paged B+ Tree public operations **//
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+bool PagedBPlusTree<T, V, Store, PageBytes>::Search(const T& data) const {
+    PageHandle leaf = _FindLeaf(data);
+    return leaf.Id() != InvalidPageId && _FindInLeaf(leaf.Leaf(), data) >= 0;
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+template <class U>
+typename std::enable_if<!std::is_void<U>::value, bool>::type PagedBPlusTree<T, V, Store, PageBytes>::Find(const T& data, U& value) const {
+    PageHandle leaf = _FindLeaf(data);
+    if (leaf.Id() == InvalidPageId)
+        return false;
+    int index = _FindInLeaf(leaf.Leaf(), data);
+    if (index < 0)
+        return false;
+    value = leaf.Leaf()->payload.values[index];
+    return true;
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+template <class Fn>
+void PagedBPlusTree<T, V, Store, PageBytes>::Scan(const T& low, const T& high, Fn fn) const {
+    if (high < low)
+        return;
+    PageHandle leaf = _FindLeaf(low);
+    if (leaf.Id() == InvalidPageId)
+        return;
+    int index = NodeLowerBound(leaf.Leaf()->keys, leaf.Head()->count, low);
+    _ScanFrom(std::move(leaf), index, &high, fn);
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+template <class Fn>
+void PagedBPlusTree<T, V, Store, PageBytes>::ForEach(Fn fn) const {
+    if (meta->root == InvalidPageId)
+        return;
+    PageHandle page = _Pin(meta->root);
+    while (!page.IsLeaf())
+        page = _Pin(page.Internal()->children[0]);
+    _ScanFrom(std::move(page), 0, nullptr, fn);
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::Clear() {
+    _Clear(meta->root);
+    meta->root = InvalidPageId;
+    meta->height = 0;
+    meta->size = 0;
+}
+
+//** Paged B+ Tree private helpers **//
+
+// Takes over the tree stored in the file, or starts an empty one in a new file
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_Open() {
+    if (store.PageSize() != PageBytes)
+        throw std::invalid_argument("page store and tree disagree on the page size");
+    meta = reinterpret_cast<PagedBPlusTreeHeader*>(store.UserHeader());
+    if (store.IsNew()) {
+        std::memset(meta, 0, sizeof(PagedBPlusTreeHeader));
+        std::memcpy(meta->magic, PagedBPlusTreeMagic, sizeof(PagedBPlusTreeMagic));
+        meta->keyBytes = sizeof(T);
+        meta->valueBytes = static_cast<std::uint32_t>(BPlusTreePayloadBytes<V>);
+        meta->root = InvalidPageId;
+        return;
+    }
+    if (std::memcmp(meta->magic, PagedBPlusTreeMagic, sizeof(PagedBPlusTreeMagic)) != 0)
+        throw std::runtime_error("page file does not hold a B+ tree");
+    if (meta->keyBytes != sizeof(T) || meta->valueBytes != BPlusTreePayloadBytes<V>)
+        throw std::runtime_error("page file holds a B+ tree of other key or payload types");
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+typename PagedBPlusTree<T, V, Store, PageBytes>::PageHandle PagedBPlusTree<T, V, Store, PageBytes>::_NewPage(bool leaf) {
+    PageHandle page = _Pin(store.Allocate());
+    PagedBPlusTreeNodeHeader* header = &page.EditLeaf()->header;
+    header->isLeaf = leaf ? 1 : 0;
+    header->count = 0;
+    header->next = InvalidPageId;
+    header->prev = InvalidPageId;
+    return page;
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_FreePage(PageHandle& page) {
+    PageId id = page.Id();
+    page.Release();
+    store.Free(id);
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+typename PagedBPlusTree<T, V, Store, PageBytes>::PageHandle PagedBPlusTree<T, V, Store, PageBytes>::_FindLeaf(const T& data) const {
+    if (meta->root == InvalidPageId)
+        return PageHandle();
+    // Follow the routing keys down to the leaf that would hold data, one page pinned at a time
+    PageHandle page = _Pin(meta->root);
+    while (!page.IsLeaf()) {
+        const InternalPage* internalPage = page.Internal();
+        page = _Pin(internalPage->children[NodeUpperBound(internalPage->keys, internalPage->header.count, data)]);
+    }
+    return page;
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+int PagedBPlusTree<T, V, Store, PageBytes>::_FindInLeaf(const LeafPage* leaf, const T& data) const {
+    int index = NodeLowerBound(leaf->keys, leaf->header.count, data);
+    return index < leaf->header.count && !(data < leaf->keys[index]) ? index : -1;
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+template <class Fn>
+void PagedBPlusTree<T, V, Store, PageBytes>::_ScanFrom(PageHandle leaf, int index, const T* high, Fn& fn) const {
+    while (true) {
+        const LeafPage* page = leaf.Leaf();
+        for (; index < page->header.count; ++index) {
+            if (high != nullptr && *high < page->keys[index])
+                return;
+            if constexpr (HasPayload)
+                fn(page->keys[index], page->payload.values[index]);
+            else
+                fn(page->keys[index]);
+        }
+        if (page->header.next == InvalidPageId)
+            return;
+        leaf = _Pin(page->header.next);
+        index = 0;
+    }
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_MoveEntries(const LeafPage* from, int fromIndex, int count, LeafPage* to, int toIndex) {
+    _MoveRange(from->keys + fromIndex, count, to->keys + toIndex);
+    if constexpr (HasPayload)
+        _MoveRange(from->payload.values + fromIndex, count, to->payload.values + toIndex);
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+template <class... Args>
+bool PagedBPlusTree<T, V, Store, PageBytes>::_Insert(const T& data, Args&&... value) {
+    // Check if the tree is empty
+    if (meta->root == InvalidPageId) {
+        meta->root = _NewPage(true).Id();
+        meta->height = 1;
+    }
+
+    // Walk down to the leaf, keeping the path pinned for the splits
+    PageHandle path[MaxDepth];
+    int pathIndex[MaxDepth];
+    int depth = 0;
+    PageHandle current = _Pin(meta->root);
+    while (!current.IsLeaf()) {
+        const InternalPage* internalPage = current.Internal();
+        int childIndex = NodeUpperBound(internalPage->keys, internalPage->header.count, data);
+        PageId child = internalPage->children[childIndex];
+        path[depth] = std::move(current);
+        pathIndex[depth] = childIndex;
+        ++depth;
+        current = _Pin(child);
+    }
+
+    const LeafPage* found = current.Leaf();
+    int position = NodeLowerBound(found->keys, found->header.count, data);
+    if (position < found->header.count && !(data < found->keys[position]))
+        return false; // Already in the tree
+
+    // A full leaf is split first, the upper half moves to a new right sibling
+    LeafPage* leaf = current.EditLeaf();
+    LeafPage* target = leaf;
+    PageHandle siblingPage;
+    if (leaf->header.count == M) {
+        siblingPage = _NewPage(true);
+        LeafPage* sibling = siblingPage.EditLeaf();
+        int leftCount = (M + 2) / 2; // Keys left of the split once data is in
+        if (position < leftCount) {
+            _MoveEntries(leaf, leftCount - 1, M - leftCount + 1, sibling, 0);
+            leaf->header.count = leftCount - 1;
+            sibling->header.count = M - leftCount + 1;
+        } else {
+            _MoveEntries(leaf, leftCount, M - leftCount, sibling, 0);
+            leaf->header.count = leftCount;
+            sibling->header.count = M - leftCount;
+            target = sibling;
+            position -= leftCount;
+        }
+        sibling->header.next = leaf->header.next;
+        sibling->header.prev = current.Id();
+        if (leaf->header.next != InvalidPageId)
+            _Pin(leaf->header.next).EditLeaf()->header.prev = siblingPage.Id();
+        leaf->header.next = siblingPage.Id();
+    }
+
+    _MoveEntries(target, position, target->header.count - position, target, position + 1);
+    target->keys[position] = data;
+    if constexpr (HasPayload) {
+        if constexpr (sizeof...(Args) > 0)
+            target->payload.values[position] = V(std::forward<Args>(value)...);
+        else
+            std::memset(&target->payload.values[position], 0, sizeof(V));
+    }
+    ++target->header.count;
+    ++meta->size;
+
+    if (siblingPage.Id() == InvalidPageId)
+        return true;
+
+    // Hand the separator up, splitting full internal pages on the way
+    T separator = siblingPage.Leaf()->keys[0];
+    PageId newChild = siblingPage.Id();
+    current.Release();
+    siblingPage.Release();
+    while (depth > 0) {
+        --depth;
+        InternalPage* parent = path[depth].EditInternal();
+        int childIndex = pathIndex[depth];
+        if (parent->header.count < N - 1) {
+            _MoveRange(parent->keys + childIndex, parent->header.count - childIndex, parent->keys + childIndex + 1);
+            _MoveRange(parent->children + childIndex + 1, parent->header.count - childIndex, parent->children + childIndex + 2);
+            parent->keys[childIndex] = separator;
+            parent->children[childIndex + 1] = newChild;
+            ++parent->header.count;
+            return true;
+        }
+        PageHandle newSibling = _NewPage(false);
+        separator = _SplitInternal(parent, childIndex, separator, newChild, newSibling.EditInternal());
+        newChild = newSibling.Id();
+    }
+
+    // The root was split, the tree grows one level
+    PageHandle newRoot = _NewPage(false);
+    InternalPage* rootPage = newRoot.EditInternal();
+    rootPage->keys[0] = separator;
+    rootPage->children[0] = meta->root;
+    rootPage->children[1] = newChild;
+    rootPage->header.count = 1;
+    meta->root = newRoot.Id();
+    ++meta->height;
+    return true;
+}
+
+// Splits the full page while inserting key/child at index, the upper half goes to sibling.
+// Returns the middle key, which moves up to the parent.
+template <typename T, class V, class Store, std::size_t PageBytes>
+T PagedBPlusTree<T, V, Store, PageBytes>::_SplitInternal(InternalPage* node, int index, const T& key, PageId child, InternalPage* sibling) {
+    int middle = N / 2; // Keys left in node, the one after them moves up
+    T separator;
+    if (index < middle) {
+        // key lands in node, its last key moves up
+        separator = node->keys[middle - 1];
+        _MoveRange(node->keys + middle, N - 1 - middle, sibling->keys);
+        _MoveRange(node->children + middle, N - middle, sibling->children);
+        _MoveRange(node->keys + index, middle - 1 - index, node->keys + index + 1);
+        _MoveRange(node->children + index + 1, middle - 1 - index, node->children + index + 2);
+        node->keys[index] = key;
+        node->children[index + 1] = child;
+    } else if (index == middle) {
+        // key itself moves up, child becomes the first child of sibling
+        separator = key;
+        _MoveRange(node->keys + middle, N - 1 - middle, sibling->keys);
+        _MoveRange(node->children + middle + 1, N - 1 - middle, sibling->children + 1);
+        sibling->children[0] = child;
+    } else {
+        // key lands in sibling, node's key at middle moves up
+        separator = node->keys[middle];
+        int shifted = index - middle - 1; // Keys of node that land in sibling before key
+        _MoveRange(node->keys + middle + 1, shifted, sibling->keys);
+        sibling->keys[shifted] = key;
+        _MoveRange(node->keys + index, N - 1 - index, sibling->keys + shifted + 1);
+        _MoveRange(node->children + middle + 1, shifted + 1, sibling->children);
+        sibling->children[shifted + 1] = child;
+        _MoveRange(node->children + index + 1, N - 1 - index, sibling->children + shifted + 2);
+    }
+    node->header.count = middle;
+    sibling->header.count = N - 1 - middle;
+    return separator;
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+bool PagedBPlusTree<T, V, Store, PageBytes>::_Delete(const T& data) {
+    if (meta->root == InvalidPageId)
+        return false;
+
+    PageHandle path[MaxDepth];
+    int pathIndex[MaxDepth];
+    int depth = 0;
+    PageHandle current = _Pin(meta->root);
+    while (!current.IsLeaf()) {
+        const InternalPage* internalPage = current.Internal();
+        int childIndex = NodeUpperBound(internalPage->keys, internalPage->header.count, data);
+        PageId child = internalPage->children[childIndex];
+        path[depth] = std::move(current);
+        pathIndex[depth] = childIndex;
+        ++depth;
+        current = _Pin(child);
+    }
+
+    int position = _FindInLeaf(current.Leaf(), data);
+    if (position < 0)
+        return false;
+    LeafPage* leaf = current.EditLeaf();
+    _MoveEntries(leaf, position + 1, leaf->header.count - position - 1, leaf, position);
+    --leaf->header.count;
+    --meta->size;
+
+    // Routing keys may keep the deleted value, they still separate the subtrees correctly
+    if (depth == 0) {
+        if (leaf->header.count == 0) {
+            _FreePage(current);
+            meta->root = InvalidPageId;
+            meta->height = 0;
+        }
+        return true;
+    }
+    if (leaf->header.count >= MinExternalKeys)
+        return true;
+    _RebalanceExternal(current, path[depth - 1], pathIndex[depth - 1]);
+
+    // A merge took a key from the parent, fix underfull internal pages up to the root
+    for (int level = depth - 1; level >= 0; --level) {
+        const InternalPage* internalPage = path[level].Internal();
+        if (level == 0) {
+            if (internalPage->header.count == 0) {
+                meta->root = internalPage->children[0];
+                --meta->height;
+                _FreePage(path[0]);
+            }
+            break;
+        }
+        if (internalPage->header.count >= MinInternalKeys)
+            break;
+        _RebalanceInternal(path[level], path[level - 1], pathIndex[level - 1]);
+    }
+    return true;
+}
+
+// Refills an underfull leaf from a sibling, or merges it with one when neither can spare a key
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_RebalanceExternal(PageHandle& nodePage, PageHandle& parentPage, int index) {
+    InternalPage* parent = parentPage.EditInternal();
+    LeafPage* node = nodePage.EditLeaf();
+    PageHandle leftPage = index > 0 ? _Pin(parent->children[index - 1]) : PageHandle();
+    PageHandle rightPage;
+    if (leftPage.Id() == InvalidPageId || leftPage.Head()->count <= MinExternalKeys)
+        rightPage = index < parent->header.count ? _Pin(parent->children[index + 1]) : PageHandle();
+
+    if (leftPage.Id() != InvalidPageId && leftPage.Head()->count > MinExternalKeys) {
+        LeafPage* left = leftPage.EditLeaf();
+        _MoveEntries(node, 0, node->header.count, node, 1);
+        _MoveEntries(left, left->header.count - 1, 1, node, 0);
+        --left->header.count;
+        ++node->header.count;
+        parent->keys[index - 1] = node->keys[0];
+    } else if (rightPage.Id() != InvalidPageId && rightPage.Head()->count > MinExternalKeys) {
+        LeafPage* right = rightPage.EditLeaf();
+        _MoveEntries(right, 0, 1, node, node->header.count);
+        ++node->header.count;
+        _MoveEntries(right, 1, right->header.count - 1, right, 0);
+        --right->header.count;
+        parent->keys[index] = right->keys[0];
+    } else if (leftPage.Id() != InvalidPageId) {
+        LeafPage* left = leftPage.EditLeaf();
+        _MoveEntries(node, 0, node->header.count, left, left->header.count);
+        left->header.count += node->header.count;
+        left->header.next = node->header.next;
+        if (node->header.next != InvalidPageId)
+            _Pin(node->header.next).EditLeaf()->header.prev = leftPage.Id();
+        _RemoveFromInternal(parent, index - 1);
+        _FreePage(nodePage);
+    } else {
+        LeafPage* right = rightPage.EditLeaf();
+        _MoveEntries(right, 0, right->header.count, node, node->header.count);
+        node->header.count += right->header.count;
+        node->header.next = right->header.next;
+        if (right->header.next != InvalidPageId)
+            _Pin(right->header.next).EditLeaf()->header.prev = nodePage.Id();
+        _RemoveFromInternal(parent, index);
+        _FreePage(rightPage);
+    }
+}
+
+// Same as _RebalanceExternal for internal pages, keys rotate through the parent
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_RebalanceInternal(PageHandle& nodePage, PageHandle& parentPage, int index) {
+    InternalPage* parent = parentPage.EditInternal();
+    InternalPage* node = nodePage.EditInternal();
+    PageHandle leftPage = index > 0 ? _Pin(parent->children[index - 1]) : PageHandle();
+    PageHandle rightPage;
+    if (leftPage.Id() == InvalidPageId || leftPage.Head()->count <= MinInternalKeys)
+        rightPage = index < parent->header.count ? _Pin(parent->children[index + 1]) : PageHandle();
+
+    if (leftPage.Id() != InvalidPageId && leftPage.Head()->count > MinInternalKeys) {
+        InternalPage* left = leftPage.EditInternal();
+        _MoveRange(node->keys, node->header.count, node->keys + 1);
+        _MoveRange(node->children, node->header.count + 1, node->children + 1);
+        node->keys[0] = parent->keys[index - 1];
+        node->children[0] = left->children[left->header.count];
+        parent->keys[index - 1] = left->keys[left->header.count - 1];
+        --left->header.count;
+        ++node->header.count;
+    } else if (rightPage.Id() != InvalidPageId && rightPage.Head()->count > MinInternalKeys) {
+        InternalPage* right = rightPage.EditInternal();
+        node->keys[node->header.count] = parent->keys[index];
+        node->children[node->header.count + 1] = right->children[0];
+        ++node->header.count;
+        parent->keys[index] = right->keys[0];
+        _MoveRange(right->keys + 1, right->header.count - 1, right->keys);
+        _MoveRange(right->children + 1, right->header.count, right->children);
+        --right->header.count;
+    } else if (leftPage.Id() != InvalidPageId) {
+        _MergeInternal(leftPage, nodePage, parent, index - 1);
+    } else {
+        _MergeInternal(nodePage, rightPage, parent, index);
+    }
+}
+
+// Appends the separator and all of right to left, then frees right
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_MergeInternal(PageHandle& leftPage, PageHandle& rightPage, InternalPage* parent, int separatorIndex) {
+    InternalPage* left = leftPage.EditInternal();
+    const InternalPage* right = rightPage.Internal();
+    left->keys[left->header.count] = parent->keys[separatorIndex];
+    _MoveRange(right->keys, right->header.count, left->keys + left->header.count + 1);
+    _MoveRange(right->children, right->header.count + 1, left->children + left->header.count + 1);
+    left->header.count += right->header.count + 1;
+    _RemoveFromInternal(parent, separatorIndex);
+    _FreePage(rightPage);
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_RemoveFromInternal(InternalPage* node, int keyIndex) {
+    _MoveRange(node->keys + keyIndex + 1, node->header.count - keyIndex - 1, node->keys + keyIndex);
+    _MoveRange(node->children + keyIndex + 2, node->header.count - keyIndex - 1, node->children + keyIndex + 1);
+    --node->header.count;
+}
+
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_Print(PageId id, int depth) const {
+    if (id == InvalidPageId)
+        return;
+    PageHandle page = _Pin(id);
+
+    // Print indentation based on depth
+    for (int i = 0; i < depth; i++)
+        std::cout << "    "; // Use four spaces for each level of depth
+
+    // Print the keys of the page, then its children one level deeper
+    if (page.IsLeaf()) {
+        const LeafPage* leafPage = page.Leaf();
+        for (int i = 0; i < leafPage->header.count; i++)
+            std::cout << leafPage->keys[i] << " ";
+        std::cout << std::endl;
+    } else {
+        const InternalPage* internalPage = page.Internal();
+        for (int i = 0; i < internalPage->header.count; i++)
+            std::cout << internalPage->keys[i] << " ";
+        std::cout << std::endl;
+        for (int i = 0; i <= internalPage->header.count; i++)
+            _Print(internalPage->children[i], depth + 1);
+    }
+}
+
+// Gives every page of the subtree back to the store
+template <typename T, class V, class Store, std::size_t PageBytes>
+void PagedBPlusTree<T, V, Store, PageBytes>::_Clear(PageId id) {
+    if (id == InvalidPageId)
+        return;
+    PageHandle page = _Pin(id);
+    if (!page.IsLeaf()) {
+        const InternalPage* internalPage = page.Internal();
+        for (int i = 0; i <= internalPage->header.count; i++)
+            _Clear(internalPage->children[i]);
+    }
+    _FreePage(page);
+}
+
+} // namespace VLIB
+
+#endif // __PAGED_BPLUS_TREE_H__
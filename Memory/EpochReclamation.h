@@ -0,0 +1,243 @@
+#ifndef VLIB_EPOCH_RECLAMATION_H
+#define VLIB_EPOCH_RECLAMATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+    Epoch-based reclamation for lock-free containers.
+
+    A lock-free container cannot free an unlinked node right away, another thread may still be reading
+    it. With an EpochDomain every operation runs inside an EpochGuard, which announces the global epoch
+    the thread started in. A node unlinked by the container is handed to retire() instead of being freed,
+    it is freed once every thread that could still hold a pointer to it has left its guard: the global
+    epoch only moves on when every thread inside a guard has seen the current one, so two steps later
+    nobody can have seen the node.
+
+        EpochDomain domain;                         // one per container
+        {
+            EpochGuard guard(domain);               // pins the calling thread
+            ... read nodes, unlink one ...
+            domain.retire(node, &freeNode, context);  // freeNode(node, context) runs later
+        }
+
+    Every thread gets its own record in a domain on first use, garbage is kept per thread so retire never
+    contends. Records of exited threads are reused by new threads, their garbage goes with them. Nodes
+    that are still waiting when the domain is destroyed are freed by its destructor, nobody may be
+    inside a guard by then.
+*/
+
+namespace VLIB {
+
+class EpochDomain {
+public:
+    using Deleter = void (*)(void* object, void* context);
+
+    EpochDomain() : state(std::make_shared<State>()) {}
+    ~EpochDomain() {state->freeAll();}
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // Entered by EpochGuard, guards nest
+    void pin() {
+        Record* record = localRecord();
+        if (record->pins++ > 0)
+            return;
+        std::uint64_t epoch = state->epoch.load(std::memory_order_relaxed);
+        record->epoch.exchange(epoch | Active, std::memory_order_seq_cst); // Announced before any node is read
+    }
+    void unpin() {
+        Record* record = localRecord();
+        if (--record->pins > 0)
+            return;
+        record->epoch.store(0, std::memory_order_release);
+    }
+
+    // Frees object with deleter(object, context) once no thread can see it, call it inside a guard
+    void retire(void* object, Deleter deleter, void* context) {
+        Record* record = localRecord();
+        std::uint64_t epoch = state->epoch.load(std::memory_order_acquire);
+        Limbo& limbo = record->limbo[(epoch / EpochStep) % 3];
+        if (limbo.epoch != epoch) {
+            state->collect(record, epoch);
+            limbo.epoch = epoch;
+        }
+        limbo.retired.push_back(Retired{object, deleter, context});
+        if (++record->retiredSinceAdvance >= AdvanceEvery) {
+            record->retiredSinceAdvance = 0;
+            state->tryAdvance();
+            state->collect(record, state->epoch.load(std::memory_order_acquire));
+        }
+    }
+
+private:
+    static constexpr std::uint64_t Active = 1;      // Low bit of a record's epoch, set while the thread is pinned
+    static constexpr std::uint64_t EpochStep = 2;   // The epoch counts in steps of 2 to keep the low bit free
+    static constexpr int AdvanceEvery = 64;         // Retires between attempts to move the epoch on
+    static constexpr std::size_t MinSweep = 16;     // Thread record entries before the first sweep
+
+    struct Retired {
+        void* object;
+        Deleter deleter;
+        void* context;
+    };
+    struct Limbo {
+        std::uint64_t epoch = 0; // Epoch the nodes were retired in
+        std::vector<Retired> retired;
+    };
+    struct alignas(64) Record {
+        std::atomic<std::uint64_t> epoch{0};   // Epoch | Active while pinned, 0 otherwise
+        std::atomic<bool> owned{true};
+        Record* next = nullptr;
+        int pins = 0;                          // Only touched by the owner
+        int retiredSinceAdvance = 0;
+        Limbo limbo[3];
+    };
+
+    struct State {
+        std::atomic<std::uint64_t> epoch{EpochStep};
+        std::atomic<Record*> records{nullptr};
+
+        ~State() {
+            Record* record = records.load();
+            while (record != nullptr) {
+                Record* next = record->next;
+                delete record;
+                record = next;
+            }
+        }
+
+        // Moves the epoch on when every pinned thread has seen the current one
+        void tryAdvance() {
+            std::uint64_t current = epoch.load(std::memory_order_acquire);
+            for (Record* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                std::uint64_t seen = record->epoch.load(std::memory_order_acquire);
+                if ((seen & Active) != 0 && (seen & ~Active) != current)
+                    return;
+            }
+            epoch.compare_exchange_strong(current, current + EpochStep, std::memory_order_acq_rel);
+        }
+
+        // Frees what record retired two or more epochs before current
+        static void collect(Record* record, std::uint64_t current) {
+            for (Limbo& limbo : record->limbo) {
+                if (limbo.retired.empty() || limbo.epoch + 2 * EpochStep > current)
+                    continue;
+                for (const Retired& retired : limbo.retired)
+                    retired.deleter(retired.object, retired.context);
+                limbo.retired.clear();
+            }
+        }
+
+        void freeAll() {
+            for (Record* record = records.load(); record != nullptr; record = record->next) {
+                for (Limbo& limbo : record->limbo) {
+                    for (const Retired& retired : limbo.retired)
+                        retired.deleter(retired.object, retired.context);
+                    limbo.retired.clear();
+                }
+            }
+        }
+
+        // A record of an exited thread, or a new one
+        Record* acquire() {
+            for (Record* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                bool owned = false;
+                if (!record->owned.load(std::memory_order_relaxed) && record->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+                    return record;
+            }
+            Record* record = new Record();
+            Record* head = records.load(std::memory_order_relaxed);
+            do
+                record->next = head;
+            while (!records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+            return record;
+        }
+    };
+
+    // Records of the calling thread, handed back when the thread exits (if the domain is still alive).
+    // Entries are keyed by the address of the State, the weak_ptr keeps that block allocated so the
+    // address is not reused while the entry exists. Entries of destroyed domains are dropped on a miss
+    // once the map has grown to sweepAt, so a thread going through many short-lived domains keeps
+    // O(1) lookups and a bounded number of dead State blocks.
+    struct ThreadRecords {
+        struct Entry {
+            std::weak_ptr<State> state;
+            Record* record;
+        };
+        std::unordered_map<const State*, Entry> entries;
+        const State* lastState = nullptr;   // The last lookup, pin, unpin and retire usually hit it
+        Record* lastRecord = nullptr;
+        std::size_t sweepAt = MinSweep;
+
+        ~ThreadRecords() {
+            for (auto& entry : entries) {
+                if (std::shared_ptr<State> state = entry.second.state.lock())
+                    entry.second.record->owned.store(false, std::memory_order_release);
+            }
+        }
+
+        void sweep() {
+            for (auto it = entries.begin(); it != entries.end();) {
+                if (it->second.state.expired()) {
+                    if (lastState == it->first)
+                        lastState = nullptr;
+                    it = entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            sweepAt = std::max(MinSweep, 2 * entries.size());
+        }
+    };
+    Record* localRecord() {
+        thread_local ThreadRecords threadRecords;
+        if (threadRecords.lastState == state.get())
+            return threadRecords.lastRecord;
+
+        Record* record;
+        auto found = threadRecords.entries.find(state.get());
+        if (found != threadRecords.entries.end()) {
+            record = found->second.record;
+        } else {
+            if (threadRecords.entries.size() >= threadRecords.sweepAt)
+                threadRecords.sweep();
+            record = state->acquire();
+            try {
+                threadRecords.entries.emplace(state.get(), ThreadRecords::Entry{state, record});
+            } catch (...) {
+                record->owned.store(false, std::memory_order_release);
+                throw;
+            }
+        }
+        threadRecords.lastState = state.get();
+        threadRecords.lastRecord = record;
+        return record;
+    }
+
+    std::shared_ptr<State> state;
+};
+
+// Pins the calling thread in domain for its lifetime
+class EpochGuard {
+public:
+    explicit EpochGuard(EpochDomain& domain) : domain(domain) {domain.pin();}
+    ~EpochGuard() {domain.unpin();}
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    EpochDomain& domain;
+};
+
+} // namespace VLIB
+
+#endif // VLIB_EPOCH_RECLAMATION_H
@@ -0,0 +1,86 @@
+#ifndef __MONOTONIC_ARENA_TEST_H__
+#define __MONOTONIC_ARENA_TEST_H__
+
+#include "../MonotonicArena.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Checks of MonotonicArena::allocate with mixed sizes and alignments. Every block is filled with its own
+// byte and checked once all blocks exist, a block placed past its chunk or over another one shows up as
+// a changed byte (or as a heap-buffer-overflow under AddressSanitizer).
+//
+//     bool ok = exampleMonotonicArena::runMixedAlignmentTest();
+class exampleMonotonicArena {
+public:
+    static bool runMixedAlignmentTest() {
+        bool ok = true;
+
+        // Padding for the alignment larger than what is left of the chunk
+        {
+            VLIB::MonotonicArena arena(4096);
+            ok &= check(arena, {{4100, 1}, {8, 8}}, "padding past the end of the chunk");
+        }
+
+        // A chunk filled up to a few bytes before its end, then a strongly aligned request
+        {
+            VLIB::MonotonicArena arena(4096);
+            ok &= check(arena, {{4000, 1}, {3, 1}, {64, 64}, {1, 1}, {128, 128}}, "aligned request at the end of a chunk");
+        }
+
+        // Many small blocks of every alignment up to 256, across several chunks
+        {
+            VLIB::MonotonicArena arena(256);
+            std::vector<Request> requests;
+            for (std::size_t i = 0; i < 2000; ++i)
+                requests.push_back(Request{1 + (i * 7) % 61, std::size_t(1) << (i % 9)});
+            ok &= check(arena, requests, "mixed sizes and alignments");
+        }
+
+        // The same after reset, the kept chunk is reused from its start
+        {
+            VLIB::MonotonicArena arena(256);
+            std::vector<Request> requests;
+            for (std::size_t i = 0; i < 300; ++i)
+                requests.push_back(Request{5 + i % 29, std::size_t(1) << ((i * 5) % 8)});
+            ok &= check(arena, requests, "before reset");
+            arena.reset();
+            ok &= check(arena, requests, "after reset");
+        }
+
+        std::cout << (ok ? "MonotonicArena mixed alignment: passed" : "MonotonicArena mixed alignment: FAILED") << std::endl;
+        return ok;
+    }
+
+private:
+    struct Request {
+        std::size_t bytes;
+        std::size_t align;
+    };
+
+    static bool check(VLIB::MonotonicArena& arena, const std::vector<Request>& requests, const char* name) {
+        std::vector<unsigned char*> blocks;
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            unsigned char* block = static_cast<unsigned char*>(arena.allocate(requests[i].bytes, requests[i].align));
+            if (reinterpret_cast<std::uintptr_t>(block) % requests[i].align != 0) {
+                std::cout << name << ": block " << i << " is not aligned to " << requests[i].align << std::endl;
+                return false;
+            }
+            std::memset(block, static_cast<int>(i & 0xff), requests[i].bytes);
+            blocks.push_back(block);
+        }
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            for (std::size_t b = 0; b < requests[i].bytes; ++b) {
+                if (blocks[i][b] != static_cast<unsigned char>(i & 0xff)) {
+                    std::cout << name << ": block " << i << " overlaps another one" << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+#endif // __MONOTONIC_ARENA_TEST_H__
@@ -0,0 +1,171 @@
+#ifndef VLIB_MONOTONIC_ARENA_H
+#define VLIB_MONOTONIC_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include "NodeAllocator.h"
+
+/*
+    Bump allocation for build-once, query-many containers.
+
+    MonotonicArena hands out memory by advancing a cursor through large chunks, nothing is ever freed
+    on its own. reset() drops every allocation at once and keeps the newest (largest) chunk around,
+    so a structure that is rebuilt over and over settles into a single chunk and stops calling malloc.
+
+    ArenaAllocator<T> is the std::allocator compatible face of an arena, deallocate is a no-op.
+    Every copy and rebind shares the same arena, a default constructed ArenaAllocator brings its own.
+    Give it to a tree to get the arena construction mode:
+
+        BSTree<int, ArenaAllocator<int>> bst;       // or ArenaBSTree<int>
+        for (...) bst.insert(x);                    // no per-node malloc
+        bst.Clear();                                // resets the arena, no node is visited
+
+    The reset only happens while the container holds the only copy of the allocator, if the arena is
+    shared Clear() falls back to destroying the nodes one by one and the memory is reclaimed once the
+    last copy goes away. Removing single elements never gives memory back, use a PoolAllocator for
+    containers that churn.
+*/
+
+namespace VLIB {
+
+class MonotonicArena {
+public:
+    explicit MonotonicArena(std::size_t firstChunkBytes = 4096)
+        : nextChunkBytes(firstChunkBytes < MinChunkBytes ? MinChunkBytes : firstChunkBytes),
+          chunks(nullptr), cursor(nullptr), end(nullptr) {}
+    ~MonotonicArena() { release(); }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t align)
+    {
+        // The padding can be more than what is left of the chunk, compare before subtracting
+        char* p = alignUp(cursor, align);
+        if (cursor == nullptr || p > end || bytes > static_cast<std::size_t>(end - p)) {
+            grow(bytes + align);
+            p = alignUp(cursor, align);
+        }
+        cursor = p + bytes;
+        return p;
+    }
+
+    // Drops every allocation, the newest chunk is kept for reuse
+    void reset()
+    {
+        if (chunks == nullptr)
+            return;
+        freeChunks(chunks->next);
+        chunks->next = nullptr;
+        cursor = reinterpret_cast<char*>(chunks + 1);
+        end = reinterpret_cast<char*>(chunks) + chunks->bytes;
+    }
+
+    // Drops every allocation and returns all chunks to the system
+    void release()
+    {
+        freeChunks(chunks);
+        chunks = nullptr;
+        cursor = end = nullptr;
+    }
+
+private:
+    struct alignas(std::max_align_t) ChunkHeader {
+        ChunkHeader* next;
+        std::size_t bytes;
+    };
+
+    static constexpr std::size_t MinChunkBytes = 256;
+    static constexpr std::size_t MaxChunkBytes = std::size_t(1) << 24;
+
+    static char* alignUp(char* p, std::size_t align)
+    {
+        std::size_t offset = reinterpret_cast<std::uintptr_t>(p) % align;
+        return offset ? p + (align - offset) : p;
+    }
+
+    static void freeChunks(ChunkHeader* chunk)
+    {
+        while (chunk != nullptr) {
+            ChunkHeader* next = chunk->next;
+            ::operator delete(static_cast<void*>(chunk));
+            chunk = next;
+        }
+    }
+
+    // Chunks double in size up to MaxChunkBytes, a single large request gets a chunk of its own size
+    void grow(std::size_t minBytes)
+    {
+        std::size_t bytes = sizeof(ChunkHeader) + (minBytes > nextChunkBytes ? minBytes : nextChunkBytes);
+        ChunkHeader* chunk = static_cast<ChunkHeader*>(::operator new(bytes));
+        chunk->next = chunks;
+        chunk->bytes = bytes;
+        chunks = chunk;
+        cursor = reinterpret_cast<char*>(chunk + 1);
+        end = reinterpret_cast<char*>(chunk) + bytes;
+        if (nextChunkBytes * 2 <= MaxChunkBytes)
+            nextChunkBytes *= 2;
+    }
+
+    std::size_t nextChunkBytes;
+    ChunkHeader* chunks;
+    char* cursor;
+    char* end;
+};
+
+template <class T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() : arena(std::make_shared<MonotonicArena>()) {}
+    explicit ArenaAllocator(std::size_t firstChunkBytes) : arena(std::make_shared<MonotonicArena>(firstChunkBytes)) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Memory only comes back through reset
+    void deallocate(T*, std::size_t) noexcept {}
+
+    // Resets the arena when no other allocator shares it, returns false (and frees nothing) otherwise
+    bool reset()
+    {
+        if (arena.use_count() != 1)
+            return false;
+        arena->reset();
+        return true;
+    }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <class U> friend class ArenaAllocator;
+
+    std::shared_ptr<MonotonicArena> arena;
+};
+
+// Bulk release hook, see releaseAllNodes in NodeAllocator.h
+template <class T>
+bool releaseAllNodes(ArenaAllocator<T>& alloc)
+{
+    return alloc.reset();
+}
+
+template <class T>
+struct IsMonotonicAllocator<ArenaAllocator<T>> : std::true_type {};
+
+} // namespace VLIB
+
+#endif // VLIB_MONOTONIC_ARENA_H
@@ -0,0 +1,95 @@
+#ifndef VLIB_NODE_ALLOCATOR_H
+#define VLIB_NODE_ALLOCATOR_H
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/*
+    Node allocation helpers shared by the node based containers.
+
+    Every container takes an std::allocator compatible Alloc template parameter (std::allocator<T> by default)
+    and rebinds it to its own node type, so any allocator written against std::allocator_traits
+    (arenas, pools, NUMA local allocators, ...) can back the nodes without touching the container headers.
+
+    Usage inside a container:
+        NodeAllocatorFor<Alloc, SLNode<T>> nodeAlloc(alloc);
+        SLNode<T>* node = constructNode(nodeAlloc, el);
+        destroyNode(nodeAlloc, node);
+
+    Allocators that own all of their memory (see PoolAllocator in NodePool.h) overload releaseAllNodes,
+    containers call tryReleaseAllNodes on clear/destruction and only walk their nodes when it returns false.
+    Monotonic allocators (see ArenaAllocator in MonotonicArena.h) never reuse freed memory, containers keep
+    allocations that are freed one at a time (hash maps, shared user data) off them, see IsMonotonicAllocator.
+*/
+
+namespace VLIB {
+
+// Alloc rebound to the node type of a container
+template <class Alloc, class NodeT>
+using NodeAllocatorFor = typename std::allocator_traits<Alloc>::template rebind_alloc<NodeT>;
+
+// Allocates a single node through nodeAlloc and constructs it from args
+template <class NodeAlloc, class... Args>
+typename std::allocator_traits<NodeAlloc>::value_type* constructNode(NodeAlloc& nodeAlloc, Args&&... args)
+{
+    using Traits = std::allocator_traits<NodeAlloc>;
+    typename Traits::value_type* node = Traits::allocate(nodeAlloc, 1);
+    try {
+        Traits::construct(nodeAlloc, node, std::forward<Args>(args)...);
+    } catch (...) {
+        Traits::deallocate(nodeAlloc, node, 1);
+        throw;
+    }
+    return node;
+}
+
+// Destroys and deallocates a node created by constructNode, null is ignored
+template <class NodeAlloc>
+void destroyNode(NodeAlloc& nodeAlloc, typename std::allocator_traits<NodeAlloc>::value_type* node)
+{
+    using Traits = std::allocator_traits<NodeAlloc>;
+    if (node == nullptr)
+        return;
+    Traits::destroy(nodeAlloc, node);
+    Traits::deallocate(nodeAlloc, node, 1);
+}
+
+// Bulk release hook, the generic allocator cannot free its nodes in one go
+template <class NodeAlloc>
+bool releaseAllNodes(NodeAlloc&)
+{
+    return false;
+}
+
+// Frees every node of nodeAlloc at once when that skips nothing observable (no destructors to run)
+// and the allocator supports it. Returns false when the caller still has to destroy its nodes one by one.
+template <class NodeAlloc>
+bool tryReleaseAllNodes(NodeAlloc& nodeAlloc)
+{
+    if (!std::is_trivially_destructible<typename std::allocator_traits<NodeAlloc>::value_type>::value)
+        return false;
+    return releaseAllNodes(nodeAlloc);
+}
+
+// True for allocators whose deallocate gives nothing back until the whole arena is reset
+template <class Alloc>
+struct IsMonotonicAllocator : std::false_type {};
+
+// Allocator for side allocations that are freed one at a time (hash map entries, shared user data),
+// Alloc rebound to T unless Alloc is monotonic, those fall back to std::allocator
+template <class Alloc, class T>
+using SideAllocatorFor = typename std::conditional<IsMonotonicAllocator<Alloc>::value, std::allocator<T>, NodeAllocatorFor<Alloc, T>>::type;
+
+template <class T, class Alloc>
+SideAllocatorFor<Alloc, T> sideAllocator(const Alloc& alloc)
+{
+    if constexpr (IsMonotonicAllocator<Alloc>::value)
+        return std::allocator<T>();
+    else
+        return NodeAllocatorFor<Alloc, T>(alloc);
+}
+
+} // namespace VLIB
+
+#endif // VLIB_NODE_ALLOCATOR_H
@@ -0,0 +1,255 @@
+#ifndef VLIB_NODE_POOL_H
+#define VLIB_NODE_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+    Fixed-size slab allocation for container nodes.
+
+    SlabPool carves fixed-size slots out of large chunks, freed slots go on an intrusive free list,
+    so allocate and deallocate are O(1) and neighbouring nodes end up next to each other in memory.
+    Chunks are only returned to the system when the pool is released or destroyed, which frees every
+    slot in one go without touching the individual nodes.
+
+    NodePool<NodeT> is the typed front end of a SlabPool for a single node type:
+        NodePool<SLNode<int>> pool;
+        SLNode<int>* node = pool.create(42);
+        pool.destroy(node);
+
+    PoolAllocator<T> is the std::allocator compatible face used as default allocator by SLList, DLList,
+    skipList, BSTree and AVLTree. Every copy and rebind of one PoolAllocator shares the same set of slab
+    pools (one per 16 byte size class), so a container gets its own pools for whatever it allocates.
+    Requests larger than PoolAllocatorMaxPooledBytes or with extended alignment go to operator new,
+    the bulk release is refused while any of those is still allocated (the container then frees its
+    nodes one by one).
+
+    None of these types are thread safe, just like the containers using them.
+*/
+
+namespace VLIB {
+
+class SlabPool {
+public:
+    explicit SlabPool(std::size_t slotSize, std::size_t slotAlign = alignof(std::max_align_t), std::size_t firstChunkSlots = 64)
+        : align(slotAlign < alignof(FreeSlot) ? alignof(FreeSlot) : slotAlign),
+          size(roundUp(slotSize < sizeof(FreeSlot) ? sizeof(FreeSlot) : slotSize, align)),
+          nextChunkSlots(firstChunkSlots ? firstChunkSlots : 1),
+          freeList(nullptr), chunks(nullptr), bumpCursor(nullptr), bumpEnd(nullptr) {}
+    ~SlabPool() { releaseAll(); }
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    void* allocate()
+    {
+        if (freeList != nullptr) {
+            FreeSlot* slot = freeList;
+            freeList = slot->next;
+            return slot;
+        }
+        if (bumpCursor == bumpEnd)
+            grow();
+        void* slot = bumpCursor;
+        bumpCursor += size;
+        return slot;
+    }
+
+    void deallocate(void* p)
+    {
+        FreeSlot* slot = static_cast<FreeSlot*>(p);
+        slot->next = freeList;
+        freeList = slot;
+    }
+
+    // Returns every chunk to the system, all slots handed out by this pool become invalid
+    void releaseAll()
+    {
+        while (chunks != nullptr) {
+            ChunkHeader* next = chunks->next;
+            ::operator delete(static_cast<void*>(chunks), std::align_val_t(align));
+            chunks = next;
+        }
+        freeList = nullptr;
+        bumpCursor = bumpEnd = nullptr;
+    }
+
+    std::size_t slotSize() const { return size; }
+
+private:
+    struct FreeSlot { FreeSlot* next; };
+    struct ChunkHeader { ChunkHeader* next; };
+
+    static constexpr std::size_t MaxChunkBytes = std::size_t(1) << 20;
+
+    static std::size_t roundUp(std::size_t value, std::size_t to) { return (value + to - 1) / to * to; }
+
+    // Chunks double in size until they reach MaxChunkBytes, small pools stay small
+    void grow()
+    {
+        std::size_t headerBytes = roundUp(sizeof(ChunkHeader), align);
+        std::size_t bytes = headerBytes + nextChunkSlots * size;
+        char* block = static_cast<char*>(::operator new(bytes, std::align_val_t(align)));
+        ChunkHeader* header = reinterpret_cast<ChunkHeader*>(block);
+        header->next = chunks;
+        chunks = header;
+        bumpCursor = block + headerBytes;
+        bumpEnd = block + bytes;
+        if ((nextChunkSlots * 2) * size <= MaxChunkBytes)
+            nextChunkSlots *= 2;
+    }
+
+    std::size_t align;
+    std::size_t size;
+    std::size_t nextChunkSlots;
+    FreeSlot* freeList;
+    ChunkHeader* chunks;
+    char* bumpCursor;
+    char* bumpEnd;
+};
+
+/*
+* Typed pool for one node type
+*/
+template <class NodeT>
+class NodePool {
+public:
+    explicit NodePool(std::size_t firstChunkSlots = 64) : slab(sizeof(NodeT), alignof(NodeT), firstChunkSlots) {}
+
+    NodeT* allocate() { return static_cast<NodeT*>(slab.allocate()); }
+    void deallocate(NodeT* node) { slab.deallocate(node); }
+
+    template <class... Args>
+    NodeT* create(Args&&... args)
+    {
+        void* slot = slab.allocate();
+        try {
+            return ::new (slot) NodeT(std::forward<Args>(args)...);
+        } catch (...) {
+            slab.deallocate(slot);
+            throw;
+        }
+    }
+
+    void destroy(NodeT* node)
+    {
+        if (node == nullptr)
+            return;
+        node->~NodeT();
+        slab.deallocate(node);
+    }
+
+    // Frees every node at once, destructors are not run
+    void releaseAll() { slab.releaseAll(); }
+
+private:
+    SlabPool slab;
+};
+
+/*
+* Size-class pools shared by all copies of a PoolAllocator
+*/
+constexpr std::size_t PoolAllocatorSizeClass = 16;
+constexpr std::size_t PoolAllocatorMaxPooledBytes = 512;
+
+class SlabPoolSet {
+public:
+    SlabPoolSet() = default;
+    SlabPoolSet(const SlabPoolSet&) = delete;
+    SlabPoolSet& operator=(const SlabPoolSet&) = delete;
+
+    // Pool serving requests of the given size, created on first use
+    SlabPool& poolFor(std::size_t bytes)
+    {
+        std::size_t index = (bytes + PoolAllocatorSizeClass - 1) / PoolAllocatorSizeClass - 1;
+        if (!pools[index])
+            pools[index].reset(new SlabPool((index + 1) * PoolAllocatorSizeClass));
+        return *pools[index];
+    }
+
+    void releaseAll()
+    {
+        for (std::unique_ptr<SlabPool>& pool : pools)
+            if (pool)
+                pool->releaseAll();
+    }
+
+    // Blocks handed out by operator new instead of a pool, releaseAll cannot free those
+    std::size_t unpooledBlocks = 0;
+
+private:
+    std::unique_ptr<SlabPool> pools[PoolAllocatorMaxPooledBytes / PoolAllocatorSizeClass];
+};
+
+template <class T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    PoolAllocator() : pools(std::make_shared<SlabPoolSet>()) {}
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : pools(other.pools) {}
+
+    T* allocate(std::size_t n)
+    {
+        std::size_t bytes = n * sizeof(T);
+        if (isPooled(bytes))
+            return static_cast<T*>(pools->poolFor(bytes).allocate());
+        T* block = static_cast<T*>(::operator new(bytes, std::align_val_t(alignof(T))));
+        ++pools->unpooledBlocks;
+        return block;
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        std::size_t bytes = n * sizeof(T);
+        if (isPooled(bytes))
+            pools->poolFor(bytes).deallocate(p);
+        else {
+            ::operator delete(static_cast<void*>(p), std::align_val_t(alignof(T)));
+            --pools->unpooledBlocks;
+        }
+    }
+
+    // Drops every pooled allocation at once, only done when no other allocator shares the pools.
+    // Returns false (and frees nothing) when the pools are shared or a block from operator new is
+    // still allocated, it would leak.
+    bool releaseAll()
+    {
+        if (pools.use_count() != 1 || pools->unpooledBlocks != 0)
+            return false;
+        pools->releaseAll();
+        return true;
+    }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U>& other) const { return pools == other.pools; }
+    template <class U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pools != other.pools; }
+
+private:
+    template <class U> friend class PoolAllocator;
+
+    static bool isPooled(std::size_t bytes)
+    {
+        return bytes != 0 && bytes <= PoolAllocatorMaxPooledBytes && alignof(T) <= alignof(std::max_align_t);
+    }
+
+    std::shared_ptr<SlabPoolSet> pools;
+};
+
+// Bulk release hook, see releaseAllNodes in NodeAllocator.h
+template <class T>
+bool releaseAllNodes(PoolAllocator<T>& alloc)
+{
+    return alloc.releaseAll();
+}
+
+} // namespace VLIB
+
+#endif // VLIB_NODE_POOL_H
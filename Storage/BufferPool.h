@@ -0,0 +1,333 @@
+#ifndef VLIB_BUFFER_POOL_H
+#define VLIB_BUFFER_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "PageFile.h"
+
+/*
+    A page store that keeps at most budgetBytes of pages in memory, whatever the size of the file.
+
+    Pages are read into a fixed set of frames (budgetBytes / pageBytes of them) with pread and written
+    back with pwrite, either when their frame is needed for another page or on Flush / Sync. A pinned
+    page is never evicted, Unpin(id, true) marks it dirty. It offers the page store interface of
+    PageFile.h, so it drops into the paged trees in place of MmapPageFile:
+
+        PagedBPlusTree<int, void, BufferPool> tree("index.db", 64 << 20);   // 64 MiB of pages at most
+        PagedBPlusTree<int, void, BufferPool> scan("index.db", 8 << 20, EvictionPolicy::LRUK, 2);
+
+    Eviction picks an unpinned frame with
+        Clock: a second chance sweep, a page touched since the hand last passed survives one more round.
+               O(1) bookkeeping per access.
+        LRUK:  the page whose K-th most recent access is the oldest, pages seen fewer than K times go
+               first (oldest last access first). A single scan over many pages then cannot push out
+               the pages that are hit over and over. O(log frames) per access.
+
+    Stats() counts hits, misses, evictions and page writes, a hit ratio that stays low means the
+    budget is smaller than the working set:
+        BufferPoolStats stats = tree.GetStore().Stats();
+        double ratio = stats.HitRatio();
+
+    Not thread safe. The destructor flushes, Sync also makes the writes durable.
+*/
+
+namespace VLIB {
+
+enum class EvictionPolicy {
+    Clock,
+    LRUK
+};
+
+struct BufferPoolStats {
+    std::uint64_t hits = 0;       // Pins of a page already in a frame
+    std::uint64_t misses = 0;     // Pins that read the page from the file
+    std::uint64_t evictions = 0;  // Pages dropped to make room
+    std::uint64_t writes = 0;     // Dirty pages written back, on eviction or flush
+
+    double HitRatio() const {return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);};
+};
+
+class BufferPool {
+public:
+    static constexpr std::size_t MinFrames = 16; // Enough for the pages a tree pins at once
+
+    explicit BufferPool(const std::string& path, std::size_t pageBytes = 4096, std::size_t budgetBytes = std::size_t(64) << 20,
+                        EvictionPolicy policy = EvictionPolicy::Clock, int k = 2);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Page store interface, see PageFile.h
+    std::size_t PageSize() const {return pageBytes;};
+    std::uint64_t PageCount() const {return _Header()->pageCount;}; // Header page included
+    bool IsNew() const {return created;};
+    unsigned char* UserHeader() {return _Header()->user;};
+    PageId Allocate();
+    void Free(PageId id);
+    char* Pin(PageId id) {return _Pin(id, true);};
+    void Unpin(PageId id, bool dirty);
+    void Sync(); // Flush, then fsync
+
+    void Flush(); // Writes every dirty page and the header, without waiting for the disk
+    std::size_t FrameCount() const {return frames.size();};
+    std::size_t ResidentCount() const {return pageTable.size();};
+    const BufferPoolStats& Stats() const {return stats;};
+    void ResetStats() {stats = BufferPoolStats();};
+
+private:
+    struct Frame {
+        PageId id = InvalidPageId; // InvalidPageId while the frame is free
+        int pinCount = 0;
+        bool dirty = false;
+        bool referenced = false;   // Clock
+    };
+    using LRUKKey = std::tuple<std::uint64_t, std::uint64_t, std::size_t>; // K-th last access, last access, frame
+
+    static constexpr std::size_t FrameAlign = 64;
+
+    PageFileHeader* _Header() const {return reinterpret_cast<PageFileHeader*>(headerPage.get());};
+    char* _Data(std::size_t frame) const {return data + frame * pageBytes;};
+    char* _Pin(PageId id, bool read); // Pins id, a page that is not resident is read (or zeroed when !read)
+    std::size_t _Victim();
+    LRUKKey _LRUKKey(std::size_t frame) const;
+    void _Write(std::size_t frame);
+    void _WriteHeader();
+
+    std::string path;
+    int fd;
+    std::size_t pageBytes;
+    EvictionPolicy policy;
+    int k;
+    bool created;
+    std::unique_ptr<char[]> headerPage;        // Page 0 stays in memory, outside the budget
+    char* data;                                // frames.size() pages
+    std::vector<Frame> frames;
+    std::vector<std::size_t> freeFrames;
+    std::unordered_map<PageId, std::size_t> pageTable;
+    std::size_t clockHand;
+    std::uint64_t clock;                       // Access counter for LRU-K
+    std::vector<std::uint64_t> history;        // LRU-K, the last k accesses of every frame, most recent first
+    std::set<LRUKKey> evictable;               // LRU-K, unpinned resident frames ordered by eviction priority
+    BufferPoolStats stats;
+};
+
+inline BufferPool::BufferPool(const std::string& path, std::size_t pageBytes, std::size_t budgetBytes, EvictionPolicy policy, int k)
+    : path(path), fd(-1), pageBytes(pageBytes), policy(policy), k(k), created(false), data(nullptr), clockHand(0), clock(0) {
+    ValidatePageSize(pageBytes);
+    if (budgetBytes / pageBytes < MinFrames)
+        throw std::invalid_argument("buffer pool budget has to hold at least " + std::to_string(MinFrames) + " pages");
+    if (k < 1)
+        throw std::invalid_argument("LRU-K needs k >= 1");
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw PageFileError("cannot open", path);
+    try {
+        headerPage.reset(new char[pageBytes]());
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+            throw PageFileError("cannot stat", path);
+        created = status.st_size == 0;
+        if (created) {
+            InitPageFileHeader(*_Header(), pageBytes);
+        } else {
+            if (::pread(fd, headerPage.get(), sizeof(PageFileHeader), 0) != static_cast<ssize_t>(sizeof(PageFileHeader)))
+                throw std::runtime_error(path + " is not a page file");
+            CheckPageFileHeader(*_Header(), pageBytes, path);
+        }
+
+        std::size_t frameCount = budgetBytes / pageBytes;
+        data = static_cast<char*>(::operator new(frameCount * pageBytes, std::align_val_t(FrameAlign)));
+        frames.resize(frameCount);
+        freeFrames.reserve(frameCount);
+        for (std::size_t frame = frameCount; frame > 0; --frame)
+            freeFrames.push_back(frame - 1);
+        pageTable.reserve(frameCount);
+        if (policy == EvictionPolicy::LRUK)
+            history.assign(frameCount * k, 0);
+    } catch (...) {
+        if (data != nullptr)
+            ::operator delete(data, std::align_val_t(FrameAlign));
+        ::close(fd);
+        throw;
+    }
+}
+
+inline BufferPool::~BufferPool() {
+    try {
+        Flush();
+    } catch (...) {
+        // Nothing left to report the error to, Sync before destruction to see it
+    }
+    ::operator delete(data, std::align_val_t(FrameAlign));
+    ::close(fd);
+}
+
+inline PageId BufferPool::Allocate() {
+    PageFileHeader* header = _Header();
+    PageId id;
+    char* page;
+    if (header->freeHead != InvalidPageId) {
+        id = header->freeHead;
+        page = _Pin(id, true);
+        std::memcpy(&header->freeHead, page, sizeof(PageId));
+        --header->freeCount;
+        std::memset(page, 0, pageBytes);
+    } else {
+        if (header->pageCount > static_cast<std::uint64_t>(static_cast<PageId>(-1)))
+            throw std::length_error(path + " is out of page ids");
+        id = static_cast<PageId>(header->pageCount);
+        _Pin(id, false); // Past the end of the file, nothing to read
+        ++header->pageCount;
+    }
+    Unpin(id, true);
+    return id;
+}
+
+inline void BufferPool::Free(PageId id) {
+    PageFileHeader* header = _Header();
+    std::memcpy(Pin(id), &header->freeHead, sizeof(PageId));
+    Unpin(id, true);
+    header->freeHead = id;
+    ++header->freeCount;
+}
+
+inline void BufferPool::Unpin(PageId id, bool dirty) {
+    auto found = pageTable.find(id);
+    if (found == pageTable.end() || frames[found->second].pinCount == 0)
+        throw std::logic_error("unpinning a page that is not pinned");
+    Frame& frame = frames[found->second];
+    frame.dirty = frame.dirty || dirty;
+    if (--frame.pinCount == 0 && policy == EvictionPolicy::LRUK)
+        evictable.insert(_LRUKKey(found->second));
+}
+
+inline void BufferPool::Flush() {
+    for (std::size_t frame = 0; frame < frames.size(); ++frame) {
+        if (frames[frame].dirty)
+            _Write(frame);
+    }
+    _WriteHeader();
+}
+
+inline void BufferPool::Sync() {
+    Flush();
+    if (::fsync(fd) != 0)
+        throw PageFileError("cannot sync", path);
+}
+
+// A hit leaves the eviction order while pinned, a miss takes a free frame or evicts one and fills it
+inline char* BufferPool::_Pin(PageId id, bool read) {
+    std::size_t frame;
+    auto found = pageTable.find(id);
+    if (found != pageTable.end()) {
+        ++stats.hits;
+        frame = found->second;
+        if (frames[frame].pinCount == 0 && policy == EvictionPolicy::LRUK)
+            evictable.erase(_LRUKKey(frame));
+    } else {
+        ++stats.misses;
+        frame = _Victim();
+        char* page = _Data(frame);
+        off_t offset = static_cast<off_t>(id) * static_cast<off_t>(pageBytes);
+        ssize_t loaded = read ? ::pread(fd, page, pageBytes, offset) : 0;
+        if (loaded < 0) {
+            freeFrames.push_back(frame);
+            throw PageFileError("cannot read", path);
+        }
+        std::memset(page + loaded, 0, pageBytes - static_cast<std::size_t>(loaded)); // Pages past the end of the file read as zeros
+        frames[frame].id = id;
+        frames[frame].dirty = false;
+        pageTable.emplace(id, frame);
+        if (policy == EvictionPolicy::LRUK)
+            std::fill(history.begin() + frame * k, history.begin() + (frame + 1) * k, 0);
+    }
+
+    // Record the access for the eviction policy
+    if (policy == EvictionPolicy::Clock) {
+        frames[frame].referenced = true;
+    } else {
+        std::uint64_t* accesses = history.data() + frame * k;
+        std::copy_backward(accesses, accesses + k - 1, accesses + k);
+        accesses[0] = ++clock;
+    }
+    ++frames[frame].pinCount;
+    return _Data(frame);
+}
+
+// A free frame, or one emptied by evicting its page (written back first when dirty)
+inline std::size_t BufferPool::_Victim() {
+    std::size_t frame;
+    if (!freeFrames.empty()) {
+        frame = freeFrames.back();
+        freeFrames.pop_back();
+        return frame;
+    }
+
+    if (policy == EvictionPolicy::Clock) {
+        // Two full turns clear every reference bit, nothing found by then means everything is pinned
+        std::size_t steps = 0;
+        while (true) {
+            if (steps++ == 2 * frames.size())
+                throw std::runtime_error("every buffer pool frame is pinned");
+            frame = clockHand;
+            clockHand = clockHand + 1 == frames.size() ? 0 : clockHand + 1;
+            if (frames[frame].pinCount > 0)
+                continue;
+            if (!frames[frame].referenced)
+                break;
+            frames[frame].referenced = false;
+        }
+        if (frames[frame].dirty)
+            _Write(frame);
+    } else {
+        if (evictable.empty())
+            throw std::runtime_error("every buffer pool frame is pinned");
+        frame = std::get<2>(*evictable.begin());
+        if (frames[frame].dirty)
+            _Write(frame); // Before leaving the order, a failed write keeps the frame evictable
+        evictable.erase(evictable.begin());
+    }
+
+    pageTable.erase(frames[frame].id);
+    frames[frame].id = InvalidPageId;
+    ++stats.evictions;
+    return frame;
+}
+
+// Pages with fewer than k accesses have a K-th access of 0 and sort first
+inline BufferPool::LRUKKey BufferPool::_LRUKKey(std::size_t frame) const {
+    const std::uint64_t* accesses = history.data() + frame * k;
+    return LRUKKey(accesses[k - 1], accesses[0], frame);
+}
+
+inline void BufferPool::_Write(std::size_t frame) {
+    off_t offset = static_cast<off_t>(frames[frame].id) * static_cast<off_t>(pageBytes);
+    if (::pwrite(fd, _Data(frame), pageBytes, offset) != static_cast<ssize_t>(pageBytes))
+        throw PageFileError("cannot write", path);
+    frames[frame].dirty = false;
+    ++stats.writes;
+}
+
+inline void BufferPool::_WriteHeader() {
+    if (::pwrite(fd, headerPage.get(), pageBytes, 0) != static_cast<ssize_t>(pageBytes))
+        throw PageFileError("cannot write", path);
+}
+
+} // namespace VLIB
+
+#endif // VLIB_BUFFER_POOL_H
@@ -0,0 +1,229 @@
+#ifndef VLIB_PAGE_FILE_H
+#define VLIB_PAGE_FILE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+    Fixed-size pages in a file, the storage layer of the paged trees (POSIX only).
+
+    A page file is an array of pageBytes sized pages. Page 0 holds a PageFileHeader (page size, page
+    count, free list) followed by UserHeaderBytes bytes that belong to whatever structure lives in the
+    file, a tree keeps its root page id there. Pages are named by PageId, id 0 never names a node so it
+    doubles as the null page.
+
+    Every page store offers the same small interface, the trees only talk to pages through it:
+        std::size_t PageSize() const;
+        bool IsNew() const;                       // The file was created by this open
+        unsigned char* UserHeader();              // UserHeaderBytes bytes, saved with the file
+        PageId Allocate();                        // A zero filled page, recycled or appended
+        void Free(PageId id);                     // Back on the free list
+        char* Pin(PageId id);                     // The page stays at this address until unpinned
+        void Unpin(PageId id, bool dirty);        // dirty: the page was written to
+        void Sync();                              // Everything written so far reaches the disk
+
+    MmapPageFile maps the file and lets the OS page cache decide what stays in memory, Pin is pointer
+    arithmetic and Unpin does nothing. The file is mapped in segments of segmentBytes that never move,
+    so a pinned page keeps its address while the file grows. The file is grown a segment at a time
+    (sparse, untouched pages take no disk space).
+
+        MmapPageFile file("index.db");            // opens or creates
+        PageId id = file.Allocate();
+        char* page = file.Pin(id);
+        ...
+        file.Unpin(id, true);
+        file.Sync();
+
+    Without Sync the data still reaches the file through the page cache once the process exits, but a
+    crash of the machine can leave any subset of the written pages on disk.
+*/
+
+namespace VLIB {
+
+using PageId = std::uint32_t;
+constexpr PageId InvalidPageId = 0; // Page 0 is the file header, never a node
+
+constexpr std::size_t UserHeaderBytes = 128;
+
+// Layout of page 0
+struct PageFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t pageBytes;
+    std::uint64_t pageCount; // Header page included
+    PageId freeHead;         // First free page, InvalidPageId when none, the list is threaded through the pages
+    std::uint32_t freeCount;
+    unsigned char user[UserHeaderBytes];
+};
+
+constexpr char PageFileMagic[8] = {'V', 'L', 'I', 'B', 'P', 'G', 'F', '\0'};
+constexpr std::uint32_t PageFileVersion = 1;
+
+// Checks the page size a page file is opened with, throws std::invalid_argument
+inline void ValidatePageSize(std::size_t pageBytes) {
+    if (pageBytes < sizeof(PageFileHeader) || (pageBytes & (pageBytes - 1)) != 0)
+        throw std::invalid_argument("page size has to be a power of two of at least " + std::to_string(sizeof(PageFileHeader)) + " bytes");
+}
+
+// Header of a freshly created file
+inline void InitPageFileHeader(PageFileHeader& header, std::size_t pageBytes) {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PageFileMagic, sizeof(PageFileMagic));
+    header.version = PageFileVersion;
+    header.pageBytes = static_cast<std::uint32_t>(pageBytes);
+    header.pageCount = 1;
+    header.freeHead = InvalidPageId;
+}
+
+// Checks the header of an existing file, throws std::runtime_error when it is not a page file of pageBytes pages
+inline void CheckPageFileHeader(const PageFileHeader& header, std::size_t pageBytes, const std::string& path) {
+    if (std::memcmp(header.magic, PageFileMagic, sizeof(PageFileMagic)) != 0 || header.version != PageFileVersion)
+        throw std::runtime_error(path + " is not a page file");
+    if (header.pageBytes != pageBytes)
+        throw std::runtime_error(path + " has " + std::to_string(header.pageBytes) + " byte pages, not " + std::to_string(pageBytes));
+}
+
+// Error for a failed system call, reads errno before anything else can touch it
+inline std::system_error PageFileError(const char* what, const std::string& path) {
+    int error = errno;
+    return std::system_error(error, std::generic_category(), std::string(what) + " " + path);
+}
+
+class MmapPageFile {
+public:
+    explicit MmapPageFile(const std::string& path, std::size_t pageBytes = 4096, std::size_t segmentBytes = std::size_t(1) << 24);
+    ~MmapPageFile();
+
+    MmapPageFile(const MmapPageFile&) = delete;
+    MmapPageFile& operator=(const MmapPageFile&) = delete;
+
+    std::size_t PageSize() const {return pageBytes;};
+    std::uint64_t PageCount() const {return _Header()->pageCount;}; // Header page included
+    bool IsNew() const {return created;};
+    unsigned char* UserHeader() {return _Header()->user;};
+
+    PageId Allocate();
+    void Free(PageId id);
+    char* Pin(PageId id) {return segments[id / pagesPerSegment] + static_cast<std::size_t>(id % pagesPerSegment) * pageBytes;};
+    void Unpin(PageId, bool) {};
+    void Sync();
+
+private:
+    PageFileHeader* _Header() const {return reinterpret_cast<PageFileHeader*>(segments[0]);};
+    void _MapSegment(); // Grows the file by one segment and maps it
+
+    std::string path;
+    int fd;
+    std::size_t pageBytes;
+    std::size_t segmentBytes;
+    std::size_t pagesPerSegment;
+    std::vector<char*> segments;
+    bool created;
+};
+
+inline MmapPageFile::MmapPageFile(const std::string& path, std::size_t pageBytes, std::size_t segmentBytes)
+    : path(path), fd(-1), pageBytes(pageBytes), segmentBytes(segmentBytes), pagesPerSegment(0), created(false) {
+    ValidatePageSize(pageBytes);
+    std::size_t systemPage = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    if (segmentBytes < pageBytes || segmentBytes % pageBytes != 0 || segmentBytes % systemPage != 0)
+        throw std::invalid_argument("segment size has to be a multiple of the page size and of the system page size");
+    pagesPerSegment = segmentBytes / pageBytes;
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw PageFileError("cannot open", path);
+    try {
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+            throw PageFileError("cannot stat", path);
+        std::size_t fileBytes = static_cast<std::size_t>(status.st_size);
+        created = fileBytes == 0;
+        if (created) {
+            _MapSegment();
+            InitPageFileHeader(*_Header(), pageBytes);
+        } else {
+            // Check the header before mapping, mapping grows the file to whole segments
+            PageFileHeader header;
+            if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+                throw std::runtime_error(path + " is not a page file");
+            CheckPageFileHeader(header, pageBytes, path);
+            do
+                _MapSegment();
+            while (segments.size() * segmentBytes < fileBytes);
+            while (segments.size() * pagesPerSegment < _Header()->pageCount)
+                _MapSegment();
+        }
+    } catch (...) {
+        for (char* segment : segments)
+            ::munmap(segment, segmentBytes);
+        ::close(fd);
+        throw;
+    }
+}
+
+inline MmapPageFile::~MmapPageFile() {
+    for (char* segment : segments)
+        ::munmap(segment, segmentBytes);
+    ::close(fd);
+}
+
+inline PageId MmapPageFile::Allocate() {
+    PageFileHeader* header = _Header();
+    PageId id;
+    if (header->freeHead != InvalidPageId) {
+        id = header->freeHead;
+        char* page = Pin(id);
+        std::memcpy(&header->freeHead, page, sizeof(PageId));
+        --header->freeCount;
+        std::memset(page, 0, pageBytes);
+        return id;
+    }
+    if (header->pageCount > static_cast<std::uint64_t>(static_cast<PageId>(-1)))
+        throw std::length_error(path + " is out of page ids");
+    id = static_cast<PageId>(header->pageCount);
+    if (id / pagesPerSegment >= segments.size())
+        _MapSegment(); // Pages past the old end of the file read as zeros
+    ++header->pageCount;
+    return id;
+}
+
+inline void MmapPageFile::Free(PageId id) {
+    PageFileHeader* header = _Header();
+    std::memcpy(Pin(id), &header->freeHead, sizeof(PageId));
+    header->freeHead = id;
+    ++header->freeCount;
+}
+
+inline void MmapPageFile::Sync() {
+    for (char* segment : segments) {
+        if (::msync(segment, segmentBytes, MS_SYNC) != 0)
+            throw PageFileError("cannot sync", path);
+    }
+}
+
+inline void MmapPageFile::_MapSegment() {
+    off_t offset = static_cast<off_t>(segments.size() * segmentBytes);
+    struct stat status;
+    if (::fstat(fd, &status) != 0)
+        throw PageFileError("cannot stat", path);
+    if (status.st_size < offset + static_cast<off_t>(segmentBytes) && ::ftruncate(fd, offset + static_cast<off_t>(segmentBytes)) != 0)
+        throw PageFileError("cannot grow", path);
+    void* segment = ::mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    if (segment == MAP_FAILED)
+        throw PageFileError("cannot map", path);
+    segments.push_back(static_cast<char*>(segment));
+}
+
+} // namespace VLIB
+
+#endif // VLIB_PAGE_FILE_H
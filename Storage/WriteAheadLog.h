@@ -0,0 +1,270 @@
+#ifndef VLIB_WRITE_AHEAD_LOG_H
+#define VLIB_WRITE_AHEAD_LOG_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+    Append-only log of opaque records, the durability layer of LoggedBPlusTree (POSIX only).
+
+    Every record is framed as [length][CRC-32 of length and bytes][bytes]. Append only buffers the
+    record, Commit writes the buffer with a single write and waits for the disk with one fdatasync, so
+    a batch of records costs one disk round trip (group commit). Append commits on its own once
+    groupRecords records are pending, a record is durable once a Commit covering it has returned.
+
+        WriteAheadLog log("tree.wal", 128);          // fsync at most every 128 records
+        log.Append(&record, sizeof(record));
+        log.Commit();                                // everything appended so far is durable
+
+    Opening a log checks every record, a torn or corrupt tail (a crash in the middle of a write) is cut
+    off so the log ends with the last intact record. Replay hands the intact records out in order:
+        log.Replay([](const char* bytes, std::size_t length) { ... });
+
+    The header carries a generation number, a checkpoint stores its state elsewhere and then starts
+    the next generation with Reset, records of an older generation are never replayed against a newer
+    checkpoint.
+*/
+
+namespace VLIB {
+
+// CRC-32 (IEEE 802.3, reflected), chain calls by passing the previous result as crc
+inline std::uint32_t Crc32(const void* data, std::size_t bytes, std::uint32_t crc = 0) {
+    static const std::vector<std::uint32_t> table = [] {
+        std::vector<std::uint32_t> entries(256);
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t entry = i;
+            for (int bit = 0; bit < 8; ++bit)
+                entry = (entry >> 1) ^ (entry & 1 ? 0xEDB88320u : 0u);
+            entries[i] = entry;
+        }
+        return entries;
+    }();
+    const unsigned char* byte = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < bytes; ++i)
+        crc = table[(crc ^ byte[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Error for a failed system call, reads errno before anything else can touch it
+inline std::system_error LogFileError(const char* what, const std::string& path) {
+    int error = errno;
+    return std::system_error(error, std::generic_category(), std::string(what) + " " + path);
+}
+
+// Writes all of data at the current position, retrying short writes
+inline void WriteFully(int fd, const char* data, std::size_t bytes, const std::string& path) {
+    while (bytes > 0) {
+        ssize_t written = ::write(fd, data, bytes);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw LogFileError("cannot write", path);
+        }
+        data += written;
+        bytes -= static_cast<std::size_t>(written);
+    }
+}
+
+// Makes a rename or a file creation in the directory of path durable
+inline void SyncParentDirectory(const std::string& path) {
+    std::string::size_type slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw LogFileError("cannot open", directory);
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0)
+        throw LogFileError("cannot sync", directory);
+}
+
+class WriteAheadLog {
+public:
+    explicit WriteAheadLog(const std::string& path, std::size_t groupRecords = 64);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    void Append(const void* record, std::size_t bytes); // Buffered, commits once groupRecords are pending
+    void Commit();                                       // Writes the pending records and waits for the disk
+    template <class Fn>
+    std::size_t Replay(Fn fn);                           // fn(bytes, length) for every record on disk, returns how many
+    void Reset(std::uint64_t generation);                // Drops every record (pending ones too) and starts generation
+
+    std::uint64_t Generation() const {return generation;};
+    std::size_t PendingRecords() const {return pendingRecords;};
+    std::uint64_t Commits() const {return commits;}; // Disk syncs so far
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint64_t generation;
+    };
+    struct RecordHeader {
+        std::uint32_t bytes;
+        std::uint32_t crc; // Over bytes and the record
+    };
+
+    static constexpr char Magic[8] = {'V', 'L', 'I', 'B', 'W', 'A', 'L', '\0'};
+
+    void _WriteHeader();
+    std::vector<char> _ReadAll() const; // Header excluded
+
+    std::string path;
+    int fd;
+    std::size_t groupRecords;
+    std::uint64_t generation;
+    std::uint64_t logBytes; // Size of the file up to the last intact record
+    std::vector<char> pending;
+    std::size_t pendingRecords;
+    std::uint64_t commits;
+};
+
+inline WriteAheadLog::WriteAheadLog(const std::string& path, std::size_t groupRecords)
+    : path(path), fd(-1), groupRecords(groupRecords == 0 ? 1 : groupRecords), generation(0), logBytes(0), pendingRecords(0), commits(0) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+        throw LogFileError("cannot open", path);
+    try {
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+            throw LogFileError("cannot stat", path);
+        if (status.st_size < static_cast<off_t>(sizeof(Header))) {
+            // New, or a crash while the header of a new generation was written: nothing to keep
+            _WriteHeader();
+            return;
+        }
+        Header header;
+        if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+            throw LogFileError("cannot read", path);
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+            throw std::runtime_error(path + " is not a write-ahead log");
+        generation = header.generation;
+
+        // Cut the log after the last intact record
+        std::vector<char> records = _ReadAll();
+        std::size_t offset = 0;
+        while (records.size() - offset >= sizeof(RecordHeader)) {
+            RecordHeader record;
+            std::memcpy(&record, records.data() + offset, sizeof(record));
+            if (record.bytes > records.size() - offset - sizeof(RecordHeader)
+                || Crc32(records.data() + offset + sizeof(RecordHeader), record.bytes, Crc32(&record.bytes, sizeof(record.bytes))) != record.crc)
+                break;
+            offset += sizeof(RecordHeader) + record.bytes;
+        }
+        logBytes = sizeof(Header) + offset;
+        if (offset != records.size()) {
+            if (::ftruncate(fd, static_cast<off_t>(logBytes)) != 0 || ::fsync(fd) != 0)
+                throw LogFileError("cannot truncate", path);
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+inline WriteAheadLog::~WriteAheadLog() {
+    try {
+        Commit();
+    } catch (...) {
+        // Nothing left to report the error to, Commit before destruction to see it
+    }
+    ::close(fd);
+}
+
+inline void WriteAheadLog::Append(const void* record, std::size_t bytes) {
+    if (bytes > UINT32_MAX)
+        throw std::length_error("log record too large");
+    RecordHeader header;
+    header.bytes = static_cast<std::uint32_t>(bytes);
+    header.crc = Crc32(record, bytes, Crc32(&header.bytes, sizeof(header.bytes)));
+    const char* headerBytes = reinterpret_cast<const char*>(&header);
+    pending.insert(pending.end(), headerBytes, headerBytes + sizeof(header));
+    pending.insert(pending.end(), static_cast<const char*>(record), static_cast<const char*>(record) + bytes);
+    if (++pendingRecords >= groupRecords)
+        Commit();
+}
+
+inline void WriteAheadLog::Commit() {
+    if (pendingRecords == 0)
+        return;
+    try {
+        WriteFully(fd, pending.data(), pending.size(), path);
+        if (::fdatasync(fd) != 0)
+            throw LogFileError("cannot sync", path);
+    } catch (...) {
+        // Drop a partial write so the records of a later Commit follow intact ones
+        if (::ftruncate(fd, static_cast<off_t>(logBytes)) != 0) {}
+        throw;
+    }
+    logBytes += pending.size();
+    pending.clear();
+    pendingRecords = 0;
+    ++commits;
+}
+
+template <class Fn>
+std::size_t WriteAheadLog::Replay(Fn fn) {
+    Commit();
+    std::vector<char> records = _ReadAll(); // Intact up to the end, the constructor cut off any torn tail
+    std::size_t count = 0;
+    for (std::size_t offset = 0; offset < records.size(); ++count) {
+        RecordHeader record;
+        std::memcpy(&record, records.data() + offset, sizeof(record));
+        fn(static_cast<const char*>(records.data() + offset + sizeof(RecordHeader)), static_cast<std::size_t>(record.bytes));
+        offset += sizeof(RecordHeader) + record.bytes;
+    }
+    return count;
+}
+
+inline void WriteAheadLog::Reset(std::uint64_t nextGeneration) {
+    pending.clear();
+    pendingRecords = 0;
+    generation = nextGeneration;
+    _WriteHeader();
+}
+
+// Truncates the file down to a fresh header
+inline void WriteAheadLog::_WriteHeader() {
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.generation = generation;
+    if (::ftruncate(fd, 0) != 0)
+        throw LogFileError("cannot truncate", path);
+    WriteFully(fd, reinterpret_cast<const char*>(&header), sizeof(header), path);
+    if (::fsync(fd) != 0)
+        throw LogFileError("cannot sync", path);
+    logBytes = sizeof(header);
+}
+
+inline std::vector<char> WriteAheadLog::_ReadAll() const {
+    struct stat status;
+    if (::fstat(fd, &status) != 0)
+        throw LogFileError("cannot stat", path);
+    std::vector<char> records(static_cast<std::size_t>(status.st_size) - sizeof(Header));
+    std::size_t done = 0;
+    while (done < records.size()) {
+        ssize_t got = ::pread(fd, records.data() + done, records.size() - done, static_cast<off_t>(sizeof(Header) + done));
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            throw LogFileError("cannot read", path);
+        done += static_cast<std::size_t>(got);
+    }
+    return records;
+}
+
+} // namespace VLIB
+
+#endif // VLIB_WRITE_AHEAD_LOG_H